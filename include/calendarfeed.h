@@ -0,0 +1,148 @@
+#pragma once
+// Upcoming events of an iCalendar feed, refreshed by conditional GETs.
+// A fetch streams the .ics body through IcalStream into a pending list that keeps
+// only the CALENDAR_EVENTS earliest upcoming events, sorted by start. The list and
+// the response's ETag / Last-Modified replace the current ones only when the
+// calendar arrived whole (END:VCALENDAR seen): HTTP/1.0 ends a body by closing the
+// connection, so a dropped connection looks like a complete 200, and keeping its
+// validators would have every later re-fetch answered 304 on a truncated list.
+// The transfer itself is the caller's; headerHandler and bodyHandler fit
+// HttpStream's handlers with the feed as ctx.
+// Plain C++ (no Arduino dependencies), so the fetch logic is tested on a host.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include "icalstream.h"
+
+#ifndef CALENDAR_EVENTS
+#define CALENDAR_EVENTS 4
+#endif
+
+class CalendarFeed {
+ public:
+  enum Result : uint8_t { UPDATED, NOT_MODIFIED, FAILED };
+
+  // UTC of a wall-clock time in the clock's zone; floating, TZID and all-day
+  // DTSTARTs are taken as such
+  typedef int64_t (*ToUtcFn)(int64_t wallS);
+
+  explicit CalendarFeed(ToUtcFn toUtc) : _toUtc(toUtc) {}
+
+  // Forgets the events and validators (another feed)
+  void clear() {
+    _count = 0;
+    _etag[0] = _lastModified[0] = '\0';
+  }
+
+  // Starts a fetch at UTC nowS; returns the conditional request headers ("" for a
+  // full fetch), valid until the next begin()
+  const char* begin(int64_t nowS) {
+    _pendingCount = 0;
+    _pendingEtag[0] = _pendingLastModified[0] = '\0';
+    _fetchTime = nowS;
+    _ical.begin(eventHandler, this);
+    size_t n = 0;
+    _validators[0] = '\0';
+    if (_etag[0]) n = snprintf(_validators, sizeof(_validators), "If-None-Match: %s\r\n", _etag);
+    if (_lastModified[0] && n < sizeof(_validators)) {
+      snprintf(_validators + n, sizeof(_validators) - n, "If-Modified-Since: %s\r\n", _lastModified);
+    }
+    return _validators;
+  }
+
+  void header(const char* name, const char* value) {
+    if (strcasecmp(name, "ETag") == 0) {
+      copy(_pendingEtag, value, sizeof(_pendingEtag));
+    } else if (strcasecmp(name, "Last-Modified") == 0) {
+      copy(_pendingLastModified, value, sizeof(_pendingLastModified));
+    }
+  }
+
+  void body(const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) _ical.feed(data[i]);
+  }
+
+  // completed: the transfer ended normally; status: its HTTP status
+  Result finish(bool completed, int status) {
+    if (completed && status == 304) return NOT_MODIFIED;
+    if (!completed || status != 200) return FAILED;
+    _ical.finish();
+    if (!_ical.complete()) return FAILED;  // Cut off: keep what we have
+    memcpy(_events, _pending, sizeof(_events));
+    _count = _pendingCount;
+    copy(_etag, _pendingEtag, sizeof(_etag));
+    copy(_lastModified, _pendingLastModified, sizeof(_lastModified));
+    return UPDATED;
+  }
+
+  // Drops events that have started; true if any did. The kept list then no longer
+  // holds the earliest events of the feed, so the validators are cleared and the
+  // next fetch is a full one.
+  bool prune(int64_t utc) {
+    int n = 0;
+    while (n < _count && !upcoming(_events[n], utc)) n++;
+    if (n == 0) return false;
+    memmove(_events, _events + n, (_count - n) * sizeof(IcalEvent));
+    _count -= n;
+    _etag[0] = _lastModified[0] = '\0';
+    return true;
+  }
+
+  int count() const { return _count; }
+  const IcalEvent& event(int i) const { return _events[i]; }  // Start in UTC
+  const char* etag() const { return _etag; }
+  const char* lastModified() const { return _lastModified; }
+  uint16_t parsed() const { return _ical.events(); }         // VEVENTs in the last body
+
+  // Timed events are upcoming until they start; all-day events until their day is over
+  static bool upcoming(const IcalEvent& e, int64_t utc) { return e.start + (e.allDay ? 86400 : 0) > utc; }
+
+  static void headerHandler(const char* name, const char* value, void* ctx) {
+    static_cast<CalendarFeed*>(ctx)->header(name, value);
+  }
+
+  static void bodyHandler(const uint8_t* data, size_t len, void* ctx) {
+    static_cast<CalendarFeed*>(ctx)->body(data, len);
+  }
+
+ private:
+  ToUtcFn _toUtc;
+  IcalStream _ical;
+  IcalEvent _events[CALENDAR_EVENTS];
+  int _count = 0;
+  IcalEvent _pending[CALENDAR_EVENTS];  // Filled while a response streams in
+  int _pendingCount = 0;
+  char _etag[48] = "";
+  char _lastModified[32] = "";
+  char _pendingEtag[48];
+  char _pendingLastModified[32];
+  char _validators[128];                // Request headers of the fetch in progress
+  int64_t _fetchTime = 0;               // UTC at fetch start; older events are skipped
+
+  static void eventHandler(const IcalEvent& event, void* ctx) {
+    CalendarFeed* feed = static_cast<CalendarFeed*>(ctx);
+    IcalEvent e = event;
+    if (!e.utc) {
+      e.start = feed->_toUtc(e.start);
+      e.utc = true;
+    }
+    if (upcoming(e, feed->_fetchTime)) feed->insert(e);
+  }
+
+  // Sorted insert; the latest event falls off when full
+  void insert(const IcalEvent& e) {
+    int i = _pendingCount;
+    if (_pendingCount == CALENDAR_EVENTS) {
+      if (e.start >= _pending[_pendingCount - 1].start) return;
+      i--;
+    } else {
+      _pendingCount++;
+    }
+    for (; i > 0 && _pending[i - 1].start > e.start; i--) _pending[i] = _pending[i - 1];
+    _pending[i] = e;
+  }
+
+  static void copy(char* dst, const char* src, size_t size) { snprintf(dst, size, "%s", src); }
+};
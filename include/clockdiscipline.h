@@ -0,0 +1,170 @@
+#pragma once
+// Software clock discipline.
+// Models UTC as a function of a free-running local microsecond counter:
+//   utc(local) = baseUtc + (local - baseLocal) * (1 + freq) + slewed part of `pending`
+// Each sync reports the reference UTC seen at a local instant. The crystal's
+// frequency error `freq` is estimated by least squares over the last few syncs; the
+// remaining phase offset is slewed in at a bounded rate instead of stepped, so the
+// displayed time never jumps (offsets beyond the step threshold are stepped).
+// The poll interval doubles while offsets stay small and halves when they grow.
+// Plain C++ (no Arduino dependencies) so it also builds on a host.
+
+#include <stdint.h>
+
+#ifndef CLOCK_FREQ_SAMPLES
+#define CLOCK_FREQ_SAMPLES 8          // Syncs kept for the frequency regression
+#endif
+
+struct ClockDisciplineConfig {
+  uint32_t pollMinS;          // Shortest poll interval
+  uint32_t pollMaxS;          // Longest poll interval
+  int32_t stepThresholdUs;    // Larger offsets are stepped, smaller ones slewed
+  int32_t slewMaxPpm;         // Slew rate limit
+  int32_t pollTightUs;        // |offset| below this counts towards a longer interval
+  int32_t pollLooseUs;        // |offset| above this shortens the interval
+  uint8_t pollHoldSyncs;      // Consecutive tight syncs before doubling
+};
+
+class ClockDiscipline {
+ public:
+  explicit ClockDiscipline(const ClockDisciplineConfig& config) : _cfg(config), _pollS(config.pollMinS) {}
+
+  bool synced() const { return _synced; }
+
+  // Disciplined UTC (microseconds since 1970) at local counter value `localUs`
+  int64_t now(int64_t localUs) const {
+    int64_t elapsed = localUs - _baseLocal;
+    return _baseUtc + elapsed + (int64_t)(elapsed * _freq) + slewed(elapsed);
+  }
+
+  // A reference time `refUtcUs` observed at local counter value `localUs`
+  void sync(int64_t localUs, int64_t refUtcUs) {
+    if (!_synced) {
+      _synced = true;
+      rebase(localUs, refUtcUs);
+      addSample(localUs, refUtcUs);
+      _lastOffset = 0;
+      return;
+    }
+
+    int64_t modelNow = now(localUs);
+    int64_t offset = refUtcUs - modelNow;
+    _lastOffset = offset;
+    addSample(localUs, refUtcUs);
+    estimateFrequency();
+
+    if (offset > _cfg.stepThresholdUs || offset < -_cfg.stepThresholdUs) {
+      _steps++;
+      rebase(localUs, refUtcUs);
+      _pollS = _cfg.pollMinS;
+      _tightCount = 0;
+      return;
+    }
+
+    // Keep the displayed time continuous (modelNow predates the new frequency)
+    // and slew the offset in from here
+    rebase(localUs, modelNow);
+    _pending = offset;
+    adaptPoll(offset);
+  }
+
+  // Replaces the frequency correction from `localUs` on (e.g. from a temperature
+  // model) without a time step; the next sync() re-estimates it from the samples
+  void setFrequencyPpb(int64_t localUs, int32_t ppb) {
+    if (!_synced) return;
+    int64_t elapsed = localUs - _baseLocal;
+    int64_t utc = now(localUs);
+    int64_t remaining = _pending - slewed(elapsed);
+    rebase(localUs, utc);
+    _pending = remaining;
+    _freq = ppb * 1e-9;
+  }
+
+  uint32_t pollIntervalS() const { return _pollS; }
+  int64_t lastOffsetUs() const { return _lastOffset; }
+  int64_t pendingUs() const { return _pending; }
+  double freqPpm() const { return _freq * 1e6; }
+  uint32_t steps() const { return _steps; }
+  uint8_t samples() const { return _count; }
+
+ private:
+  ClockDisciplineConfig _cfg;
+  bool _synced = false;
+  int64_t _baseLocal = 0;
+  int64_t _baseUtc = 0;
+  double _freq = 0;           // Fractional frequency error of the local counter
+  int64_t _pending = 0;       // Phase correction still being slewed in (us)
+  int64_t _lastOffset = 0;
+  uint32_t _pollS;
+  uint8_t _tightCount = 0;
+  uint32_t _steps = 0;
+
+  // (local, ref - local) pairs; the slope of the second against the first is the
+  // frequency error. Stored relative to the first sample to keep doubles exact.
+  int64_t _originLocal = 0;
+  int64_t _originPhase = 0;
+  int64_t _sampleLocal[CLOCK_FREQ_SAMPLES];
+  int64_t _samplePhase[CLOCK_FREQ_SAMPLES];
+  uint8_t _head = 0;
+  uint8_t _count = 0;
+
+  void rebase(int64_t localUs, int64_t utcUs) {
+    _baseLocal = localUs;
+    _baseUtc = utcUs;
+    _pending = 0;
+  }
+
+  int64_t slewed(int64_t elapsed) const {
+    int64_t limit = elapsed * _cfg.slewMaxPpm / 1000000;
+    if (_pending > limit) return limit;
+    if (_pending < -limit) return -limit;
+    return _pending;
+  }
+
+  void addSample(int64_t localUs, int64_t refUtcUs) {
+    if (_count == 0) {
+      _originLocal = localUs;
+      _originPhase = refUtcUs - localUs;
+    }
+    _sampleLocal[_head] = localUs - _originLocal;
+    _samplePhase[_head] = (refUtcUs - localUs) - _originPhase;
+    _head = (_head + 1) % CLOCK_FREQ_SAMPLES;
+    if (_count < CLOCK_FREQ_SAMPLES) _count++;
+  }
+
+  void estimateFrequency() {
+    if (_count < 2) return;
+    double mx = 0, my = 0;
+    for (int i = 0; i < _count; i++) {
+      mx += _sampleLocal[i];
+      my += _samplePhase[i];
+    }
+    mx /= _count;
+    my /= _count;
+    double sxx = 0, sxy = 0;
+    for (int i = 0; i < _count; i++) {
+      double dx = _sampleLocal[i] - mx;
+      sxx += dx * dx;
+      sxy += dx * (_samplePhase[i] - my);
+    }
+    if (sxx <= 0) return;
+    double f = sxy / sxx;
+    double maxF = 500e-6;  // No sane crystal is further off than this
+    _freq = f > maxF ? maxF : (f < -maxF ? -maxF : f);
+  }
+
+  void adaptPoll(int64_t offset) {
+    int64_t mag = offset < 0 ? -offset : offset;
+    if (mag < _cfg.pollTightUs) {
+      if (++_tightCount >= _cfg.pollHoldSyncs && _pollS < _cfg.pollMaxS) {
+        _pollS = _pollS * 2 > _cfg.pollMaxS ? _cfg.pollMaxS : _pollS * 2;
+        _tightCount = 0;
+      }
+    } else {
+      _tightCount = 0;
+      if (mag > _cfg.pollLooseUs && _pollS > _cfg.pollMinS) {
+        _pollS = _pollS / 2 < _cfg.pollMinS ? _cfg.pollMinS : _pollS / 2;
+      }
+    }
+  }
+};
@@ -14,9 +14,17 @@
 
 // ======================== TIMING ========================
 #define DISPLAY_TIMEOUT        60      // Seconds before display off with no motion
-#define NTP_UPDATE_INTERVAL    600000  // NTP sync interval ms (10 min)
-#define MODE_CYCLE_TIME        20000   // Display mode change interval ms (20 s)
+#define MODE_CYCLE_TIME        20000   // Default per-mode dwell time ms (20 s)
+#define MODE_CYCLE_MAX         16      // Max entries in the runtime mode cycle list
+#define LOOP_IDLE_DELAY        5       // ms idle per loop pass; renders are paced per mode
+#define FLIP_SPIN_US           2000    // Busy-wait window before a second/half-second boundary (us)
+#define BRIGHTNESS_MOTION_INTERVAL 100 // ms between LDR/PIR polls (motion timer tick)
 #define SENSOR_UPDATE_WITH_NTP true    // Read sensor on each NTP sync
+#define SENSOR_UPDATE_INTERVAL 60000   // Periodic sensor read ms (1 min)
+#define PRESSURE_SAMPLE_INTERVAL 600000UL // Pressure history spacing ms (10 min, 3 h window)
+#define PRESSURE_SEA_LEVEL_OFFSET 0    // hPa added to station pressure for the forecast (altitude)
+#define SPARKLINE_HOURS        24      // History shown by the sparkline mode
+#define HISTORY_SAMPLES        96      // Sensor history depth (multiple of LINE_WIDTH)
 
 // ======================== BRIGHTNESS ========================
 #define LDR_FILTER_WEIGHT          8    // EMA weight; higher = slower response
@@ -26,15 +34,101 @@
 // ======================== DISPLAY MANAGEMENT ========================
 #define DISPLAY_MANUAL_OVERRIDE_DURATION 300000  // Manual override timeout ms (5 min)
 #define STARTUP_GRACE_PERIOD             10000   // ms to keep display on after boot
+#define COUNTDOWN_DEFAULT_SECONDS        300     // Countdown length until set via /api/timer
+
+// ======================== NOTIFICATIONS ========================
+#define NOTIFY_QUEUE_SIZE    8     // Fixed notification slots
+#define NOTIFY_TEXT_MAX      40    // Max characters per message
+#define NOTIFY_DEFAULT_TTL   300   // Seconds a message may wait before being dropped
+#define TICKER_PIXEL_MS      40    // Scroll speed: ms per pixel (25 px/s)
 
 // ======================== NTP ========================
-#define NTP_SERVERS "pool.ntp.org", "time.nist.gov", "time.google.com"
+#define NTP_SERVERS "pool.ntp.org,time.nist.gov,time.google.com"  // host[:port], queried in parallel
+#define NTP_SYNC_TIMEOUT  3000    // Wait for replies this long ms; no usable reply = failed sync
+#define NTP_DNS_TIMEOUT   1000    // Per-server lookup limit ms, one lookup per loop pass (addresses are cached, see sntpclient.h)
+#define NTP_RETRY_MIN     15000   // First retry delay after a failed sync ms
+#define NTP_RETRY_MAX     600000  // Retry backoff cap ms (doubles from NTP_RETRY_MIN)
+
+// ======================== CLOCK DISCIPLINE ========================
+// The displayed clock slews towards NTP instead of stepping, and the poll interval
+// adapts between the limits below as the crystal's drift is learnt.
+#define CLOCK_POLL_MIN_S        64      // Shortest NTP poll interval s
+#define CLOCK_POLL_MAX_S        16384   // Longest NTP poll interval s (~4.5 h)
+#define CLOCK_STEP_THRESHOLD_MS 128     // Larger offsets are stepped, smaller ones slewed
+#define CLOCK_SLEW_MAX_PPM      500     // Slew rate limit (0.5 ms per second)
+#define CLOCK_POLL_TIGHT_MS     20      // Offsets below this lengthen the poll interval
+#define CLOCK_POLL_LOOSE_MS     100     // Offsets above this shorten it
+#define CLOCK_JUMP_THRESHOLD_MS 10      // Displayed time moving this far off the counter counts as a jump
+#define SYNC_LOG_SIZE           32      // Recent sync events kept for /api/sync and /metrics (16 bytes each)
 
 // ======================== TIMEZONE ========================
-// Default compile-time timezone. Runtime default comes from timezones[0] (Sydney).
+// Default compile-time timezone. Runtime default is timezone index 0 (Sydney, see TZ_ZONES).
 // Requires TZ.h (included in main.cpp before this is used).
 // See include/timezones.h or CLAUDE.md for other options.
 #define MY_TZ TZ_Australia_Sydney
+#define TZ_SEARCH_MAX_RESULTS 50  // Cap on /api/zones/search?limit= (results are on the stack)
+
+// ======================== TIME SOURCES ========================
+// PPS > NTP > DS3231 (I2C 0x68, shares the BME280 bus) > RTC timer; see timesource.h
+#define PPS_PIN                      -1      // PPS input GPIO (e.g. 14 = D5), -1 = none
+#define PPS_ERROR_US                 20      // Edge timestamp uncertainty (interrupt latency)
+#define PPS_LABEL_MAX_ERROR_US       200000  // Clock error below which PPS edges can be numbered
+#define DS3231_READ_INTERVAL         60000   // ms between RTC chip reads
+#define DS3231_POLL_MS               10      // Seconds-register poll period while catching an edge
+#define DS3231_ERROR_US              1000    // I2C read latency allowance
+#define DS3231_SET_WINDOW_US         5000    // Chip is only written this soon after a second
+#define RTC_TIMER_ERROR_PPM          1000    // Calibrated RTC timer accuracy across a restart
+#define TIME_SOURCE_RTC_CHIP_STRATUM 14      // DS3231 until set from a better source
+#define TIME_SOURCE_RTC_TIMER_STRATUM 15
+#define TIME_SOURCE_MIN_FEED_S       16      // Shortest interval between clock updates from one source
+#define TIME_SOURCE_AGING_PPM        2       // Error growth of a sample as it ages (disciplined holdover)
+#define TIME_SOURCE_SET_THRESHOLD_MS 50      // RTC chip is reset when further off than this
+
+// ======================== WARM RESTART ========================
+// Clock and settings snapshot in RTC user memory (survives restarts, not power loss)
+#define RTC_SNAPSHOT_BLOCK    32        // 4-byte block offset; blocks 0-31 belong to the OTA bootloader
+#define RTC_SNAPSHOT_INTERVAL 60000     // Refresh period ms (covers unplanned resets)
+#define RTC_SNAPSHOT_MAX_AGE  3600      // Older snapshots are ignored s (RTC timer drift)
+
+// ======================== TEMPERATURE COMPENSATION ========================
+// Crystal drift learned against the BME280 temperature (tempcomp.h), kept in flash
+#define TEMPCOMP_ENABLED        true        // Apply the model once learned (it always learns)
+#define TEMPCOMP_EEPROM_ADDR    0           // Offset in the EEPROM emulation sector
+#define TEMPCOMP_SAVE_INTERVAL  21600000UL  // ms between flash writes of the model (6 h)
+
+// ======================== FLEET SYNC ========================
+// Clocks on one network share second ticks and mode rotation over multicast (fleetsync.h)
+#define FLEET_SYNC_ENABLED     true
+#define FLEET_GROUP            "239.255.42.99"  // Multicast group (organisation-local scope)
+#define FLEET_PORT             4124
+#define FLEET_BEACON_INTERVAL  1000     // ms between beacons
+#define FLEET_PEER_TIMEOUT     5000     // ms without beacons before a clock leaves the fleet
+#define FLEET_MAX_OFFSET_MS    1000     // A leader further off than this is not followed
+
+// ======================== WORLD CLOCK ========================
+#define WORLD_CLOCK_ZONES      0, 29, 12, 76  // Timezone indices: Sydney, London, New York, Tokyo
+#define WORLD_CLOCK_MAX_ZONES  8
+#define WORLD_CLOCK_ZONE_TIME  5000           // ms each zone is shown
+
+// ======================== WEATHER ========================
+// OpenWeatherMap-compatible current-weather endpoint (units=metric). An empty host
+// disables fetching; host/port/path can also be changed at runtime via /weather.
+#define WEATHER_HOST           ""
+#define WEATHER_PORT           80
+#define WEATHER_PATH           "/data/2.5/weather?q=Sydney,AU&units=metric&appid=YOUR_API_KEY"
+#define WEATHER_TTL            600000  // Cache lifetime of a good result ms (10 min)
+#define WEATHER_RETRY_INTERVAL 60000   // Wait after a failed fetch ms
+#define HTTP_CONNECT_TIMEOUT   1500    // DNS lookup / TCP connect timeout ms (each blocks one loop pass)
+#define HTTP_IDLE_TIMEOUT      10000   // Abort a fetch after this long without data ms
+#define HTTP_POLL_BUDGET       256     // Max response bytes processed per loop pass
+
+// ======================== CALENDAR ========================
+// iCalendar (.ics) feed for the next-event mode, plain HTTP only. Empty disables;
+// can also be set at runtime via /calendar?url=...
+#define CALENDAR_URL            ""
+#define CALENDAR_EVENTS         4        // Upcoming events kept (sorted by start)
+#define CALENDAR_REFRESH        900000   // Conditional re-fetch interval ms (15 min)
+#define CALENDAR_RETRY_INTERVAL 60000    // Wait after a failed fetch ms
 
 // ======================== WIFI ========================
 #define WIFI_AP_NAME "LED_Clock_Setup"  // Captive portal AP name on first boot
@@ -0,0 +1,82 @@
+#pragma once
+// DS3231 / DS1307-compatible I2C RTC, kept in UTC.
+// Only the time registers (0x00-0x06, BCD, 24-hour mode) and the DS3231 status
+// register are used. Writing the seconds register restarts the chip's sub-second
+// countdown, so the time should be written right after a second boundary.
+
+#include <Wire.h>
+#include "tzrules.h"
+
+#ifndef DS3231_ADDRESS
+#define DS3231_ADDRESS 0x68
+#endif
+
+#define DS3231_REG_SECONDS 0x00
+#define DS3231_REG_STATUS  0x0F
+#define DS3231_STATUS_OSF  0x80  // Oscillator stopped: time is not valid
+
+inline uint8_t ds3231FromBcd(uint8_t v) { return (v >> 4) * 10 + (v & 0x0F); }
+inline uint8_t ds3231ToBcd(uint8_t v) { return ((v / 10) << 4) | (v % 10); }
+
+inline bool ds3231Present() {
+  Wire.beginTransmission(DS3231_ADDRESS);
+  return Wire.endTransmission() == 0;
+}
+
+inline bool ds3231ReadRegs(uint8_t reg, uint8_t* buf, uint8_t n) {
+  Wire.beginTransmission(DS3231_ADDRESS);
+  Wire.write(reg);
+  if (Wire.endTransmission(false) != 0) return false;
+  if (Wire.requestFrom((uint8_t)DS3231_ADDRESS, n) != n) return false;
+  for (uint8_t i = 0; i < n; i++) buf[i] = Wire.read();
+  return true;
+}
+
+// True if the oscillator has stopped since the time was last set (or on first power-up)
+inline bool ds3231Lost() {
+  uint8_t status;
+  return !ds3231ReadRegs(DS3231_REG_STATUS, &status, 1) || (status & DS3231_STATUS_OSF);
+}
+
+// UTC seconds since 1970
+inline bool ds3231Read(int64_t& utc) {
+  uint8_t r[7];
+  if (!ds3231ReadRegs(DS3231_REG_SECONDS, r, sizeof(r))) return false;
+  int sec = ds3231FromBcd(r[0] & 0x7F);
+  int min = ds3231FromBcd(r[1] & 0x7F);
+  int hour = ds3231FromBcd(r[2] & 0x3F);
+  int day = ds3231FromBcd(r[4] & 0x3F);
+  int month = ds3231FromBcd(r[5] & 0x1F);
+  int year = 2000 + ds3231FromBcd(r[6]) + ((r[5] & 0x80) ? 100 : 0);
+  if (sec > 59 || min > 59 || hour > 23 || day < 1 || day > 31 || month < 1 || month > 12) return false;
+  utc = (int64_t)tzDaysFromCivil(year, month, day) * 86400 + hour * 3600 + min * 60 + sec;
+  return true;
+}
+
+// Writes UTC seconds and clears the oscillator-stopped flag
+inline bool ds3231Write(int64_t utc) {
+  int32_t days = tzFloorDiv(utc, 86400);
+  int32_t secOfDay = utc - (int64_t)days * 86400;
+  int32_t year;
+  int month, day;
+  tzCivilFromDays(days, year, month, day);
+  if (year < 2000 || year > 2199) return false;
+
+  Wire.beginTransmission(DS3231_ADDRESS);
+  Wire.write(DS3231_REG_SECONDS);
+  Wire.write(ds3231ToBcd(secOfDay % 60));
+  Wire.write(ds3231ToBcd(secOfDay / 60 % 60));
+  Wire.write(ds3231ToBcd(secOfDay / 3600));  // Bit 6 clear: 24-hour mode
+  Wire.write(tzWeekday(days) + 1);
+  Wire.write(ds3231ToBcd(day));
+  Wire.write(ds3231ToBcd(month) | (year >= 2100 ? 0x80 : 0));
+  Wire.write(ds3231ToBcd(year % 100));
+  if (Wire.endTransmission() != 0) return false;
+
+  uint8_t status;
+  if (!ds3231ReadRegs(DS3231_REG_STATUS, &status, 1)) return false;
+  Wire.beginTransmission(DS3231_ADDRESS);
+  Wire.write(DS3231_REG_STATUS);
+  Wire.write(status & ~DS3231_STATUS_OSF);
+  return Wire.endTransmission() == 0;
+}
@@ -0,0 +1,48 @@
+#pragma once
+// Allocation-free field formatters.
+// Numeric and date fields are emitted glyph by glyph to a sink (anything callable
+// with a char), so the renderer can draw them straight into scr[] instead of going
+// through sprintf() into a shared text buffer: no format-string parsing per frame
+// and no way for an out-of-range value to overrun a buffer.
+
+#include <Arduino.h>  // PROGMEM
+
+template <uint8_t N> struct Pow10 { static const uint32_t value = 10 * Pow10<N - 1>::value; };
+template <> struct Pow10<0> { static const uint32_t value = 1; };
+
+// Fixed-width, zero-padded field ("%02d" equivalent). Out-of-range values are
+// clamped so the field never grows beyond Digits glyphs.
+template <uint8_t Digits, typename Sink>
+inline void formatPadded(int value, Sink emit) {
+  static_assert(Digits >= 1 && Digits <= 9, "unsupported field width");
+  const int maxValue = Pow10<Digits>::value - 1;
+  uint32_t v = value < 0 ? 0 : (value > maxValue ? maxValue : value);
+  for (uint32_t div = Pow10<Digits - 1>::value; div > 0; div /= 10) {
+    emit('0' + (v / div) % 10);
+  }
+}
+
+// Variable-width unsigned field ("%d" equivalent for values >= 0)
+template <typename Sink>
+inline void formatNumber(int value, Sink emit) {
+  uint32_t v = value < 0 ? 0 : value;
+  uint32_t div = 1;
+  while (v / div >= 10) div *= 10;
+  for (; div > 0; div /= 10) emit('0' + (v / div) % 10);
+}
+
+// Signed field, used for temperatures which can go below zero
+template <typename Sink>
+inline void formatSigned(int value, Sink emit) {
+  if (value < 0) emit('-');
+  formatNumber(value < 0 ? -value : value, emit);
+}
+
+const char monthAbbrev[] PROGMEM = "JANFEBMARAPRMAYJUNJULAUGSEPOCTNOVDEC";
+
+// Three-letter month name; month is 1-12 (clamped)
+template <typename Sink>
+inline void formatMonth(int month, Sink emit) {
+  const char* m = monthAbbrev + ((month < 1 ? 1 : (month > 12 ? 12 : month)) - 1) * 3;
+  for (int i = 0; i < 3; i++) emit((char)pgm_read_byte(m + i));
+}
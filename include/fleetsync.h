@@ -0,0 +1,298 @@
+#pragma once
+// Fleet sync: clocks on one network share a display timebase.
+// Every clock multicasts a small beacon every interval: its id, the stratum and
+// error bound of its own clock, its mode-cycle epoch and configuration hash, and
+// its clock reading stamped just before sending. All clocks elect the same leader
+// (the best synced stratum, then the lowest id) and followers measure the leader's
+// clock against their own. A beacon can only arrive late, never early, so the
+// largest of the last FLEET_FILTER_SAMPLES one-way offsets is the one with the
+// least network delay (WiFi multicast is held back to the AP's DTIM beacon, so
+// single samples are off by up to ~100 ms). Adding offsetUs() to the clock gives
+// the leader's timebase, on which second flips, colon blink and mode rotation are
+// scheduled; the clock itself (and what it tells time sources) is not changed.
+// The leader's cycle epoch is adopted as well, so the rotation restarts together.
+// When the leader changes, the previous leader's offset and epoch are kept until
+// FLEET_SETTLE_SAMPLES beacons of the new one have been measured: the timebase does
+// not fall back to this clock's own meanwhile (a jump of up to FLEET_MAX_OFFSET_MS),
+// nor take a first sample that is still late by the delivery delay.
+// Beacons travel over a Transport: UDP multicast on the clock (see FLEET SYNC in
+// main.cpp), a loopback network in the tests. Plain C++ (no Arduino dependencies).
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef FLEET_MAX_PEERS
+#define FLEET_MAX_PEERS 32
+#endif
+#ifndef FLEET_FILTER_SAMPLES
+#define FLEET_FILTER_SAMPLES 16
+#endif
+#ifndef FLEET_SETTLE_SAMPLES
+#define FLEET_SETTLE_SAMPLES (FLEET_FILTER_SAMPLES / 2)
+#endif
+
+#define FLEET_PACKET_SIZE 36
+#define FLEET_VERSION     1
+#define FLEET_UNSYNCED    255   // Stratum of a clock that has no time yet
+
+class FleetSync {
+ public:
+  // UTC microseconds of this node's clock
+  typedef int64_t (*ClockFn)();
+
+  // Datagrams to and from the fleet group
+  struct Transport {
+    // Sends pkt to every clock in the group (this one included or not)
+    bool (*send)(const uint8_t* pkt, size_t len, void* ctx);
+    // Next datagram into buf and its sender (network byte order): its length, 0 if none is waiting
+    int (*receive)(uint8_t* buf, size_t size, uint32_t& fromIp, void* ctx);
+    void* ctx;
+  };
+
+  struct Peer {
+    uint32_t id;
+    uint8_t stratum;
+    uint32_t errorUs;
+    uint32_t epochS;
+    uint32_t cycleHash;
+    uint32_t ip;          // Sender address, network byte order
+    int64_t seenUs;       // Local counter at the last beacon
+    uint32_t beacons;
+  };
+
+  explicit FleetSync(ClockFn clock) : _clock(clock) {}
+
+  // The transport must stay valid until stop()
+  void begin(uint32_t id, const Transport& transport, uint32_t intervalMs, uint32_t peerTimeoutMs,
+             uint32_t maxOffsetUs) {
+    stop();
+    _id = id;
+    _transport = transport;
+    _intervalUs = (int64_t)intervalMs * 1000;
+    _peerTimeoutUs = (int64_t)peerTimeoutMs * 1000;
+    _maxOffsetUs = maxOffsetUs;
+    _lastBeaconUs = INT64_MIN / 2;
+    _running = true;
+  }
+
+  void stop() {
+    _running = false;
+    _peerCount = 0;
+    _leaderId = 0;
+    _leader = NONE;
+    _holding = false;
+    clearSamples();
+  }
+
+  // This node's clock quality and mode-cycle settings, sent in its beacons
+  void setLocal(uint8_t stratum, uint32_t errorUs, uint32_t epochS, uint32_t cycleHash) {
+    _stratum = stratum;
+    _errorUs = errorUs;
+    _epochS = epochS;
+    _cycleHash = cycleHash;
+  }
+
+  void service(int64_t localUs) {
+    if (!_running) return;
+    while (receive(localUs)) {
+    }
+    expirePeers(localUs);
+    elect();
+    if (localUs - _lastBeaconUs >= _intervalUs) {
+      _lastBeaconUs = localUs;
+      beacon();
+    }
+  }
+
+  bool running() const { return _running; }
+  bool leading() const { return _leader == SELF; }
+  uint32_t id() const { return _id; }
+  uint32_t leaderId() const { return _leader == SELF ? _id : _leaderId; }  // 0 = none
+  uint32_t beaconsSent() const { return _beaconsSent; }
+
+  // A leader is followed once its beacons give an offset within maxOffsetUs (after a
+  // change of leader, once the filter has settled)
+  bool following() const { return _leader >= 0 && !_holding && _sampleCount > 0 && offsetInRange(); }
+
+  // Leader's clock minus ours (0 when not following, the previous leader's while
+  // the new one is being measured)
+  int64_t offsetUs() const { return following() ? bestSample() : _holding ? _heldOffsetUs : 0; }
+
+  // Mode-cycle epoch (UTC seconds) of the fleet: the leader's while following
+  uint32_t epochS() const { return following() ? _peers[_leader].epochS : _holding ? _heldEpochS : _epochS; }
+
+  // False if the leader rotates a different cycle (the epoch alone cannot align it)
+  bool cycleMatches() const { return !following() || _peers[_leader].cycleHash == _cycleHash; }
+
+  int peerCount() const { return _peerCount; }
+  const Peer& peer(int i) const { return _peers[i]; }
+
+ private:
+  enum : int8_t { SELF = -1, NONE = -2 };
+
+  ClockFn _clock;
+  Transport _transport = {};
+  bool _running = false;
+  uint32_t _id = 0;
+  int64_t _intervalUs = 0;
+  int64_t _peerTimeoutUs = 0;
+  uint32_t _maxOffsetUs = 0;
+  int64_t _lastBeaconUs = INT64_MIN / 2;
+  uint32_t _seq = 0;
+  uint32_t _beaconsSent = 0;
+
+  uint8_t _stratum = FLEET_UNSYNCED;
+  uint32_t _errorUs = 0;
+  uint32_t _epochS = 0;
+  uint32_t _cycleHash = 0;
+
+  Peer _peers[FLEET_MAX_PEERS];
+  int _peerCount = 0;
+  int _leader = NONE;         // Peer index, SELF or NONE
+  uint32_t _leaderId = 0;
+  uint32_t _leaderEpochS = 0;  // From the leader's latest beacon
+
+  bool _holding = false;       // Leader changed, its successor still being measured
+  int64_t _heldOffsetUs = 0;
+  uint32_t _heldEpochS = 0;
+
+  int64_t _samples[FLEET_FILTER_SAMPLES];  // Leader's clock minus ours at arrival
+  int _sampleHead = 0;
+  int _sampleCount = 0;
+
+  void clearSamples() {
+    _sampleHead = 0;
+    _sampleCount = 0;
+  }
+
+  int64_t bestSample() const {
+    int64_t best = _samples[0];
+    for (int i = 1; i < _sampleCount; i++) best = _samples[i] > best ? _samples[i] : best;
+    return best;
+  }
+
+  bool offsetInRange() const {
+    int64_t o = bestSample();
+    return (o < 0 ? -o : o) <= _maxOffsetUs;
+  }
+
+  void beacon() {
+    uint8_t pkt[FLEET_PACKET_SIZE];
+    memset(pkt, 0, sizeof(pkt));
+    pkt[0] = 'L';
+    pkt[1] = 'C';
+    pkt[2] = 'F';
+    pkt[3] = 'S';
+    pkt[4] = FLEET_VERSION;
+    pkt[5] = _stratum;
+    put32(pkt + 8, _id);
+    put32(pkt + 12, _errorUs);
+    put32(pkt + 16, _epochS);
+    put32(pkt + 20, _cycleHash);
+    put32(pkt + 32, ++_seq);
+    put64(pkt + 24, (uint64_t)_clock());  // As late as possible
+    if (_transport.send(pkt, sizeof(pkt), _transport.ctx)) _beaconsSent++;
+  }
+
+  // False once no datagram is waiting
+  bool receive(int64_t localUs) {
+    int64_t rxClock = _clock();  // Before the copy, as early as possible
+    uint8_t pkt[FLEET_PACKET_SIZE];
+    uint32_t fromIp = 0;
+    int n = _transport.receive(pkt, sizeof(pkt), fromIp, _transport.ctx);
+    if (n <= 0) return false;
+    if (n < FLEET_PACKET_SIZE || memcmp(pkt, "LCFS", 4) != 0 || pkt[4] != FLEET_VERSION) return true;
+    uint32_t id = get32(pkt + 8);
+    if (id == _id) return true;  // Our own beacon, looped back
+
+    Peer* p = findPeer(id);
+    if (!p) {
+      if (_peerCount >= FLEET_MAX_PEERS) return true;
+      p = &_peers[_peerCount++];
+      *p = Peer();
+      p->id = id;
+    }
+    p->stratum = pkt[5];
+    p->errorUs = get32(pkt + 12);
+    p->epochS = get32(pkt + 16);
+    p->cycleHash = get32(pkt + 20);
+    p->ip = fromIp;
+    p->seenUs = localUs;
+    p->beacons++;
+
+    if (_leader >= 0 && id == _leaderId && p->stratum != FLEET_UNSYNCED && _stratum != FLEET_UNSYNCED) {
+      _samples[_sampleHead] = (int64_t)get64(pkt + 24) - rxClock;
+      _sampleHead = (_sampleHead + 1) % FLEET_FILTER_SAMPLES;
+      if (_sampleCount < FLEET_FILTER_SAMPLES) _sampleCount++;
+      _leaderEpochS = p->epochS;
+      if (_sampleCount >= FLEET_SETTLE_SAMPLES) _holding = false;
+    }
+    return true;
+  }
+
+  Peer* findPeer(uint32_t id) {
+    for (int i = 0; i < _peerCount; i++) {
+      if (_peers[i].id == id) return &_peers[i];
+    }
+    return nullptr;
+  }
+
+  void expirePeers(int64_t localUs) {
+    for (int i = 0; i < _peerCount;) {
+      if (localUs - _peers[i].seenUs > _peerTimeoutUs) {
+        _peers[i] = _peers[--_peerCount];
+      } else {
+        i++;
+      }
+    }
+  }
+
+  // Same rule on every node, so they all pick the same leader. Runs after
+  // expirePeers(), which may have moved or dropped the old leader's entry.
+  void elect() {
+    int best = _stratum != FLEET_UNSYNCED ? SELF : NONE;
+    uint8_t bestStratum = _stratum;
+    uint32_t bestId = _id;
+    for (int i = 0; i < _peerCount; i++) {
+      const Peer& p = _peers[i];
+      if (p.stratum == FLEET_UNSYNCED) continue;
+      if (best == NONE || p.stratum < bestStratum || (p.stratum == bestStratum && p.id < bestId)) {
+        best = i;
+        bestStratum = p.stratum;
+        bestId = p.id;
+      }
+    }
+    uint32_t leaderId = best == NONE ? 0 : bestId;
+    if (leaderId != _leaderId || (best == SELF) != (_leader == SELF)) {
+      if (best < 0) {
+        _holding = false;  // Leading (or nobody is): this clock is the timebase
+      } else if (following()) {
+        _holding = true;   // Was following: keep that timebase for now
+        _heldOffsetUs = bestSample();
+        _heldEpochS = _leaderEpochS;
+      }
+      clearSamples();
+    }
+    _leader = best;
+    _leaderId = leaderId;
+  }
+
+  static void put32(uint8_t* p, uint32_t v) {
+    for (int i = 3; i >= 0; i--, v >>= 8) p[i] = v & 0xFF;
+  }
+
+  static void put64(uint8_t* p, uint64_t v) {
+    for (int i = 7; i >= 0; i--, v >>= 8) p[i] = v & 0xFF;
+  }
+
+  static uint32_t get32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+  }
+
+  static uint64_t get64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) v = (v << 8) | p[i];
+    return v;
+  }
+};
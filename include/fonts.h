@@ -28,7 +28,7 @@ const uint8_t digits5x16rn[] PROGMEM = {5,16,'0',':',
 0x01, 0x20, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 
 };
 
-const uint8_t font3x7[] PROGMEM = {5,7,' ','_',
+constexpr uint8_t font3x7[] PROGMEM = {5,7,' ','_',
 0x02, 0x00, 0x00, 0x00, 0x00, 0x00,      // Code for char  
 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,      // Code for char !
 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,      // Code for char "
@@ -42,7 +42,7 @@ const uint8_t font3x7[] PROGMEM = {5,7,' ','_',
 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,      // Code for char *
 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,      // Code for char +
 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,      // Code for char ,
-0x01, 0x00, 0x00, 0x00, 0x00, 0x00,      // Code for char -
+0x02, 0x10, 0x10, 0x00, 0x00, 0x00,      // Code for char -
 0x01, 0x40, 0x00, 0x00, 0x00, 0x00,      // Code for char .
 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,      // Code for char /
 0x03, 0x7F, 0x41, 0x7F, 0x00, 0x00,      // Code for char 0
@@ -55,7 +55,7 @@ const uint8_t font3x7[] PROGMEM = {5,7,' ','_',
 0x03, 0x01, 0x71, 0x0F, 0x00, 0x00,      // Code for char 7
 0x03, 0x7F, 0x49, 0x7F, 0x00, 0x00,      // Code for char 8
 0x03, 0x4F, 0x49, 0x7F, 0x00, 0x00,      // Code for char 9
-0x01, 0x00, 0x00, 0x00, 0x00, 0x00,      // Code for char :
+0x01, 0x14, 0x00, 0x00, 0x00, 0x00,      // Code for char :
 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,      // Code for char ;
 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,      // Code for char <
 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,      // Code for char =
@@ -0,0 +1,225 @@
+#pragma once
+// Incremental HTTP/1.0 GET client.
+// begin() only records the request; poll() is called from loop() and does one step
+// per call: the host lookup, then the connect and request, then at most `budget`
+// response bytes, so a download is spread over many loop passes. The SDK's lookup
+// and connect block, so the pass doing one of them can stall the display for up to
+// connectTimeoutMs (two such passes per fetch at worst); resolved addresses are
+// cached for HTTP_DNS_TTL, so a repeat fetch normally needs only the connect.
+// Header lines are passed to a callback one at a time and body bytes are handed
+// over in small chunks; nothing beyond one header line is buffered.
+// HTTP/1.0 keeps it simple: no chunked encoding, the server closes at end of body.
+
+#include <ESP8266WiFi.h>
+
+#ifndef HTTP_LINE_MAX
+#define HTTP_LINE_MAX 128  // Longer header lines are truncated
+#endif
+#ifndef HTTP_HOST_MAX
+#define HTTP_HOST_MAX 48   // Longer host names are looked up on every fetch
+#endif
+#ifndef HTTP_DNS_TTL
+#define HTTP_DNS_TTL 3600000UL  // ms a resolved address is reused
+#endif
+
+// Splits "http://host[:port]/path" into its parts; `path` points into `url`.
+// Only plain HTTP is supported.
+inline bool httpParseUrl(const char* url, char* host, size_t hostSize, uint16_t& port, const char*& path) {
+  if (strncmp(url, "http://", 7) != 0) return false;
+  const char* h = url + 7;
+  const char* end = h;
+  while (*end && *end != ':' && *end != '/') end++;
+  size_t n = end - h;
+  if (n == 0 || n >= hostSize) return false;
+  memcpy(host, h, n);
+  host[n] = '\0';
+  port = 80;
+  if (*end == ':') {
+    port = atoi(end + 1);
+    while (*end && *end != '/') end++;
+    if (port == 0) return false;
+  }
+  path = *end ? end : "/";
+  return true;
+}
+
+class HttpStream {
+ public:
+  enum State : uint8_t { IDLE, LOOKUP, CONNECT, STATUS_LINE, HEADERS, BODY, DONE, FAILED };
+
+  typedef void (*HeaderHandler)(const char* name, const char* value, void* ctx);
+  typedef void (*BodyHandler)(const uint8_t* data, size_t len, void* ctx);
+
+  void onHeader(HeaderHandler h) { _onHeader = h; }
+  void onBody(BodyHandler h) { _onBody = h; }
+
+  // extraHeaders: complete "Name: value\r\n" lines or nullptr. host, path and
+  // extraHeaders are sent by a later poll(), so they must stay valid until then.
+  void begin(const char* host, uint16_t port, const char* path, const char* extraHeaders,
+             unsigned long connectTimeoutMs, unsigned long idleTimeoutMs, void* ctx) {
+    stop();
+    _ctx = ctx;
+    _status = 0;
+    _len = 0;
+    _bodyBytes = 0;
+    _host = host;
+    _port = port;
+    _path = path;
+    _extraHeaders = extraHeaders;
+    _connectTimeoutMs = connectTimeoutMs;
+    _idleTimeoutMs = idleTimeoutMs;
+    _state = knownAddress() ? CONNECT : LOOKUP;
+  }
+
+  State poll(size_t budget) {
+    if (_state == LOOKUP) {
+      lookup();
+      return _state;
+    }
+    if (_state == CONNECT) {
+      connect();
+      return _state;
+    }
+    if (_state < STATUS_LINE || _state > BODY) return _state;
+
+    size_t used = 0;
+    while (used < budget) {
+      int avail = _client.available();
+      if (avail <= 0) {
+        if (!_client.connected()) {
+          // HTTP/1.0: close marks the end of the body
+          finish(_state == BODY ? DONE : FAILED);
+        } else if (millis() - _lastActivity > _idleTimeoutMs) {
+          finish(FAILED);
+        }
+        return _state;
+      }
+      _lastActivity = millis();
+
+      if (_state == BODY) {
+        uint8_t chunk[64];
+        size_t want = min((size_t)avail, min(budget - used, sizeof(chunk)));
+        int got = _client.read(chunk, want);
+        if (got <= 0) break;
+        if (_onBody) _onBody(chunk, got, _ctx);
+        _bodyBytes += got;
+        used += got;
+      } else {
+        headerChar(_client.read());
+        used++;
+      }
+    }
+    return _state;
+  }
+
+  void stop() {
+    _client.stop();
+    _state = IDLE;
+  }
+
+  bool busy() const { return _state >= LOOKUP && _state <= BODY; }
+  State state() const { return _state; }
+  int status() const { return _status; }
+  uint32_t bodyBytes() const { return _bodyBytes; }
+
+ private:
+  WiFiClient _client;
+  State _state = IDLE;
+  int _status = 0;
+  char _line[HTTP_LINE_MAX];
+  int _len = 0;
+  uint32_t _bodyBytes = 0;
+  unsigned long _lastActivity = 0;
+  unsigned long _connectTimeoutMs = 0;
+  unsigned long _idleTimeoutMs = 0;
+  const char* _host = nullptr;
+  uint16_t _port = 0;
+  const char* _path = nullptr;
+  const char* _extraHeaders = nullptr;
+  IPAddress _ip;                       // Address being connected to
+  char _cachedHost[HTTP_HOST_MAX] = "";
+  IPAddress _cachedIp;
+  unsigned long _cachedAt = 0;
+  HeaderHandler _onHeader = nullptr;
+  BodyHandler _onBody = nullptr;
+  void* _ctx = nullptr;
+
+  // A literal or cached address needs no lookup
+  bool knownAddress() {
+    if (_ip.fromString(_host)) return true;
+    if (!_cachedHost[0] || strcmp(_cachedHost, _host) != 0 || millis() - _cachedAt >= HTTP_DNS_TTL) return false;
+    _ip = _cachedIp;
+    return true;
+  }
+
+  // Blocking, up to _connectTimeoutMs
+  void lookup() {
+    if (!WiFi.hostByName(_host, _ip, _connectTimeoutMs)) {
+      _state = FAILED;
+      return;
+    }
+    if (strlen(_host) < sizeof(_cachedHost)) {
+      strcpy(_cachedHost, _host);
+      _cachedIp = _ip;
+      _cachedAt = millis();
+    }
+    _state = CONNECT;
+  }
+
+  // Blocking, up to _connectTimeoutMs; sends the request once connected
+  void connect() {
+    _client.setTimeout(_connectTimeoutMs);
+    if (!_client.connect(_ip, _port)) {
+      _cachedHost[0] = '\0';  // Look it up again next time in case the server moved
+      _state = FAILED;
+      return;
+    }
+    _client.setNoDelay(true);
+
+    _client.print("GET ");
+    _client.print(_path);
+    _client.print(" HTTP/1.0\r\nHost: ");
+    _client.print(_host);
+    _client.print("\r\nUser-Agent: led-clock\r\nConnection: close\r\n");
+    if (_extraHeaders) _client.print(_extraHeaders);
+    _client.print("\r\n");
+
+    _state = STATUS_LINE;
+    _lastActivity = millis();
+  }
+
+  void finish(State s) {
+    _client.stop();
+    _state = s;
+  }
+
+  void headerChar(int c) {
+    if (c < 0 || c == '\r') return;
+    if (c != '\n') {
+      if (_len < HTTP_LINE_MAX - 1) _line[_len++] = c;
+      return;
+    }
+    _line[_len] = '\0';
+    _len = 0;
+
+    if (_state == STATUS_LINE) {
+      // "HTTP/1.1 200 OK"
+      const char* sp = strchr(_line, ' ');
+      _status = sp ? atoi(sp + 1) : 0;
+      _state = _status > 0 ? HEADERS : FAILED;
+      if (_state == FAILED) _client.stop();
+      return;
+    }
+
+    if (_line[0] == '\0') {
+      _state = BODY;
+      return;
+    }
+    char* colon = strchr(_line, ':');
+    if (!colon || !_onHeader) return;
+    *colon = '\0';
+    const char* value = colon + 1;
+    while (*value == ' ' || *value == '\t') value++;
+    _onHeader(_line, value, _ctx);
+  }
+};
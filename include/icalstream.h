@@ -0,0 +1,172 @@
+#pragma once
+// Incremental iCalendar (RFC 5545) VEVENT reader.
+// Characters are fed one at a time; folded lines are rejoined and each logical line
+// is handled as soon as it is complete, so memory use is one ICAL_LINE_MAX buffer
+// regardless of calendar size. Only DTSTART and SUMMARY of top-level VEVENTs are
+// kept (alarms and other nested components are skipped); recurrence rules are not
+// expanded. complete() tells a whole calendar from one cut off mid-transfer.
+// Plain C++ (no Arduino dependencies) so it also builds on a host.
+
+#include <stdint.h>
+#include <string.h>
+#include "tzrules.h"
+
+#ifndef ICAL_LINE_MAX
+#define ICAL_LINE_MAX 96      // Longer lines are truncated (only the start of SUMMARY matters)
+#endif
+#ifndef ICAL_SUMMARY_MAX
+#define ICAL_SUMMARY_MAX 24
+#endif
+
+struct IcalEvent {
+  int64_t start;        // Seconds since 1970: UTC if `utc`, else local wall-clock time
+  bool utc;             // DTSTART had a trailing 'Z'
+  bool allDay;          // DTSTART;VALUE=DATE
+  char summary[ICAL_SUMMARY_MAX];
+};
+
+class IcalStream {
+ public:
+  typedef void (*EventHandler)(const IcalEvent& event, void* ctx);
+
+  void begin(EventHandler handler, void* ctx) {
+    _handler = handler;
+    _ctx = ctx;
+    _len = 0;
+    _lineEnded = false;
+    _inEvent = false;
+    _nested = 0;
+    _events = 0;
+    _complete = false;
+  }
+
+  void feed(char c) {
+    if (c == '\r') return;
+    if (_lineEnded) {
+      _lineEnded = false;
+      // A line starting with whitespace continues the previous one (folding)
+      if (c == ' ' || c == '\t') return;
+      processLine();
+    }
+    if (c == '\n') {
+      _lineEnded = true;
+    } else if (_len < ICAL_LINE_MAX - 1) {
+      _line[_len++] = c;
+    }
+  }
+
+  // Flushes the last line once the body is complete
+  void finish() {
+    if (_lineEnded || _len > 0) processLine();
+    _lineEnded = false;
+  }
+
+  uint16_t events() const { return _events; }
+
+  // END:VCALENDAR was seen (after finish(), as it is usually the last line)
+  bool complete() const { return _complete; }
+
+ private:
+  char _line[ICAL_LINE_MAX];
+  int _len = 0;
+  bool _lineEnded = false;
+  bool _inEvent = false;
+  bool _haveStart = false;
+  uint8_t _nested = 0;      // Depth of components inside the VEVENT (VALARM, ...)
+  uint16_t _events = 0;
+  bool _complete = false;
+  IcalEvent _event;
+  EventHandler _handler = nullptr;
+  void* _ctx = nullptr;
+
+  void processLine() {
+    _line[_len] = '\0';
+    _len = 0;
+
+    // NAME[;PARAM=...]:VALUE - parameters may contain quoted ':'
+    char* params = nullptr;
+    char* value = nullptr;
+    bool quoted = false;
+    for (char* p = _line; *p; p++) {
+      if (*p == '"') {
+        quoted = !quoted;
+      } else if (!quoted && *p == ';' && !params) {
+        *p = '\0';
+        params = p + 1;
+      } else if (!quoted && *p == ':') {
+        *p = '\0';
+        value = p + 1;
+        break;
+      }
+    }
+    if (!value) return;
+
+    if (strcmp(_line, "BEGIN") == 0) {
+      if (_inEvent) {
+        _nested++;
+      } else if (strcmp(value, "VEVENT") == 0) {
+        _inEvent = true;
+        _haveStart = false;
+        memset(&_event, 0, sizeof(_event));
+      }
+    } else if (strcmp(_line, "END") == 0) {
+      if (!_inEvent) {
+        if (strcmp(value, "VCALENDAR") == 0) _complete = true;
+        return;
+      }
+      if (_nested > 0) {
+        _nested--;
+      } else {
+        _inEvent = false;
+        if (_haveStart) {
+          _events++;
+          if (_handler) _handler(_event, _ctx);
+        }
+      }
+    } else if (_inEvent && _nested == 0) {
+      if (strcmp(_line, "DTSTART") == 0) {
+        _haveStart = parseDateTime(value, params && strstr(params, "VALUE=DATE") && !strstr(params, "VALUE=DATE-TIME"));
+      } else if (strcmp(_line, "SUMMARY") == 0) {
+        unescape(value, _event.summary, sizeof(_event.summary));
+      }
+    }
+  }
+
+  static bool digits(const char*& s, int n, int32_t& v) {
+    v = 0;
+    for (int i = 0; i < n; i++, s++) {
+      if (*s < '0' || *s > '9') return false;
+      v = v * 10 + (*s - '0');
+    }
+    return true;
+  }
+
+  // YYYYMMDD[THHMMSS[Z]]
+  bool parseDateTime(const char* s, bool dateOnly) {
+    int32_t y, mo, d, h = 0, mi = 0, sec = 0;
+    if (!digits(s, 4, y) || !digits(s, 2, mo) || !digits(s, 2, d)) return false;
+    if (mo < 1 || mo > 12 || d < 1 || d > 31) return false;
+    _event.allDay = dateOnly || *s != 'T';
+    if (*s == 'T') {
+      s++;
+      if (!digits(s, 2, h) || !digits(s, 2, mi) || !digits(s, 2, sec)) return false;
+    }
+    _event.utc = *s == 'Z';
+    _event.start = (int64_t)tzDaysFromCivil(y, mo, d) * 86400 + h * 3600 + mi * 60 + sec;
+    return true;
+  }
+
+  // TEXT value: "\," "\;" "\\" -> literal, "\n" -> space
+  static void unescape(const char* s, char* out, size_t size) {
+    size_t n = 0;
+    for (; *s && n + 1 < size; s++) {
+      char c = *s;
+      if (c == '\\' && s[1]) {
+        c = *++s;
+        if (c == 'n' || c == 'N') c = ' ';
+      }
+      out[n++] = c;
+    }
+    out[n] = '\0';
+  }
+};
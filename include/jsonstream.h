@@ -0,0 +1,266 @@
+#pragma once
+// Streaming JSON tokenizer with fixed memory.
+// Characters are fed one at a time (e.g. straight from a socket); every scalar
+// value is reported with its path, such as "main.temp" or "weather[0].id".
+// Nothing but the current key stack and one value buffer is kept, so the body
+// never needs to be buffered. Keys/values longer than the buffers are truncated;
+// containers nested deeper than JSON_MAX_DEPTH are tracked but not reported.
+// jsonEscape() is the writing side, for text that ends up in a JSON response.
+// Plain C++ (no Arduino dependencies) so it also builds on a host.
+
+#include <stdint.h>
+#include <string.h>
+
+#ifndef JSON_MAX_DEPTH
+#define JSON_MAX_DEPTH 6
+#endif
+#ifndef JSON_KEY_MAX
+#define JSON_KEY_MAX 16
+#endif
+#ifndef JSON_VALUE_MAX
+#define JSON_VALUE_MAX 32
+#endif
+
+// Writes s as the contents of a JSON string: quotes, backslashes and control
+// characters escaped (the short forms the parser above reads back where there is
+// one), everything else (including UTF-8) passed through. The sink is anything
+// callable with a char.
+template <typename Sink>
+inline void jsonEscape(const char* s, Sink emit) {
+  static const char hex[] = "0123456789abcdef";
+  static const char shortForm[] = "btn?fr";  // \b \t \n (\v has none) \f \r
+  for (; *s; s++) {
+    uint8_t c = *s;
+    if (c == '"' || c == '\\') {
+      emit('\\');
+      emit((char)c);
+    } else if (c >= '\b' && c <= '\r' && c != 0x0B) {
+      emit('\\');
+      emit(shortForm[c - '\b']);
+    } else if (c < 0x20) {
+      emit('\\');
+      emit('u');
+      emit('0');
+      emit('0');
+      emit(hex[c >> 4]);
+      emit(hex[c & 0x0F]);
+    } else {
+      emit((char)c);
+    }
+  }
+}
+
+class JsonStream {
+ public:
+  // path: dotted/indexed location; value: string contents or literal text (123, true, null)
+  typedef void (*ValueHandler)(const char* path, const char* value, void* ctx);
+
+  void begin(ValueHandler handler, void* ctx) {
+    _handler = handler;
+    _ctx = ctx;
+    _depth = 0;
+    _state = S_VALUE;
+    _len = 0;
+    _failed = false;
+  }
+
+  bool failed() const { return _failed; }
+
+  // True once the top-level value has been closed
+  bool done() const { return _depth == 0 && _state == S_AFTER_VALUE; }
+
+  void feed(char c) {
+    if (_failed) return;
+    switch (_state) {
+      case S_STRING:
+        if (c == '\\') {
+          _state = S_ESCAPE;
+        } else if (c == '"') {
+          endString();
+        } else {
+          append(c);
+        }
+        return;
+
+      case S_ESCAPE:
+        switch (c) {
+          case 'n': append('\n'); break;
+          case 't': append('\t'); break;
+          case 'r': append('\r'); break;
+          case 'b': append('\b'); break;
+          case 'f': append('\f'); break;
+          case 'u': _unicode = 4; append('?'); _state = S_UNICODE; return;  // Non-ASCII not needed
+          default: append(c); break;
+        }
+        _state = S_STRING;
+        return;
+
+      case S_UNICODE:
+        if (--_unicode == 0) _state = S_STRING;
+        return;
+
+      case S_LITERAL:
+        if (c == ',' || c == '}' || c == ']' || isSpace(c)) {
+          emit();
+          _state = S_AFTER_VALUE;
+          feed(c);  // Delimiter belongs to the enclosing container
+        } else {
+          append(c);
+        }
+        return;
+
+      case S_VALUE:
+        if (isSpace(c)) return;
+        if (c == '"') {
+          startString(topExpectsKey());
+        } else if (c == '{') {
+          push(false);
+        } else if (c == '[') {
+          push(true);
+        } else if ((c == '}' || c == ']') && _depth > 0) {
+          pop();  // Empty container
+        } else if (c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n') {
+          _len = 0;
+          append(c);
+          _state = S_LITERAL;
+        } else {
+          _failed = true;
+        }
+        return;
+
+      case S_AFTER_KEY:
+        if (isSpace(c)) return;
+        if (c == ':') {
+          _state = S_VALUE;
+        } else {
+          _failed = true;
+        }
+        return;
+
+      case S_AFTER_VALUE:
+        if (isSpace(c)) return;
+        if (c == ',' && _depth > 0) {
+          if (_depth <= JSON_MAX_DEPTH) {
+            Frame& f = _stack[_depth - 1];
+            if (f.array) {
+              f.index++;
+            } else {
+              f.keyNext = true;
+            }
+          }
+          _state = S_VALUE;
+        } else if ((c == '}' || c == ']') && _depth > 0) {
+          pop();
+        } else if (c == ':') {
+          _state = S_VALUE;  // Key of an untracked (too deep) object
+        } else {
+          _failed = true;
+        }
+        return;
+    }
+  }
+
+ private:
+  enum State : uint8_t { S_VALUE, S_STRING, S_ESCAPE, S_UNICODE, S_LITERAL, S_AFTER_KEY, S_AFTER_VALUE };
+
+  struct Frame {
+    bool array;
+    bool keyNext;       // Object: next string is a key
+    uint16_t index;     // Array: current element
+    char key[JSON_KEY_MAX];
+  };
+
+  Frame _stack[JSON_MAX_DEPTH];
+  int _depth = 0;
+  State _state = S_VALUE;
+  bool _stringIsKey = false;
+  bool _failed = false;
+  uint8_t _unicode = 0;
+  char _buf[JSON_VALUE_MAX];
+  int _len = 0;
+  ValueHandler _handler = nullptr;
+  void* _ctx = nullptr;
+
+  static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+  }
+
+  bool topExpectsKey() const {
+    return _depth > 0 && _depth <= JSON_MAX_DEPTH && !_stack[_depth - 1].array && _stack[_depth - 1].keyNext;
+  }
+
+  void append(char c) {
+    if (_len < JSON_VALUE_MAX - 1) _buf[_len++] = c;
+  }
+
+  void startString(bool isKey) {
+    _stringIsKey = isKey;
+    _len = 0;
+    _state = S_STRING;
+  }
+
+  void endString() {
+    if (_stringIsKey) {
+      Frame& f = _stack[_depth - 1];
+      int n = _len < JSON_KEY_MAX - 1 ? _len : JSON_KEY_MAX - 1;
+      memcpy(f.key, _buf, n);
+      f.key[n] = '\0';
+      f.keyNext = false;
+      _state = S_AFTER_KEY;
+    } else {
+      emit();
+      _state = S_AFTER_VALUE;
+    }
+  }
+
+  void push(bool array) {
+    if (_depth < JSON_MAX_DEPTH) {
+      Frame& f = _stack[_depth];
+      f.array = array;
+      f.keyNext = !array;
+      f.index = 0;
+      f.key[0] = '\0';
+    }
+    _depth++;
+    _state = S_VALUE;
+  }
+
+  void pop() {
+    _depth--;
+    _state = S_AFTER_VALUE;
+  }
+
+  void emit() {
+    _buf[_len] = '\0';
+    if (!_handler || _depth > JSON_MAX_DEPTH) return;
+
+    char path[JSON_MAX_DEPTH * (JSON_KEY_MAX + 7)];
+    int p = 0;
+    for (int i = 0; i < _depth; i++) {
+      const Frame& f = _stack[i];
+      if (f.array) {
+        path[p++] = '[';
+        p += utoa10(f.index, path + p);
+        path[p++] = ']';
+      } else {
+        if (p > 0) path[p++] = '.';
+        int n = strlen(f.key);
+        memcpy(path + p, f.key, n);
+        p += n;
+      }
+    }
+    path[p] = '\0';
+    _handler(path, _buf, _ctx);
+  }
+
+  static int utoa10(uint16_t v, char* out) {
+    char tmp[5];
+    int n = 0;
+    do {
+      tmp[n++] = '0' + v % 10;
+      v /= 10;
+    } while (v);
+    for (int i = 0; i < n; i++) out[i] = tmp[n - 1 - i];
+    return n;
+  }
+};
@@ -0,0 +1,46 @@
+#pragma once
+// Compile-time text rendering.
+// prerenderText() mirrors clr() + printString() at xPos = yPos = 0, but runs in the
+// compiler, so constant status messages can be stored in flash as ready-made
+// framebuffer images and shown with a single memcpy_P() + refreshAll().
+
+struct FrameImage {
+  uint8_t rows[NUM_MAX * 8];
+};
+
+constexpr FrameImage prerenderText(const char* s, const uint8_t* font) {
+  // Scratch buffer matches scr[] (including the scroll column) so glyphs that
+  // overrun the top line wrap exactly as they do at runtime.
+  uint8_t buf[NUM_MAX * 8 + 8] = {};
+  const int bufSize = NUM_MAX * 8 + 8;
+
+  int fwd = font[0];
+  int fht8 = (font[1] + 7) / 8;
+  int offs = font[2];
+  int last = font[3];
+  int x = 0;
+
+  for (; *s && x <= NUM_MAX * 8; s++) {
+    int ch = (unsigned char)*s;
+    if (ch < offs || ch > last) {
+      x += 1;  // printCharX() draws nothing but printChar() still advances
+      continue;
+    }
+    const uint8_t* glyph = font + 4 + (ch - offs) * (fht8 * fwd + 1);
+    int w = glyph[0];
+    for (int j = 0; j < fht8; j++) {
+      int i = 0;
+      for (; i < w; i++) {
+        int idx = x + LINE_WIDTH * j + i;
+        if (idx < bufSize) buf[idx] = glyph[1 + fht8 * i + j];
+      }
+      int idx = x + LINE_WIDTH * j + i;
+      if (x + i < LINE_WIDTH && idx < bufSize) buf[idx] = 0;
+    }
+    x += w + 1;
+  }
+
+  FrameImage img = {};
+  for (int i = 0; i < NUM_MAX * 8; i++) img.rows[i] = buf[i];
+  return img;
+}
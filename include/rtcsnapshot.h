@@ -0,0 +1,74 @@
+#pragma once
+// Warm-restart snapshot of the clock and settings, kept in ESP8266 RTC user memory.
+// The record carries the RTC timer reading and the UTC at the same moment, sealed
+// with a magic number and a CRC-32. The RTC timer keeps counting through software,
+// watchdog and exception resets but restarts from zero on power-on and external
+// resets, so a reading below the saved one means the snapshot's time base is gone.
+// Ticks are converted with the chip's calibration, microseconds per tick in Q12
+// fixed point (system_rtc_clock_cali_proc()).
+// Plain C++ (no Arduino dependencies), so the encoding and checks are tested on a host.
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct RtcSnapshot {
+  uint32_t magic;
+  uint32_t rtcTicks;            // RTC timer when saved
+  int64_t utcUs;                // UTC at the same moment
+  int16_t temperatureDeci;
+  int16_t pressureDeci;
+  int8_t humidity;
+  uint8_t timezone;
+  uint8_t manualBrightness;
+  uint8_t flags;                // RTC_SNAP_*
+  uint8_t scheduleStartHour, scheduleStartMinute;
+  uint8_t scheduleEndHour, scheduleEndMinute;
+  uint32_t crc;                 // CRC-32 of everything above
+};
+static_assert(sizeof(RtcSnapshot) % 4 == 0, "RTC user memory is written in 4-byte blocks");
+
+const uint32_t RTC_SNAPSHOT_MAGIC = 0x4C434B31;  // "LCK1"
+enum : uint8_t {
+  RTC_SNAP_24H = 1 << 0,
+  RTC_SNAP_FAHRENHEIT = 1 << 1,
+  RTC_SNAP_MANUAL_BRIGHTNESS = 1 << 2,
+  RTC_SNAP_SCHEDULE = 1 << 3,
+  RTC_SNAP_SENSOR = 1 << 4,
+};
+
+enum RtcSnapshotState : uint8_t {
+  RTC_SNAPSHOT_VALID,
+  RTC_SNAPSHOT_CORRUPT,         // Bad magic or CRC (power-on leaves random contents)
+  RTC_SNAPSHOT_RESET,           // The RTC timer restarted since the snapshot
+  RTC_SNAPSHOT_STALE,           // Older than the allowed age
+};
+
+inline uint32_t crc32(const uint8_t* data, size_t len) {
+  uint32_t crc = 0xFFFFFFFF;
+  while (len--) {
+    crc ^= *data++;
+    for (int i = 0; i < 8; i++) crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+  }
+  return ~crc;
+}
+
+// Sets the magic and CRC once the other fields are filled in
+inline void rtcSnapshotSeal(RtcSnapshot& snap) {
+  snap.magic = RTC_SNAPSHOT_MAGIC;
+  snap.crc = crc32((const uint8_t*)&snap, offsetof(RtcSnapshot, crc));
+}
+
+// Checks a snapshot read back at RTC timer `ticks`; elapsedUs is the time since it
+// was saved when the result is RTC_SNAPSHOT_VALID
+inline RtcSnapshotState rtcSnapshotCheck(const RtcSnapshot& snap, uint32_t ticks, uint32_t calibration,
+                                         uint32_t maxAgeS, uint64_t& elapsedUs) {
+  elapsedUs = 0;
+  if (snap.magic != RTC_SNAPSHOT_MAGIC || snap.crc != crc32((const uint8_t*)&snap, offsetof(RtcSnapshot, crc))) {
+    return RTC_SNAPSHOT_CORRUPT;
+  }
+  if (ticks < snap.rtcTicks) return RTC_SNAPSHOT_RESET;
+  uint64_t us = ((uint64_t)(ticks - snap.rtcTicks) * calibration) >> 12;
+  if (us > maxAgeS * 1000000ULL) return RTC_SNAPSHOT_STALE;
+  elapsedUs = us;
+  return RTC_SNAPSHOT_VALID;
+}
@@ -0,0 +1,312 @@
+#pragma once
+// Minimal multi-server SNTP client (RFC 4330).
+// begin() sends one request to every configured server at once over a single UDP
+// socket; poll() is called from loop() and collects the replies until every server
+// has answered or the timeout passes. Each reply yields offset, round-trip delay and
+// stratum, and the sample with the lowest delay is chosen (as NTP's clock filter
+// does: the delay bounds the error of the offset).
+// Resolved addresses are cached for SNTP_DNS_TTL, so a sync normally needs no DNS.
+// The SDK's lookup blocks, so begin() never resolves: servers without a cached
+// address are looked up by poll(), at most one per call, and the requests go out
+// together once every address is known (a reply waiting behind a blocking lookup
+// would be timestamped late).
+// Servers are "host" or "host:port", so a local stand-in can replace the pool.
+
+#include <ESP8266WiFi.h>
+#include <WiFiUdp.h>
+
+#ifndef SNTP_MAX_SERVERS
+#define SNTP_MAX_SERVERS 4
+#endif
+#ifndef SNTP_HOST_MAX
+#define SNTP_HOST_MAX 32
+#endif
+#ifndef SNTP_DNS_TTL
+#define SNTP_DNS_TTL 3600000UL   // ms a resolved address is reused
+#endif
+#ifndef SNTP_LOCAL_PORT
+#define SNTP_LOCAL_PORT 4123     // Our side of the exchange
+#endif
+
+struct SntpSample {
+  uint8_t server;       // Index into the server list
+  uint8_t stratum;
+  int64_t offsetUs;     // Server time minus our clock
+  int32_t delayUs;      // Round-trip delay, excluding the server's processing time
+  int64_t rxLocalUs;    // micros64() when the reply arrived
+  int64_t rxClockUs;    // Our clock when the reply arrived
+
+  int64_t refUtcUs() const { return rxClockUs + offsetUs; }
+};
+
+class SntpClient {
+ public:
+  enum State : uint8_t { IDLE, WAITING, DONE, FAILED };
+
+  // UTC microseconds of the clock being measured (the one `offsetUs` refers to)
+  typedef int64_t (*ClockFn)();
+
+  struct Server {
+    char host[SNTP_HOST_MAX];
+    uint16_t port;
+    IPAddress ip;
+    bool resolved;
+    unsigned long resolvedAt;
+    int64_t sentAt;       // Our transmit timestamp (clock us), echoed back as origin
+    bool lookup;          // Waiting for poll() to resolve it
+    bool answered;
+    SntpSample last;      // Most recent reply from this server
+    uint32_t replies;
+    uint32_t misses;      // Requests without a usable reply
+  };
+
+  explicit SntpClient(ClockFn clock) : _clock(clock) {}
+
+  // Comma-separated "host[:port]" list (entries past SNTP_MAX_SERVERS are ignored).
+  // Replaces the current servers only if it holds at least one and all are valid;
+  // otherwise nothing changes.
+  bool setServers(const char* list) {
+    Server parsed[SNTP_MAX_SERVERS];
+    int count = 0;
+    const char* p = list;
+    while (*p && count < SNTP_MAX_SERVERS) {
+      while (*p == ' ' || *p == ',') p++;
+      const char* end = p;
+      while (*end && *end != ',') end++;
+      size_t n = end - p;
+      while (n > 0 && p[n - 1] == ' ') n--;
+      if (n > 0 && !parseServer(p, n, parsed[count++])) return false;
+      p = end;
+    }
+    if (count == 0) return false;
+    stop();
+    for (int i = 0; i < count; i++) _servers[i] = parsed[i];
+    _count = count;
+    return true;
+  }
+
+  // Queues servers without a cached address for lookup, or sends the requests
+  // straight away if there are none; timeoutMs runs from the requests
+  bool begin(unsigned long timeoutMs, unsigned long dnsTimeoutMs) {
+    stop();
+    if (_count == 0 || !_udp.begin(SNTP_LOCAL_PORT)) {
+      _state = FAILED;
+      return false;
+    }
+    _timeoutMs = timeoutMs;
+    _dnsTimeoutMs = dnsTimeoutMs;
+    _haveBest = false;
+    _pending = 0;
+    _lookups = 0;
+    for (int i = 0; i < _count; i++) {
+      Server& s = _servers[i];
+      s.answered = false;
+      s.lookup = false;
+      if (s.ip.fromString(s.host)) {
+        s.resolved = true;
+        s.resolvedAt = millis();
+      }
+      if (!s.resolved || millis() - s.resolvedAt >= SNTP_DNS_TTL) {
+        s.resolved = false;
+        s.lookup = true;
+        _lookups++;
+      }
+    }
+    _state = WAITING;
+    if (_lookups == 0) sendAll();
+    return _state == WAITING;
+  }
+
+  State poll() {
+    if (_state != WAITING) return _state;
+    while (_pending > 0 && _udp.parsePacket() > 0) receive();
+    if (_lookups > 0) {
+      lookupNext();
+      if (_lookups == 0) sendAll();
+      return _state;
+    }
+    if (_pending == 0 || millis() - _startedAt > _timeoutMs) {
+      for (int i = 0; i < _count; i++) {
+        Server& s = _servers[i];
+        if (s.resolved && !s.answered) {
+          s.misses++;
+          s.resolved = false;  // Re-resolve next time in case the server moved
+        }
+      }
+      _udp.stop();
+      _state = _haveBest ? DONE : FAILED;
+    }
+    return _state;
+  }
+
+  void stop() {
+    if (_state == WAITING) _udp.stop();
+    _state = IDLE;
+  }
+
+  State state() const { return _state; }
+  bool busy() const { return _state == WAITING; }
+
+  // Lowest-delay reply of the last exchange (valid once state() == DONE)
+  const SntpSample& best() const { return _best; }
+
+  int serverCount() const { return _count; }
+  const Server& server(int i) const { return _servers[i]; }
+
+  // NTP timestamps are seconds since 1900 (32.32 fixed point)
+  static const uint32_t NTP_UNIX_OFFSET = 2208988800UL;
+
+  static uint64_t toNtp(int64_t utcUs) {
+    uint64_t sec = (uint64_t)(utcUs / 1000000) + NTP_UNIX_OFFSET;
+    uint64_t frac = ((uint64_t)(utcUs % 1000000) << 32) / 1000000;
+    return (sec << 32) | frac;
+  }
+
+  // Era 0 ends in 2036; seconds values below 1968 are taken to be era 1
+  static int64_t fromNtp(uint64_t ntp) {
+    uint32_t sec = ntp >> 32;
+    int64_t s = (int64_t)sec - NTP_UNIX_OFFSET;
+    if (!(sec & 0x80000000UL)) s += 0x100000000LL;
+    return s * 1000000 + (int64_t)(((ntp & 0xFFFFFFFFULL) * 1000000) >> 32);
+  }
+
+ private:
+  WiFiUDP _udp;
+  ClockFn _clock;
+  Server _servers[SNTP_MAX_SERVERS];
+  int _count = 0;
+  int _pending = 0;       // Requests sent and not yet answered
+  int _lookups = 0;       // Servers still to be resolved
+  State _state = IDLE;
+  unsigned long _startedAt = 0;
+  unsigned long _timeoutMs = 0;
+  unsigned long _dnsTimeoutMs = 0;
+  bool _haveBest = false;
+  SntpSample _best;
+
+  // "host[:port]": host of hostname characters (so it needs no escaping in JSON or
+  // metric labels), port a plain number 1-65535
+  static bool parseServer(const char* spec, size_t n, Server& s) {
+    s = Server();
+    s.port = 123;
+    const char* colon = (const char*)memchr(spec, ':', n);
+    size_t hostLen = colon ? (size_t)(colon - spec) : n;
+    if (hostLen == 0 || hostLen >= SNTP_HOST_MAX) return false;
+    for (size_t i = 0; i < hostLen; i++) {
+      char c = spec[i];
+      bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '.';
+      if (!ok) return false;
+    }
+    memcpy(s.host, spec, hostLen);
+    s.host[hostLen] = '\0';
+    if (colon) {
+      const char* d = colon + 1;
+      size_t digits = n - hostLen - 1;
+      if (digits == 0 || digits > 5) return false;
+      uint32_t port = 0;
+      for (size_t i = 0; i < digits; i++) {
+        if (d[i] < '0' || d[i] > '9') return false;
+        port = port * 10 + (d[i] - '0');
+      }
+      if (port == 0 || port > 65535) return false;
+      s.port = port;
+    }
+    return true;
+  }
+
+  // Resolves the first server waiting for a lookup (blocking, up to _dnsTimeoutMs)
+  void lookupNext() {
+    for (int i = 0; i < _count; i++) {
+      Server& s = _servers[i];
+      if (!s.lookup) continue;
+      s.lookup = false;
+      _lookups--;
+      if (WiFi.hostByName(s.host, s.ip, _dnsTimeoutMs)) {
+        s.resolved = true;
+        s.resolvedAt = millis();
+      } else {
+        s.misses++;
+      }
+      return;
+    }
+  }
+
+  // A failed send counts as a miss when the exchange completes
+  void sendAll() {
+    _startedAt = millis();
+    for (int i = 0; i < _count; i++) {
+      if (_servers[i].resolved && send(_servers[i])) _pending++;
+    }
+    if (_pending == 0) {
+      _udp.stop();
+      _state = FAILED;
+    }
+  }
+
+  bool send(Server& s) {
+    uint8_t pkt[48];
+    memset(pkt, 0, sizeof(pkt));
+    pkt[0] = 0x23;  // LI 0, version 4, mode 3 (client)
+    s.sentAt = _clock();
+    putTimestamp(pkt + 40, toNtp(s.sentAt));
+    return _udp.beginPacket(s.ip, s.port) && _udp.write(pkt, sizeof(pkt)) == sizeof(pkt) && _udp.endPacket();
+  }
+
+  void receive() {
+    int64_t rxLocal = micros64();
+    int64_t t4 = _clock();
+    uint8_t pkt[48];
+    int n = _udp.read(pkt, sizeof(pkt));
+    _udp.flush();
+    if (n < 48) return;
+
+    IPAddress from = _udp.remoteIP();
+    uint16_t port = _udp.remotePort();
+    Server* s = nullptr;
+    for (int i = 0; i < _count; i++) {
+      Server& c = _servers[i];
+      if (c.resolved && !c.answered && c.ip == from && c.port == port) s = &c;
+    }
+    if (!s) return;
+
+    // Reply must be a server packet answering our request, from a synchronised server
+    uint8_t leap = pkt[0] >> 6;
+    uint8_t mode = pkt[0] & 0x07;
+    uint8_t stratum = pkt[1];
+    if (mode != 4 || leap == 3 || stratum == 0 || stratum > 15) return;
+    if (getTimestamp(pkt + 24) != toNtp(s->sentAt)) return;  // Stale or spoofed
+    uint64_t rx = getTimestamp(pkt + 32);
+    uint64_t tx = getTimestamp(pkt + 40);
+    if (rx == 0 || tx == 0) return;
+
+    int64_t t1 = s->sentAt;
+    int64_t t2 = fromNtp(rx);
+    int64_t t3 = fromNtp(tx);
+    SntpSample& sample = s->last;
+    sample.server = s - _servers;
+    sample.stratum = stratum;
+    sample.offsetUs = ((t2 - t1) + (t3 - t4)) / 2;
+    sample.delayUs = (t4 - t1) - (t3 - t2);
+    if (sample.delayUs < 0) sample.delayUs = 0;  // Server clock resolution
+    sample.rxLocalUs = rxLocal;
+    sample.rxClockUs = t4;
+
+    s->answered = true;
+    s->replies++;
+    _pending--;
+    if (!_haveBest || sample.delayUs < _best.delayUs) {
+      _best = sample;
+      _haveBest = true;
+    }
+  }
+
+  static void putTimestamp(uint8_t* p, uint64_t v) {
+    for (int i = 7; i >= 0; i--, v >>= 8) p[i] = v & 0xFF;
+  }
+
+  static uint64_t getTimestamp(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) v = (v << 8) | p[i];
+    return v;
+  }
+};
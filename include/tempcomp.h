@@ -0,0 +1,181 @@
+#pragma once
+// Temperature-compensated crystal drift model.
+// A crystal's frequency error is close to a parabola in temperature, so the model is
+//   f(T) = a + b*x + c*x^2   (ppb, x = T - 25.0 C in 0.1 C steps)
+// It is learned from pairs of reference syncs: between two syncs the local counter
+// falls behind the reference by the integral of f over the interval, which is linear
+// in (a, b, c) with the regressors (dt, integral of x dt, integral of x^2 dt). The
+// temperature need not be constant in between, so long poll intervals work (and
+// they keep the sync jitter small relative to the measured drift). The normal
+// equations are accumulated with slow forgetting so crystal ageing is tracked; a
+// small ridge term keeps b and c at zero until the temperature has actually varied.
+// Solving happens once per sync; prediction is integer-only.
+// Plain C++ (no Arduino dependencies), so it can be simulated on a host.
+
+#include <stdint.h>
+#include <string.h>
+
+#ifndef TEMPCOMP_MIN_INTERVAL_S
+#define TEMPCOMP_MIN_INTERVAL_S 300     // Shorter sync intervals are dominated by jitter
+#endif
+#ifndef TEMPCOMP_MIN_SAMPLES
+#define TEMPCOMP_MIN_SAMPLES 6          // Intervals needed before predictions are used
+#endif
+#ifndef TEMPCOMP_EXTRAPOLATE_DECI
+#define TEMPCOMP_EXTRAPOLATE_DECI 100   // Predict at most 10 C beyond the learned range
+#endif
+
+#define TEMPCOMP_REF_DECI 250           // x = 0 at 25.0 C
+
+// Persisted state (POD; the caller adds its own checksum)
+struct TempDriftState {
+  double n[3][3];       // Normal equations: sum of r r^T, r = (dt, Sx, Sxx)
+  double rhs[3];        // Sum of r * (reference - local) phase advance in ns
+  uint16_t samples;     // Intervals learned (saturates)
+  int16_t minDeci;      // Temperature range seen
+  int16_t maxDeci;
+  int32_t a;            // Solved coefficients: ppb
+  int32_t bMilli;       // 0.001 ppb per 0.1 C
+  int32_t cMicro;       // 0.000001 ppb per (0.1 C)^2
+};
+
+class TempDriftModel {
+ public:
+  TempDriftModel() { reset(); }
+
+  void reset() {
+    memset(&_s, 0, sizeof(_s));
+    _s.minDeci = 32767;
+    _s.maxDeci = -32768;
+    _haveSync = false;
+    clearInterval();
+  }
+
+  TempDriftState& state() { return _s; }
+  const TempDriftState& state() const { return _s; }
+
+  bool ready() const { return _s.samples >= TEMPCOMP_MIN_SAMPLES; }
+
+  // A temperature reading at local counter value localUs
+  void temperature(int64_t localUs, int16_t deci) {
+    if (_haveTemp && localUs > _tempAt) accumulate(localUs);
+    _tempDeci = deci;
+    _tempAt = localUs;
+    _haveTemp = true;
+  }
+
+  // No usable temperature (sensor failed): the running interval cannot be learned
+  void temperatureLost() {
+    _haveTemp = false;
+    _intervalValid = false;
+  }
+
+  // Reference time utcUs observed at local counter localUs; true if the interval
+  // since the previous one was learned. Shorter intervals are extended to the next sync.
+  bool sync(int64_t localUs, int64_t utcUs) {
+    bool learned = false;
+    if (_haveSync && _haveTemp && _intervalValid) {
+      int64_t dtUs = localUs - _syncLocal;
+      if (dtUs < (int64_t)TEMPCOMP_MIN_INTERVAL_S * 1000000) return false;
+      accumulate(localUs);
+      int64_t phaseUs = (utcUs - _syncUtc) - dtUs;
+      // |drift| beyond 500 ppm means a step or a bad sample, not the crystal
+      if ((phaseUs < 0 ? -phaseUs : phaseUs) * 2000 < dtUs) {
+        learn(dtUs / 1e6, phaseUs * 1000.0);
+        learned = true;
+      }
+    }
+    _syncLocal = localUs;
+    _syncUtc = utcUs;
+    _haveSync = true;
+    clearInterval();
+    if (_haveTemp) _tempAt = localUs;
+    return learned;
+  }
+
+  // Predicted frequency error (ppb, positive = local counter slow) at a temperature
+  int32_t predict(int16_t deci) const {
+    int32_t lo = _s.minDeci - TEMPCOMP_EXTRAPOLATE_DECI;
+    int32_t hi = _s.maxDeci + TEMPCOMP_EXTRAPOLATE_DECI;
+    int32_t t = deci < lo ? lo : (deci > hi ? hi : deci);
+    int64_t x = t - TEMPCOMP_REF_DECI;
+    return _s.a + (int32_t)((_s.bMilli * x) / 1000) + (int32_t)((_s.cMicro * x * x) / 1000000);
+  }
+
+ private:
+  TempDriftState _s;
+  bool _haveSync = false;
+  int64_t _syncLocal = 0;
+  int64_t _syncUtc = 0;
+  bool _haveTemp = false;
+  int16_t _tempDeci = 0;
+  int64_t _tempAt = 0;
+  bool _intervalValid = false;
+  double _sx = 0;               // Integral of x dt since the last sync (0.1 C * s)
+  double _sxx = 0;              // Integral of x^2 dt
+
+  void clearInterval() {
+    _sx = _sxx = 0;
+    _intervalValid = true;
+  }
+
+  // The last reading holds until `localUs`
+  void accumulate(int64_t localUs) {
+    double dt = (localUs - _tempAt) / 1e6;
+    double x = _tempDeci - TEMPCOMP_REF_DECI;
+    _sx += x * dt;
+    _sxx += x * x * dt;
+    _tempAt = localUs;
+    if (_tempDeci < _s.minDeci) _s.minDeci = _tempDeci;
+    if (_tempDeci > _s.maxDeci) _s.maxDeci = _tempDeci;
+  }
+
+  void learn(double dtS, double phaseNs) {
+    const double forget = 0.995;  // ~200 intervals of memory
+    double r[3] = {dtS, _sx, _sxx};
+    for (int i = 0; i < 3; i++) {
+      for (int j = 0; j < 3; j++) _s.n[i][j] = _s.n[i][j] * forget + r[i] * r[j];
+      _s.rhs[i] = _s.rhs[i] * forget + r[i] * phaseNs;
+    }
+    if (_s.samples < 0xFFFF) _s.samples++;
+    solve();
+  }
+
+  // 3x3 solve with a ridge on b and c, scaled to the data so it only matters while
+  // the temperature has barely moved
+  void solve() {
+    double m[3][4];
+    for (int i = 0; i < 3; i++) {
+      for (int j = 0; j < 3; j++) m[i][j] = _s.n[i][j];
+      m[i][3] = _s.rhs[i];
+    }
+    double scale = _s.n[0][0] > 0 ? _s.n[0][0] : 1;
+    m[1][1] += scale * 1e-2;    // x in 0.1 C: 1 C of spread outweighs it
+    m[2][2] += scale * 1e2;
+    for (int c = 0; c < 3; c++) {
+      int p = c;
+      for (int r = c + 1; r < 3; r++) {
+        if ((m[r][c] < 0 ? -m[r][c] : m[r][c]) > (m[p][c] < 0 ? -m[p][c] : m[p][c])) p = r;
+      }
+      if (m[p][c] == 0) return;
+      for (int k = 0; k < 4; k++) {
+        double t = m[c][k];
+        m[c][k] = m[p][k];
+        m[p][k] = t;
+      }
+      for (int r = 0; r < 3; r++) {
+        if (r == c) continue;
+        double f = m[r][c] / m[c][c];
+        for (int k = c; k < 4; k++) m[r][k] -= f * m[c][k];
+      }
+    }
+    double a = m[0][3] / m[0][0];
+    double b = m[1][3] / m[1][1];
+    double cc = m[2][3] / m[2][2];
+    const double lim = 500000;  // ppb
+    if (a > lim || a < -lim) return;
+    _s.a = (int32_t)a;
+    _s.bMilli = (int32_t)(b * 1000);
+    _s.cMicro = (int32_t)(cc * 1000000);
+  }
+};
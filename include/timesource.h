@@ -0,0 +1,184 @@
+#pragma once
+// Time-source hierarchy.
+// Sources (NTP, PPS, an RTC chip, the ESP's RTC timer, ...) post timestamped samples:
+// the UTC that was valid at a local counter value, an error bound and an NTP-style
+// stratum. service() keeps the best available source selected - lowest stratum,
+// then lowest current error, then registration order - and hands its new samples
+// to the caller for the clock discipline. discipline() then sets the settable
+// sources of higher stratum (e.g. an RTC chip) from the disciplined clock when they
+// have drifted. A sample's error grows with its age at `agingPpm`, and a source is
+// dropped once its last sample is older than its maxAge.
+// Plain C++ (no Arduino dependencies), so selection and failover can be tested on
+// a host with mock sources.
+
+#include <stdint.h>
+
+#ifndef TIME_SOURCES_MAX
+#define TIME_SOURCES_MAX 4
+#endif
+
+struct TimeSample {
+  int64_t localUs;      // Local counter (micros64) at which utcUs was valid
+  int64_t utcUs;
+  uint32_t errorUs;     // Error bound at that moment
+  uint8_t stratum;      // 0 = reference clock, n = synced to a stratum n-1 source
+};
+
+class TimeSources {
+ public:
+  // Sets the source to utcUs (valid at local counter localUs) and assigns it stratum.
+  // May refuse (return false), e.g. outside a write window; it is asked again later.
+  typedef bool (*SetFn)(int64_t localUs, int64_t utcUs, uint8_t stratum, void* ctx);
+
+  TimeSources(uint32_t minFeedS, uint32_t agingPpm, uint32_t setThresholdUs)
+      : _minFeedUs((int64_t)minFeedS * 1000000), _agingPpm(agingPpm), _setThresholdUs(setThresholdUs) {}
+
+  // Registration order is the tie-break priority. Returns the index, -1 if full.
+  int add(const char* name, uint32_t maxAgeS, SetFn set = nullptr, void* ctx = nullptr) {
+    if (_count >= TIME_SOURCES_MAX) return -1;
+    Source& s = _src[_count];
+    s = Source();
+    s.name = name;
+    s.maxAgeUs = (int64_t)maxAgeS * 1000000;
+    s.set = set;
+    s.ctx = ctx;
+    return _count++;
+  }
+
+  void post(int i, const TimeSample& sample) {
+    if (i < 0 || i >= _count) return;
+    Source& s = _src[i];
+    s.last = sample;
+    s.samples++;
+    s.invalid = false;
+    if (sample.localUs > s.setAt) s.setPending = false;
+  }
+
+  // The source holds no usable time (e.g. an RTC chip whose oscillator stopped)
+  void invalidate(int i) {
+    if (i < 0 || i >= _count) return;
+    _src[i].invalid = true;
+    _src[i].samples = 0;
+  }
+
+  // Re-selects; true with the sample to feed to the clock when the selected
+  // source has a new one (at most one per minFeedS, except right after a switch)
+  bool service(int64_t localUs, TimeSample& feed) {
+    int best = -1;
+    for (int i = 0; i < _count; i++) {
+      if (!available(i, localUs)) continue;
+      if (best < 0 || better(i, best, localUs)) best = i;
+    }
+
+    // Hysteresis: a source of the same stratum must be twice as good to take over
+    int sel = _selected;
+    if (sel < 0 || !available(sel, localUs)) {
+      sel = best;
+    } else if (best >= 0 && best != sel) {
+      const Source& b = _src[best];
+      const Source& c = _src[sel];
+      if (b.last.stratum < c.last.stratum ||
+          (b.last.stratum == c.last.stratum && errorUs(best, localUs) * 2 < errorUs(sel, localUs))) {
+        sel = best;
+      }
+    }
+    if (sel != _selected) {
+      _selected = sel;
+      _switches++;
+      if (sel >= 0) _src[sel].fed = 0;  // Feed its current sample right away
+    }
+    if (sel < 0) return false;
+
+    Source& s = _src[sel];
+    if (s.fed == s.samples) return false;
+    if (s.fed != 0 && s.last.localUs - _lastFedLocal < _minFeedUs) return false;
+    s.fed = s.samples;
+    _lastFedLocal = s.last.localUs;
+    feed = s.last;
+    return true;
+  }
+
+  // Sets higher-stratum settable sources whose last sample is off by more than the
+  // threshold (or that hold no time). utcUs is the disciplined clock at localUs.
+  void discipline(int64_t localUs, int64_t utcUs) {
+    if (_selected < 0) return;
+    uint8_t ref = _src[_selected].last.stratum;
+    uint32_t refError = errorUs(_selected, localUs);
+    if (refError > _setThresholdUs) return;  // Not good enough to set anything from
+
+    for (int i = 0; i < _count; i++) {
+      Source& s = _src[i];
+      if (i == _selected || !s.set || s.setPending) continue;
+      bool need = s.invalid;
+      if (!need && s.samples > 0 && s.last.stratum > ref) {
+        int64_t off = offsetUs(i, localUs, utcUs);
+        if (off < 0) off = -off;
+        need = off > _setThresholdUs;
+      }
+      if (need && s.set(localUs, utcUs, ref + 1, s.ctx)) {
+        s.sets++;
+        s.invalid = false;
+        s.setPending = true;  // Judge it again only by a sample taken after this
+        s.setAt = localUs;
+      }
+    }
+  }
+
+  int count() const { return _count; }
+  int selected() const { return _selected; }
+  uint32_t switches() const { return _switches; }
+  const char* name(int i) const { return _src[i].name; }
+  const TimeSample& last(int i) const { return _src[i].last; }
+  uint32_t samples(int i) const { return _src[i].samples; }
+  uint32_t sets(int i) const { return _src[i].sets; }
+
+  bool available(int i, int64_t localUs) const {
+    const Source& s = _src[i];
+    return s.samples > 0 && !s.invalid && localUs - s.last.localUs <= s.maxAgeUs;
+  }
+
+  // Error bound of source i's time now: its sample's bound, grown with age
+  uint32_t errorUs(int i, int64_t localUs) const {
+    const TimeSample& t = _src[i].last;
+    int64_t age = localUs > t.localUs ? localUs - t.localUs : 0;
+    int64_t e = t.errorUs + age * (int64_t)_agingPpm / 1000000;
+    return e > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)e;
+  }
+
+  // Source i's last sample against the clock (positive: source ahead)
+  int64_t offsetUs(int i, int64_t localUs, int64_t utcUs) const {
+    const TimeSample& t = _src[i].last;
+    return t.utcUs - (utcUs - (localUs - t.localUs));
+  }
+
+ private:
+  struct Source {
+    const char* name = nullptr;
+    int64_t maxAgeUs = 0;
+    SetFn set = nullptr;
+    void* ctx = nullptr;
+    TimeSample last = {0, 0, 0, 0};
+    uint32_t samples = 0;
+    uint32_t fed = 0;         // `samples` when last fed to the clock
+    uint32_t sets = 0;
+    bool invalid = false;
+    bool setPending = false;
+    int64_t setAt = 0;
+  };
+
+  Source _src[TIME_SOURCES_MAX];
+  int _count = 0;
+  int _selected = -1;
+  uint32_t _switches = 0;
+  int64_t _lastFedLocal = 0;
+  int64_t _minFeedUs;
+  uint32_t _agingPpm;
+  uint32_t _setThresholdUs;
+
+  bool better(int a, int b, int64_t localUs) const {
+    const TimeSample& x = _src[a].last;
+    const TimeSample& y = _src[b].last;
+    if (x.stratum != y.stratum) return x.stratum < y.stratum;
+    return errorUs(a, localUs) < errorUs(b, localUs);  // Equal: keep the earlier one
+  }
+};
@@ -1,13 +1,20 @@
 /*
  * timezones.h - Global Timezone Definitions
  * 
- * Contains POSIX timezone strings for 88 global cities
+ * Contains POSIX timezone strings for 89 global cities, stored in flash (PROGMEM)
  * Used for NTP time synchronization with automatic DST handling
  * 
+ * The table is written as two X-macro lists: TZ_RULES holds each distinct POSIX
+ * string once, under an identifier, and TZ_ZONES gives each city's name and rule.
+ * The compiler expands them into a pool of rule strings, a pool of city names,
+ * their offset tables and a one-byte rule index per city - all in flash, so the
+ * table costs no RAM, and cities sharing a rule (14 use CET alone) share its
+ * string. Read it through the timezone*() accessors at the end of this file.
+ * 
  * To add a new timezone:
  * 1. Find the POSIX TZ string for your location
- * 2. Add entry to timezones[] array: {"City, Country", "TZ_STRING"}
- * 3. Increment will be automatic via sizeof calculation
+ * 2. If TZ_RULES does not have it yet, add X(ID, "TZ_STRING") to TZ_RULES
+ * 3. Add X("City, Country", ID) to TZ_ZONES (the count follows automatically)
  * 
  * POSIX TZ String Format:
  * STDoffset[DST[offset],start[/time],end[/time]]
@@ -23,132 +30,263 @@
 #ifndef TIMEZONES_H
 #define TIMEZONES_H
 
-// ======================== TIMEZONE CONFIGURATION ========================
-struct TimezoneInfo {
-  const char* name;
-  const char* tzString;
-};
+#include <Arduino.h>
+
+#define TZ_NAME_MAX 32   // Buffer size for timezoneName(), including the NUL
+#define TZ_RULE_MAX 40   // Buffer size for timezoneRule(), including the NUL
+
+// ======================== TIMEZONE RULES ========================
+// X(ID, "POSIX TZ string"), each string once
+#define TZ_RULES(X) \
+  X(AEST_AEDT,  "AEST-10AEDT,M10.1.0,M4.1.0/3") \
+  X(AEST,       "AEST-10") \
+  X(ACST_ACDT,  "ACST-9:30ACDT,M10.1.0,M4.1.0/3") \
+  X(AWST,       "AWST-8") \
+  X(ACST,       "ACST-9:30") \
+  X(NZST_NZDT,  "NZST-12NZDT,M9.5.0,M4.1.0/3") \
+  X(FJT_FJST,   "FJT-12FJST,M11.1.0,M1.3.0/3") \
+  X(PGT,        "PGT-10") \
+  X(NCT,        "NCT-11") \
+  X(EST_EDT,    "EST5EDT,M3.2.0,M11.1.0") \
+  X(PST_PDT,    "PST8PDT,M3.2.0,M11.1.0") \
+  X(CST_CDT,    "CST6CDT,M3.2.0,M11.1.0") \
+  X(MST_MDT,    "MST7MDT,M3.2.0,M11.1.0") \
+  X(MST,        "MST7") \
+  X(AKST_AKDT,  "AKST9AKDT,M3.2.0,M11.1.0") \
+  X(HST,        "HST10") \
+  X(CST_CDT_MX, "CST6CDT,M4.1.0,M10.5.0") \
+  X(BRT_BRST,   "BRT3BRST,M10.3.0/0,M2.3.0/0") \
+  X(ART,        "ART3") \
+  X(CLT_CLST,   "CLT4CLST,M8.2.6/24,M5.2.6/24") \
+  X(PET,        "PET5") \
+  X(COT,        "COT5") \
+  X(VET,        "VET4:30") \
+  X(GMT_BST,    "GMT0BST,M3.5.0/1,M10.5.0") \
+  X(CET_CEST,   "CET-1CEST,M3.5.0,M10.5.0/3") \
+  X(WET_WEST,   "WET0WEST,M3.5.0/1,M10.5.0") \
+  X(IST_GMT_IE, "IST-1GMT0,M10.5.0,M3.5.0/1") \
+  X(GMT,        "GMT0") \
+  X(EET_EEST,   "EET-2EEST,M3.5.0/3,M10.5.0/4") \
+  X(MSK,        "MSK-3") \
+  X(GST,        "GST-4") \
+  X(IST_IDT,    "IST-2IDT,M3.4.4/26,M10.5.0") \
+  X(TRT,        "TRT-3") \
+  X(AST_SA,     "AST-3") \
+  X(IRST_IRDT,  "IRST-3:30IRDT,J79/24,J263/24") \
+  X(IST_IN,     "IST-5:30") \
+  X(NPT,        "NPT-5:45") \
+  X(BST_BD,     "BST-6") \
+  X(PKT,        "PKT-5") \
+  X(AFT,        "AFT-4:30") \
+  X(BTT,        "BTT-6") \
+  X(ICT,        "ICT-7") \
+  X(SGT,        "SGT-8") \
+  X(WIB,        "WIB-7") \
+  X(PHT,        "PHT-8") \
+  X(MYT,        "MYT-8") \
+  X(MMT,        "MMT-6:30") \
+  X(HKT,        "HKT-8") \
+  X(CST_CN,     "CST-8") \
+  X(JST,        "JST-9") \
+  X(KST,        "KST-9") \
+  X(ULAT,       "ULAT-8") \
+  X(UZT,        "UZT-5") \
+  X(ALMT,       "ALMT-6") \
+  X(KGT,        "KGT-6") \
+  X(AMT_AM,     "AMT-4") \
+  X(GET,        "GET-4") \
+  X(AZT,        "AZT-4") \
+  X(SAST,       "SAST-2") \
+  X(EET,        "EET-2") \
+  X(WAT,        "WAT-1") \
+  X(EAT,        "EAT-3")
+
+// ======================== TIMEZONES ========================
+// X("City, Country", rule ID). Organized by region: Australia, Americas, Europe,
+// Asia, Pacific, Africa, Middle East. A city's position is its timezone index, as
+// used by /timezone?tz=, WORLD_CLOCK_ZONES and the warm-restart snapshot, so new
+// cities go at the end of their region only if indices may shift.
+#define TZ_ZONES(X) \
+  /* ==================== AUSTRALIA & OCEANIA ==================== */ \
+  X("Sydney, Australia",              AEST_AEDT) \
+  X("Melbourne, Australia",           AEST_AEDT) \
+  X("Brisbane, Australia",            AEST) \
+  X("Adelaide, Australia",            ACST_ACDT) \
+  X("Perth, Australia",               AWST) \
+  X("Darwin, Australia",              ACST) \
+  X("Hobart, Australia",              AEST_AEDT) \
+  X("Auckland, New Zealand",          NZST_NZDT) \
+  X("Wellington, New Zealand",        NZST_NZDT) \
+  X("Fiji",                           FJT_FJST) \
+  X("Port Moresby, Papua New Guinea", PGT) \
+  X("Noumea, New Caledonia",          NCT) \
+  /* ==================== NORTH AMERICA ==================== */ \
+  X("New York, USA",                  EST_EDT) \
+  X("Los Angeles, USA",               PST_PDT) \
+  X("Chicago, USA",                   CST_CDT) \
+  X("Denver, USA",                    MST_MDT) \
+  X("Phoenix, USA",                   MST) \
+  X("Anchorage, USA",                 AKST_AKDT) \
+  X("Honolulu, USA",                  HST) \
+  X("Toronto, Canada",                EST_EDT) \
+  X("Vancouver, Canada",              PST_PDT) \
+  X("Montreal, Canada",               EST_EDT) \
+  X("Mexico City, Mexico",            CST_CDT_MX) \
+  /* ==================== SOUTH AMERICA ==================== */ \
+  X("Sao Paulo, Brazil",              BRT_BRST) \
+  X("Buenos Aires, Argentina",        ART) \
+  X("Santiago, Chile",                CLT_CLST) \
+  X("Lima, Peru",                     PET) \
+  X("Bogota, Colombia",               COT) \
+  X("Caracas, Venezuela",             VET) \
+  /* ==================== WESTERN EUROPE ==================== */ \
+  X("London, UK",                     GMT_BST) \
+  X("Paris, France",                  CET_CEST) \
+  X("Berlin, Germany",                CET_CEST) \
+  X("Rome, Italy",                    CET_CEST) \
+  X("Madrid, Spain",                  CET_CEST) \
+  X("Amsterdam, Netherlands",         CET_CEST) \
+  X("Brussels, Belgium",              CET_CEST) \
+  X("Vienna, Austria",                CET_CEST) \
+  X("Zurich, Switzerland",            CET_CEST) \
+  X("Lisbon, Portugal",               WET_WEST) \
+  X("Dublin, Ireland",                IST_GMT_IE) \
+  X("Reykjavik, Iceland",             GMT) \
+  /* ==================== NORTHERN EUROPE ==================== */ \
+  X("Stockholm, Sweden",              CET_CEST) \
+  X("Oslo, Norway",                   CET_CEST) \
+  X("Copenhagen, Denmark",            CET_CEST) \
+  X("Helsinki, Finland",              EET_EEST) \
+  /* ==================== CENTRAL & EASTERN EUROPE ==================== */ \
+  X("Prague, Czech Republic",         CET_CEST) \
+  X("Warsaw, Poland",                 CET_CEST) \
+  X("Budapest, Hungary",              CET_CEST) \
+  X("Athens, Greece",                 EET_EEST) \
+  X("Bucharest, Romania",             EET_EEST) \
+  X("Sofia, Bulgaria",                EET_EEST) \
+  X("Kiev, Ukraine",                  EET_EEST) \
+  X("Moscow, Russia",                 MSK) \
+  X("Minsk, Belarus",                 MSK) \
+  /* ==================== MIDDLE EAST ==================== */ \
+  X("Dubai, UAE",                     GST) \
+  X("Tel Aviv, Israel",               IST_IDT) \
+  X("Istanbul, Turkey",               TRT) \
+  X("Riyadh, Saudi Arabia",           AST_SA) \
+  X("Tehran, Iran",                   IRST_IRDT) \
+  /* ==================== SOUTH ASIA ==================== */ \
+  X("Mumbai, India",                  IST_IN) \
+  X("Colombo, Sri Lanka",             IST_IN) \
+  X("Kathmandu, Nepal",               NPT) \
+  X("Dhaka, Bangladesh",              BST_BD) \
+  X("Karachi, Pakistan",              PKT) \
+  X("Kabul, Afghanistan",             AFT) \
+  X("Thimphu, Bhutan",                BTT) \
+  /* ==================== SOUTHEAST ASIA ==================== */ \
+  X("Bangkok, Thailand",              ICT) \
+  X("Singapore",                      SGT) \
+  X("Jakarta, Indonesia",             WIB) \
+  X("Manila, Philippines",            PHT) \
+  X("Kuala Lumpur, Malaysia",         MYT) \
+  X("Ho Chi Minh, Vietnam",           ICT) \
+  X("Yangon, Myanmar",                MMT) \
+  /* ==================== EAST ASIA ==================== */ \
+  X("Hong Kong",                      HKT) \
+  X("Shanghai, China",                CST_CN) \
+  X("Taipei, Taiwan",                 CST_CN) \
+  X("Tokyo, Japan",                   JST) \
+  X("Seoul, South Korea",             KST) \
+  X("Ulaanbaatar, Mongolia",          ULAT) \
+  /* ==================== CENTRAL ASIA ==================== */ \
+  X("Tashkent, Uzbekistan",           UZT) \
+  X("Almaty, Kazakhstan",             ALMT) \
+  X("Bishkek, Kyrgyzstan",            KGT) \
+  /* ==================== CAUCASUS ==================== */ \
+  X("Yerevan, Armenia",               AMT_AM) \
+  X("Tbilisi, Georgia",               GET) \
+  X("Baku, Azerbaijan",               AZT) \
+  /* ==================== AFRICA ==================== */ \
+  X("Johannesburg, South Africa",     SAST) \
+  X("Cairo, Egypt",                   EET) \
+  X("Lagos, Nigeria",                 WAT) \
+  X("Nairobi, Kenya",                 EAT)
+
+// ======================== GENERATED TABLES ========================
+
+#define TZ_X_RULE_ID(id, rule)     TZR_##id,
+#define TZ_X_RULE_TEXT(id, rule)   rule "\0"
+#define TZ_X_RULE_SIZE(id, rule)   sizeof(rule),
+#define TZ_X_ZONE_NAME(name, id)   name "\0"
+#define TZ_X_ZONE_SIZE(name, id)   sizeof(name),
+#define TZ_X_ZONE_RULE(name, id)   TZR_##id,
+
+enum TzRuleId : uint8_t { TZ_RULES(TZ_X_RULE_ID) TZ_RULE_COUNT };
+
+// NUL-separated string pools
+constexpr char tzRuleText[] PROGMEM = TZ_RULES(TZ_X_RULE_TEXT);
+constexpr char tzZoneNames[] PROGMEM = TZ_ZONES(TZ_X_ZONE_NAME);
+
+const uint8_t tzZoneRules[] PROGMEM = { TZ_ZONES(TZ_X_ZONE_RULE) };
+constexpr int numTimezones = sizeof(tzZoneRules);
+
+// String sizes (compile time only) and the pool offsets built from them
+constexpr uint8_t tzRuleSizes[] = { TZ_RULES(TZ_X_RULE_SIZE) };
+constexpr uint8_t tzZoneSizes[] = { TZ_ZONES(TZ_X_ZONE_SIZE) };
 
-// Expanded timezone array with 88 global timezones
-// Organized by region: Australia, Americas, Europe, Asia, Pacific, Africa, Middle East
-const TimezoneInfo timezones[] = {
-  // ==================== AUSTRALIA & OCEANIA ====================
-  {"Sydney, Australia", "AEST-10AEDT,M10.1.0,M4.1.0/3"},
-  {"Melbourne, Australia", "AEST-10AEDT,M10.1.0,M4.1.0/3"},
-  {"Brisbane, Australia", "AEST-10"},
-  {"Adelaide, Australia", "ACST-9:30ACDT,M10.1.0,M4.1.0/3"},
-  {"Perth, Australia", "AWST-8"},
-  {"Darwin, Australia", "ACST-9:30"},
-  {"Hobart, Australia", "AEST-10AEDT,M10.1.0,M4.1.0/3"},
-  {"Auckland, New Zealand", "NZST-12NZDT,M9.5.0,M4.1.0/3"},
-  {"Wellington, New Zealand", "NZST-12NZDT,M9.5.0,M4.1.0/3"},
-  {"Fiji", "FJT-12FJST,M11.1.0,M1.3.0/3"},
-  {"Port Moresby, Papua New Guinea", "PGT-10"},
-  {"Noumea, New Caledonia", "NCT-11"},
-  
-  // ==================== NORTH AMERICA ====================
-  {"New York, USA", "EST5EDT,M3.2.0,M11.1.0"},
-  {"Los Angeles, USA", "PST8PDT,M3.2.0,M11.1.0"},
-  {"Chicago, USA", "CST6CDT,M3.2.0,M11.1.0"},
-  {"Denver, USA", "MST7MDT,M3.2.0,M11.1.0"},
-  {"Phoenix, USA", "MST7"},
-  {"Anchorage, USA", "AKST9AKDT,M3.2.0,M11.1.0"},
-  {"Honolulu, USA", "HST10"},
-  {"Toronto, Canada", "EST5EDT,M3.2.0,M11.1.0"},
-  {"Vancouver, Canada", "PST8PDT,M3.2.0,M11.1.0"},
-  {"Montreal, Canada", "EST5EDT,M3.2.0,M11.1.0"},
-  {"Mexico City, Mexico", "CST6CDT,M4.1.0,M10.5.0"},
-  
-  // ==================== SOUTH AMERICA ====================
-  {"Sao Paulo, Brazil", "BRT3BRST,M10.3.0/0,M2.3.0/0"},
-  {"Buenos Aires, Argentina", "ART3"},
-  {"Santiago, Chile", "CLT4CLST,M8.2.6/24,M5.2.6/24"},
-  {"Lima, Peru", "PET5"},
-  {"Bogota, Colombia", "COT5"},
-  {"Caracas, Venezuela", "VET4:30"},
-  
-  // ==================== WESTERN EUROPE ====================
-  {"London, UK", "GMT0BST,M3.5.0/1,M10.5.0"},
-  {"Paris, France", "CET-1CEST,M3.5.0,M10.5.0/3"},
-  {"Berlin, Germany", "CET-1CEST,M3.5.0,M10.5.0/3"},
-  {"Rome, Italy", "CET-1CEST,M3.5.0,M10.5.0/3"},
-  {"Madrid, Spain", "CET-1CEST,M3.5.0,M10.5.0/3"},
-  {"Amsterdam, Netherlands", "CET-1CEST,M3.5.0,M10.5.0/3"},
-  {"Brussels, Belgium", "CET-1CEST,M3.5.0,M10.5.0/3"},
-  {"Vienna, Austria", "CET-1CEST,M3.5.0,M10.5.0/3"},
-  {"Zurich, Switzerland", "CET-1CEST,M3.5.0,M10.5.0/3"},
-  {"Lisbon, Portugal", "WET0WEST,M3.5.0/1,M10.5.0"},
-  {"Dublin, Ireland", "IST-1GMT0,M10.5.0,M3.5.0/1"},
-  {"Reykjavik, Iceland", "GMT0"},
-  
-  // ==================== NORTHERN EUROPE ====================
-  {"Stockholm, Sweden", "CET-1CEST,M3.5.0,M10.5.0/3"},
-  {"Oslo, Norway", "CET-1CEST,M3.5.0,M10.5.0/3"},
-  {"Copenhagen, Denmark", "CET-1CEST,M3.5.0,M10.5.0/3"},
-  {"Helsinki, Finland", "EET-2EEST,M3.5.0/3,M10.5.0/4"},
-  
-  // ==================== CENTRAL & EASTERN EUROPE ====================
-  {"Prague, Czech Republic", "CET-1CEST,M3.5.0,M10.5.0/3"},
-  {"Warsaw, Poland", "CET-1CEST,M3.5.0,M10.5.0/3"},
-  {"Budapest, Hungary", "CET-1CEST,M3.5.0,M10.5.0/3"},
-  {"Athens, Greece", "EET-2EEST,M3.5.0/3,M10.5.0/4"},
-  {"Bucharest, Romania", "EET-2EEST,M3.5.0/3,M10.5.0/4"},
-  {"Sofia, Bulgaria", "EET-2EEST,M3.5.0/3,M10.5.0/4"},
-  {"Kiev, Ukraine", "EET-2EEST,M3.5.0/3,M10.5.0/4"},
-  {"Moscow, Russia", "MSK-3"},
-  {"Minsk, Belarus", "MSK-3"},
-  
-  // ==================== MIDDLE EAST ====================
-  {"Dubai, UAE", "GST-4"},
-  {"Tel Aviv, Israel", "IST-2IDT,M3.4.4/26,M10.5.0"},
-  {"Istanbul, Turkey", "TRT-3"},
-  {"Riyadh, Saudi Arabia", "AST-3"},
-  {"Tehran, Iran", "IRST-3:30IRDT,J79/24,J263/24"},
-  
-  // ==================== SOUTH ASIA ====================
-  {"Mumbai, India", "IST-5:30"},
-  {"Colombo, Sri Lanka", "IST-5:30"},
-  {"Kathmandu, Nepal", "NPT-5:45"},
-  {"Dhaka, Bangladesh", "BST-6"},
-  {"Karachi, Pakistan", "PKT-5"},
-  {"Kabul, Afghanistan", "AFT-4:30"},
-  {"Thimphu, Bhutan", "BTT-6"},
-  
-  // ==================== SOUTHEAST ASIA ====================
-  {"Bangkok, Thailand", "ICT-7"},
-  {"Singapore", "SGT-8"},
-  {"Jakarta, Indonesia", "WIB-7"},
-  {"Manila, Philippines", "PHT-8"},
-  {"Kuala Lumpur, Malaysia", "MYT-8"},
-  {"Ho Chi Minh, Vietnam", "ICT-7"},
-  {"Yangon, Myanmar", "MMT-6:30"},
-  
-  // ==================== EAST ASIA ====================
-  {"Hong Kong", "HKT-8"},
-  {"Shanghai, China", "CST-8"},
-  {"Taipei, Taiwan", "CST-8"},
-  {"Tokyo, Japan", "JST-9"},
-  {"Seoul, South Korea", "KST-9"},
-  {"Ulaanbaatar, Mongolia", "ULAT-8"},
-  
-  // ==================== CENTRAL ASIA ====================
-  {"Tashkent, Uzbekistan", "UZT-5"},
-  {"Almaty, Kazakhstan", "ALMT-6"},
-  {"Bishkek, Kyrgyzstan", "KGT-6"},
-  
-  // ==================== CAUCASUS ====================
-  {"Yerevan, Armenia", "AMT-4"},
-  {"Tbilisi, Georgia", "GET-4"},
-  {"Baku, Azerbaijan", "AZT-4"},
-  
-  // ==================== AFRICA ====================
-  {"Johannesburg, South Africa", "SAST-2"},
-  {"Cairo, Egypt", "EET-2"},
-  {"Lagos, Nigeria", "WAT-1"},
-  {"Nairobi, Kenya", "EAT-3"}
+template <size_t N>
+struct TzOffsetTable {
+  uint16_t at[N];
 };
 
-// Calculate number of timezones automatically
-const int numTimezones = sizeof(timezones) / sizeof(timezones[0]);
+template <size_t N>
+constexpr TzOffsetTable<N> tzOffsets(const uint8_t (&sizes)[N]) {
+  TzOffsetTable<N> t = {};
+  uint16_t pos = 0;
+  for (size_t i = 0; i < N; i++) {
+    t.at[i] = pos;
+    pos += sizes[i];
+  }
+  return t;
+}
+
+template <size_t N>
+constexpr uint8_t tzMaxSize(const uint8_t (&sizes)[N]) {
+  uint8_t m = 0;
+  for (size_t i = 0; i < N; i++) m = sizes[i] > m ? sizes[i] : m;
+  return m;
+}
+
+constexpr TzOffsetTable<TZ_RULE_COUNT> tzRuleOffsets PROGMEM = tzOffsets(tzRuleSizes);
+constexpr TzOffsetTable<numTimezones> tzZoneNameOffsets PROGMEM = tzOffsets(tzZoneSizes);
+
+static_assert(tzMaxSize(tzRuleSizes) <= TZ_RULE_MAX, "TZ rule longer than TZ_RULE_MAX");
+static_assert(tzMaxSize(tzZoneSizes) <= TZ_NAME_MAX, "City name longer than TZ_NAME_MAX");
+static_assert(sizeof(tzRuleText) < 65536 && sizeof(tzZoneNames) < 65536, "String pool too large for 16-bit offsets");
+
+// Flash taken by the tables, and the RAM the former {const char*, const char*}
+// array of literals occupied (identical literals merged), reported at boot
+constexpr size_t tzTableFlashBytes = sizeof(tzRuleText) + sizeof(tzZoneNames) + sizeof(tzZoneRules) +
+                                     sizeof(tzRuleOffsets) + sizeof(tzZoneNameOffsets);
+constexpr size_t tzTableRamSavedBytes = numTimezones * 2 * sizeof(const char*) + sizeof(tzZoneNames) +
+                                        sizeof(tzRuleText);
+
+// ======================== ACCESSORS ========================
+// The *P() variants return flash pointers (for FPSTR(), strncpy_P() etc.); the
+// others copy into a caller's buffer of at least TZ_NAME_MAX / TZ_RULE_MAX bytes.
+
+inline uint8_t timezoneRuleId(int i) { return pgm_read_byte(&tzZoneRules[i]); }
+
+inline PGM_P timezoneNameP(int i) { return tzZoneNames + pgm_read_word(&tzZoneNameOffsets.at[i]); }
+
+inline PGM_P timezoneRuleP(int i) { return tzRuleText + pgm_read_word(&tzRuleOffsets.at[timezoneRuleId(i)]); }
+
+inline const char* timezoneName(int i, char* buf) {
+  strncpy_P(buf, timezoneNameP(i), TZ_NAME_MAX);
+  return buf;
+}
+
+inline const char* timezoneRule(int i, char* buf) {
+  strncpy_P(buf, timezoneRuleP(i), TZ_RULE_MAX);
+  return buf;
+}
 
 #endif // TIMEZONES_H
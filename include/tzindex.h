@@ -0,0 +1,132 @@
+#pragma once
+// Timezone search and the cacheable zone list.
+// Every word start in the city-name pool ("New York, USA" has three: "New",
+// "York", "USA") is a key of a word index that the compiler sorts
+// (case-insensitively) into flash. A query is then answered by a binary search for
+// its first key plus a scan over the keys it prefixes: O(log n + matches), with
+// no RAM and no boot-time work, however large TZ_ZONES grows. A query matches a
+// zone if it is a prefix of one of the zone's words, so "york" finds New York.
+// The zone list itself is served straight from the name pool, versioned by a
+// compile-time hash of the pool so browsers can cache it indefinitely.
+
+#include "timezones.h"
+
+// ======================== COMPILE-TIME INDEX ========================
+
+constexpr char tzLower(char c) { return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c; }
+
+// Letters, digits and UTF-8 sequences continue a word; anything else ends it
+constexpr bool tzWordChar(char c) {
+  return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (unsigned char)c >= 0x80;
+}
+
+template <size_t N>
+constexpr bool tzWordStart(const char (&pool)[N], size_t p) {
+  return tzWordChar(pool[p]) && (p == 0 || !tzWordChar(pool[p - 1]));
+}
+
+template <size_t N>
+constexpr size_t tzWordCount(const char (&pool)[N]) {
+  size_t n = 0;
+  for (size_t p = 0; p < N; p++) n += tzWordStart(pool, p);
+  return n;
+}
+
+// Case-insensitive order of the strings at pool positions a and b; ties by position
+template <size_t N>
+constexpr bool tzKeyLess(const char (&pool)[N], uint16_t a, uint16_t b) {
+  for (size_t i = 0;; i++) {
+    char x = tzLower(pool[a + i]);
+    char y = tzLower(pool[b + i]);
+    if (x != y) return (unsigned char)x < (unsigned char)y;
+    if (!x) return a < b;
+  }
+}
+
+// Shell sort (Ciura gaps): a few thousand keys stay well inside constexpr limits
+template <size_t K, size_t N>
+constexpr TzOffsetTable<K> tzWordIndex(const char (&pool)[N]) {
+  TzOffsetTable<K> t = {};
+  size_t k = 0;
+  for (size_t p = 0; p < N; p++) {
+    if (tzWordStart(pool, p)) t.at[k++] = p;
+  }
+  const size_t gaps[] = {701, 301, 132, 57, 23, 10, 4, 1};
+  for (size_t g : gaps) {
+    for (size_t i = g; i < K; i++) {
+      uint16_t key = t.at[i];
+      size_t j = i;
+      for (; j >= g && tzKeyLess(pool, key, t.at[j - g]); j -= g) t.at[j] = t.at[j - g];
+      t.at[j] = key;
+    }
+  }
+  return t;
+}
+
+template <size_t N>
+constexpr uint32_t tzFnv1a(const char (&pool)[N]) {
+  uint32_t h = 2166136261UL;
+  for (size_t i = 0; i < N; i++) h = (h ^ (uint8_t)pool[i]) * 16777619UL;
+  return h;
+}
+
+constexpr size_t tzWordKeys = tzWordCount(tzZoneNames);
+constexpr TzOffsetTable<tzWordKeys> tzWordIndexTable PROGMEM = tzWordIndex<tzWordKeys>(tzZoneNames);
+
+// Changes whenever a zone is added, removed, renamed or moved
+constexpr uint32_t tzZoneListVersion = tzFnv1a(tzZoneNames);
+
+// Bytes of the zone list: the name pool with '\n' for each NUL but the last
+constexpr size_t tzZoneListBytes = sizeof(tzZoneNames) - 1;
+
+// ======================== SEARCH ========================
+
+// Zone whose name contains pool position pos
+inline int tzZoneAt(uint16_t pos) {
+  int lo = 0, hi = numTimezones - 1;
+  while (lo < hi) {
+    int mid = (lo + hi + 1) / 2;
+    if (pgm_read_word(&tzZoneNameOffsets.at[mid]) <= pos) lo = mid;
+    else hi = mid - 1;
+  }
+  return lo;
+}
+
+// 0 if q is a prefix of the key at pos, otherwise the key's order relative to q
+inline int tzKeyCompare(uint16_t pos, const char* q) {
+  for (;; pos++, q++) {
+    if (!*q) return 0;
+    char k = tzLower(pgm_read_byte(tzZoneNames + pos));
+    char c = tzLower(*q);
+    if (k != c) return (unsigned char)k < (unsigned char)c ? -1 : 1;
+  }
+}
+
+// Zones with a word starting with q, in the order of the matching words; writes at
+// most max indices to out and returns the number of matching zones (possibly more)
+inline int timezoneSearch(const char* q, uint16_t* out, int max) {
+  while (*q == ' ') q++;
+  if (!*q) return 0;
+
+  int lo = 0, hi = tzWordKeys;  // First key not below q
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (tzKeyCompare(pgm_read_word(&tzWordIndexTable.at[mid]), q) < 0) lo = mid + 1;
+    else hi = mid;
+  }
+
+  // Several words of one zone may match ("Port Moresby, Papua New Guinea": "p"),
+  // including past max, where out[] no longer shows it
+  uint32_t seen[(numTimezones + 31) / 32] = {};
+  int found = 0;
+  for (int i = lo; i < (int)tzWordKeys; i++) {
+    uint16_t pos = pgm_read_word(&tzWordIndexTable.at[i]);
+    if (tzKeyCompare(pos, q) != 0) break;
+    int zone = tzZoneAt(pos);
+    if (seen[zone / 32] & (1UL << (zone % 32))) continue;
+    seen[zone / 32] |= 1UL << (zone % 32);
+    if (found < max) out[found] = zone;
+    found++;
+  }
+  return found;
+}
@@ -0,0 +1,336 @@
+#pragma once
+// Minimal POSIX TZ rule engine.
+// Parses strings such as "AEST-10AEDT,M10.1.0,M4.1.0/3" (see timezones.h) into a
+// compact struct and converts UTC to local time without touching the global TZ
+// environment, so any number of zones can be evaluated side by side.
+// Plain C++ (no Arduino dependencies) so it also builds on a host.
+
+#include <stdint.h>
+
+enum TzDateKind : uint8_t {
+  TZ_DATE_MONTH_WEEK_DAY = 0,  // Mm.w.d  (w = 5 means "last")
+  TZ_DATE_JULIAN_NO_LEAP,      // Jn      (1-365, Feb 29 never counted)
+  TZ_DATE_JULIAN_ZERO          // n       (0-365, Feb 29 counted in leap years)
+};
+
+struct TzDateRule {
+  TzDateKind kind;
+  uint8_t month;    // 1-12
+  uint8_t week;     // 1-5
+  uint8_t wday;     // 0 = Sunday
+  uint16_t day;     // Julian forms
+  int32_t time;     // Seconds after local midnight (may be negative or > 24h)
+};
+
+struct TzRule {
+  int32_t stdOffset;   // Seconds east of UTC (local = utc + offset); note POSIX sign is reversed
+  int32_t dstOffset;
+  bool hasDst;
+  TzDateRule dstStart; // Switch std -> dst, expressed in local standard time
+  TzDateRule dstEnd;   // Switch dst -> std, expressed in local daylight time
+};
+
+// ======================== CALENDAR HELPERS ========================
+
+inline bool tzIsLeap(int32_t y) {
+  return (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+}
+
+inline int tzDaysInMonth(int32_t y, int m) {
+  static const uint8_t dim[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  return (m == 2 && tzIsLeap(y)) ? 29 : dim[m - 1];
+}
+
+// Days since 1970-01-01 for a proleptic Gregorian date (H. Hinnant's algorithm)
+inline int32_t tzDaysFromCivil(int32_t y, int m, int d) {
+  y -= m <= 2;
+  int32_t era = (y >= 0 ? y : y - 399) / 400;
+  int32_t yoe = y - era * 400;
+  int32_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  int32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+
+inline void tzCivilFromDays(int32_t z, int32_t& y, int& m, int& d) {
+  z += 719468;
+  int32_t era = (z >= 0 ? z : z - 146096) / 146097;
+  int32_t doe = z - era * 146097;
+  int32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  int32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  int32_t mp = (5 * doy + 2) / 153;
+  d = doy - (153 * mp + 2) / 5 + 1;
+  m = mp < 10 ? mp + 3 : mp - 9;
+  y = yoe + era * 400 + (m <= 2);
+}
+
+inline int tzWeekday(int32_t days) {  // 0 = Sunday; 1970-01-01 was a Thursday
+  return (int)((days % 7 + 11) % 7);
+}
+
+inline int32_t tzFloorDiv(int64_t a, int32_t b) {
+  return (int32_t)(a >= 0 ? a / b : -((-a + b - 1) / b));
+}
+
+// ======================== PARSER ========================
+
+namespace tzparse {
+
+inline bool isAlpha(char c) {
+  return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+}
+
+inline bool isDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+inline bool name(const char*& s) {
+  const char* p = s;
+  if (*p == '<') {
+    while (*p && *p != '>') p++;
+    if (*p != '>') return false;
+    s = p + 1;
+    return true;
+  }
+  while (isAlpha(*p)) p++;
+  if (p - s < 3) return false;
+  s = p;
+  return true;
+}
+
+inline bool number(const char*& s, int32_t& v) {
+  if (!isDigit(*s)) return false;
+  v = 0;
+  while (isDigit(*s)) v = v * 10 + (*s++ - '0');
+  return true;
+}
+
+// [+-]hh[:mm[:ss]] -> seconds
+inline bool hms(const char*& s, int32_t& seconds) {
+  int sign = 1;
+  if (*s == '+' || *s == '-') sign = (*s++ == '-') ? -1 : 1;
+  int32_t h, m = 0, sec = 0;
+  if (!number(s, h)) return false;
+  if (*s == ':') {
+    s++;
+    if (!number(s, m)) return false;
+    if (*s == ':') {
+      s++;
+      if (!number(s, sec)) return false;
+    }
+  }
+  seconds = sign * (h * 3600 + m * 60 + sec);
+  return true;
+}
+
+inline bool date(const char*& s, TzDateRule& r) {
+  int32_t a, b, c;
+  r.time = 2 * 3600;  // POSIX default transition time 02:00
+  if (*s == 'M') {
+    s++;
+    if (!number(s, a) || *s++ != '.' || !number(s, b) || *s++ != '.' || !number(s, c)) return false;
+    if (a < 1 || a > 12 || b < 1 || b > 5 || c > 6) return false;
+    r.kind = TZ_DATE_MONTH_WEEK_DAY;
+    r.month = a;
+    r.week = b;
+    r.wday = c;
+  } else if (*s == 'J') {
+    s++;
+    if (!number(s, a) || a < 1 || a > 365) return false;
+    r.kind = TZ_DATE_JULIAN_NO_LEAP;
+    r.day = a;
+  } else {
+    if (!number(s, a) || a > 365) return false;
+    r.kind = TZ_DATE_JULIAN_ZERO;
+    r.day = a;
+  }
+  if (*s == '/') {
+    s++;
+    if (!hms(s, r.time)) return false;
+  }
+  return true;
+}
+
+}  // namespace tzparse
+
+// Returns false for strings the engine does not understand; `rule` is then UTC.
+inline bool tzParse(const char* s, TzRule& rule) {
+  rule = TzRule();
+  if (!s || !tzparse::name(s)) return false;
+  int32_t off;
+  if (!tzparse::hms(s, off)) return false;
+  rule.stdOffset = -off;
+  rule.dstOffset = rule.stdOffset;
+  if (!*s) return true;
+
+  if (!tzparse::name(s)) return false;
+  rule.hasDst = true;
+  rule.dstOffset = rule.stdOffset + 3600;
+  if (*s && *s != ',') {
+    if (!tzparse::hms(s, off)) return false;
+    rule.dstOffset = -off;
+  }
+  if (!*s) {
+    // No explicit dates: POSIX leaves this implementation-defined; use US rules like newlib
+    const char* us = ",M3.2.0,M11.1.0";
+    s = us;
+  }
+  if (*s++ != ',' || !tzparse::date(s, rule.dstStart)) return false;
+  if (*s++ != ',' || !tzparse::date(s, rule.dstEnd)) return false;
+  return *s == '\0';
+}
+
+// ======================== CONVERSION ========================
+
+// Local-midnight day number (days since epoch) that a date rule selects in `year`
+inline int32_t tzRuleDay(const TzDateRule& r, int32_t year) {
+  int32_t jan1 = tzDaysFromCivil(year, 1, 1);
+  switch (r.kind) {
+    case TZ_DATE_JULIAN_NO_LEAP:
+      return jan1 + r.day - 1 + ((tzIsLeap(year) && r.day >= 60) ? 1 : 0);
+    case TZ_DATE_JULIAN_ZERO:
+      return jan1 + r.day;
+    default: {
+      int32_t first = tzDaysFromCivil(year, r.month, 1);
+      int32_t d = first + (r.wday - tzWeekday(first) + 7) % 7 + (r.week - 1) * 7;
+      int32_t last = first + tzDaysInMonth(year, r.month) - 1;
+      while (d > last) d -= 7;
+      return d;
+    }
+  }
+}
+
+// UTC instant of a transition in `year`, given the offset in force before it
+inline int64_t tzTransitionUtc(const TzDateRule& r, int32_t year, int32_t offsetBefore) {
+  return (int64_t)tzRuleDay(r, year) * 86400 + r.time - offsetBefore;
+}
+
+// UTC offset in force at `utc`. If validFrom/validUntil are given they receive the
+// surrounding transition instants, so callers can cache the offset until validUntil.
+inline int32_t tzOffsetAt(const TzRule& rule, int64_t utc, int64_t* validFrom = nullptr, int64_t* validUntil = nullptr) {
+  const int64_t NONE = INT64_MAX;
+  if (!rule.hasDst) {
+    if (validFrom) *validFrom = -NONE;
+    if (validUntil) *validUntil = NONE;
+    return rule.stdOffset;
+  }
+
+  // Transitions of the previous, current and next year bracket any instant
+  int32_t year;
+  int month, day;
+  tzCivilFromDays(tzFloorDiv(utc + rule.stdOffset, 86400), year, month, day);
+
+  int64_t at[6];
+  int32_t after[6];
+  int n = 0;
+  for (int32_t y = year - 1; y <= year + 1; y++) {
+    at[n] = tzTransitionUtc(rule.dstStart, y, rule.stdOffset);
+    after[n++] = rule.dstOffset;
+    at[n] = tzTransitionUtc(rule.dstEnd, y, rule.dstOffset);
+    after[n++] = rule.stdOffset;
+  }
+  // Insertion sort (6 entries)
+  for (int i = 1; i < n; i++) {
+    for (int j = i; j > 0 && at[j] < at[j - 1]; j--) {
+      int64_t t = at[j]; at[j] = at[j - 1]; at[j - 1] = t;
+      int32_t o = after[j]; after[j] = after[j - 1]; after[j - 1] = o;
+    }
+  }
+
+  int i = n - 1;
+  while (i >= 0 && at[i] > utc) i--;
+  // The first transition of year-1 is always before utc for sane rules
+  int32_t offset = (i >= 0) ? after[i] : after[n - 1];
+  if (validFrom) *validFrom = (i >= 0) ? at[i] : -NONE;
+  if (validUntil) *validUntil = (i + 1 < n) ? at[i + 1] : NONE;
+  return offset;
+}
+
+// ======================== TRANSITION TABLES ========================
+// For zones evaluated often, the transitions of a span of years are computed once
+// and kept sorted; a lookup is then a binary search instead of re-deriving the
+// rule dates. Outside the table's span lookups fall back to tzOffsetAt().
+
+struct TzTransition {
+  int64_t at;            // UTC instant
+  int32_t offsetAfter;   // Offset in force from `at` on
+};
+
+// Transitions of years [firstYear, lastYear] in chronological order; returns the
+// number written (2 per year for DST zones, 0 otherwise).
+inline int tzTransitions(const TzRule& rule, int32_t firstYear, int32_t lastYear, TzTransition* out, int maxOut) {
+  if (!rule.hasDst) return 0;
+  int n = 0;
+  for (int32_t y = firstYear; y <= lastYear && n + 2 <= maxOut; y++) {
+    out[n++] = {tzTransitionUtc(rule.dstStart, y, rule.stdOffset), rule.dstOffset};
+    out[n++] = {tzTransitionUtc(rule.dstEnd, y, rule.dstOffset), rule.stdOffset};
+  }
+  // Within a year the end may precede the start (southern hemisphere): insertion sort
+  for (int i = 1; i < n; i++) {
+    for (int j = i; j > 0 && out[j].at < out[j - 1].at; j--) {
+      TzTransition t = out[j]; out[j] = out[j - 1]; out[j - 1] = t;
+    }
+  }
+  return n;
+}
+
+template <int Years>
+struct TzTable {
+  TzRule rule;
+  int32_t firstYear = 0;
+  int count = 0;
+  TzTransition t[2 * Years];
+
+  void build(const TzRule& r, int32_t first) {
+    rule = r;
+    firstYear = first;
+    count = tzTransitions(r, first, first + Years - 1, t, 2 * Years);
+  }
+
+  // True if utc lies strictly inside the span covered by the table
+  bool covers(int64_t utc) const {
+    return count >= 2 && utc >= t[0].at && utc < t[count - 1].at;
+  }
+
+  int32_t offsetAt(int64_t utc, int64_t* validFrom = nullptr, int64_t* validUntil = nullptr) const {
+    if (!covers(utc)) return tzOffsetAt(rule, utc, validFrom, validUntil);
+    // Last transition at or before utc
+    int lo = 0, hi = count - 1;
+    while (lo < hi) {
+      int mid = (lo + hi + 1) / 2;
+      if (t[mid].at <= utc) lo = mid; else hi = mid - 1;
+    }
+    if (validFrom) *validFrom = t[lo].at;
+    if (validUntil) *validUntil = t[lo + 1].at;
+    return t[lo].offsetAfter;
+  }
+};
+
+// ======================== LOCAL DAY ========================
+// The UTC window in which the local date and UTC offset are both constant: from the
+// later of local midnight and the last transition, to the earlier of the next
+// midnight and the next transition. Inside it the time of day is utc - midnight, so
+// a clock only re-evaluates its zone when time leaves the window.
+
+struct TzLocalDay {
+  int64_t midnight;    // UTC of local 00:00 at the window's offset
+  int64_t from;        // Window is from <= utc < until; from > midnight on a transition day
+  int64_t until;
+  int32_t year;
+  int month, day;
+  int weekday;         // 0 = Sunday
+
+  bool contains(int64_t utc) const { return utc >= from && utc < until; }
+};
+
+// Window around utc, given the offset in force and its validity (from tzOffsetAt()
+// or TzTable::offsetAt())
+inline TzLocalDay tzLocalDay(int64_t utc, int32_t offset, int64_t validFrom, int64_t validUntil) {
+  TzLocalDay d;
+  int32_t days = tzFloorDiv(utc + offset, 86400);
+  tzCivilFromDays(days, d.year, d.month, d.day);
+  d.weekday = tzWeekday(days);
+  d.midnight = (int64_t)days * 86400 - offset;
+  d.from = d.midnight > validFrom ? d.midnight : validFrom;
+  d.until = d.midnight + 86400 < validUntil ? d.midnight + 86400 : validUntil;
+  return d;
+}
@@ -20,11 +20,30 @@
 #include <Adafruit_BME280.h>
 
 #include <ArduinoOTA.h>
+#include <EEPROM.h>
+extern "C" {
+#include <user_interface.h>  // system_get_rtc_time()
+}
 #include "config.h"   // user-tuneable constants — must come before max7219.h
 #include "debug.h"
 #include "max7219.h"
 #include "fonts.h"
+#include "prerender.h"
+#include "fieldformat.h"
 #include "timezones.h"
+#include "tzindex.h"
+#include "tzrules.h"
+#include "httpstream.h"
+#include "jsonstream.h"
+#include "icalstream.h"
+#include "calendarfeed.h"
+#include "clockdiscipline.h"
+#include "sntpclient.h"
+#include "timesource.h"
+#include "ds3231.h"
+#include "tempcomp.h"
+#include "fleetsync.h"
+#include "rtcsnapshot.h"
 
 // ======================== OBJECTS & GLOBALS ========================
 
@@ -41,22 +60,38 @@ WiFiManager wifiManager;
 int hours, minutes, seconds;
 int hours24;                       // 24-hour clock for schedule logic
 int day, month, year, dayOfWeek;
-bool showDots = true;
+bool showDots = true;              // Colon phase: on for the first half of each (display) second
+int64_t timeSampledUs = 0;         // displayNowUs() at the last updateTime()
+bool clockValid = false;           // False until the first successful time sync
 
 // Time format
-// NOTE: In 24-hour mode we intentionally do NOT render seconds on the 32x16 LED matrix.
-// With this project’s current fonts/layout, "HH:MM:SS" cannot reliably fit in 32px width.
+// Which fonts are used (and whether seconds are shown) is decided by the layout solver,
+// see TIME LAYOUT SOLVER below.
 bool use24HourFormat = false;      // false = 12-hour (default), true = 24-hour
 
 // Display Variables
 int xPos = 0, yPos = 0;
-int currentMode = 0;
-char txt[32];
+int currentMode = 0;                   // Index into displayModes[]
+int modeCyclePos = 0;                  // Position in modeCycle[]
+unsigned long lastFrameSlot = 0;       // Frame slot (see serviceDisplayModes) of the last render
+int lastRenderedSecond = -1;
+bool redrawRequested = true;
+int pinnedMode = -1;                   // >= 0 suspends the cycle (e.g. while a timer runs)
+int resumeMode = 0;                    // Mode to return to after a notification
 
 // Sensor Data
 int temperature = 0;
+int temperatureDeci = 0;       // Temperature in 0.1 C, feeds the sparkline history
 int humidity = 0;
 int pressure = 0;              // Pressure in hPa (BME280/BMP280)
+int pressureDeci = 0;          // Pressure in 0.1 hPa, feeds the trend/forecast history
+int pressureTrend = 0;         // 0.1 hPa per 3 hours
+uint8_t forecastCode = 0;      // Zambretti number 1-32, 0 = not enough history yet
+
+// Sensor history sparkline (see SENSOR HISTORY & SPARKLINE)
+enum SparklineMetric { SPARK_TEMPERATURE = 0, SPARK_HUMIDITY, SPARK_PRESSURE };
+SparklineMetric sparklineMetric = SPARK_TEMPERATURE;
+uint8_t sparklineColumns[LINE_WIDTH];  // Bottom-band bitmaps, bit 0 = top row
 bool sensorAvailable = false;
 
 // Display Control
@@ -94,21 +129,36 @@ bool useFahrenheit = false;             // false = Celsius (default), true = Fah
 
 // Timezone Configuration
 int currentTimezone = 0;                // Index into timezone array (0 = Australia/Sydney by default)
+TzTable<4> localZone;                   // Rule and transition table of the current timezone
+bool localZoneValid = false;            // False: tzParse() failed, fall back to localtime()
+
+// Pre-rendered status messages (see prerender.h)
+constexpr FrameImage MSG_WIFI PROGMEM       = prerenderText("WIFI...", font3x7);
+constexpr FrameImage MSG_WIFI_FAIL PROGMEM  = prerenderText("WIFI FAIL", font3x7);
+constexpr FrameImage MSG_SYNC_TIME PROGMEM  = prerenderText("SYNC TIME", font3x7);
+constexpr FrameImage MSG_READY PROGMEM      = prerenderText("READY!", font3x7);
+constexpr FrameImage MSG_SETUP_AP PROGMEM   = prerenderText("SETUP AP", font3x7);
+constexpr FrameImage MSG_LED_CLOCK PROGMEM  = prerenderText("LED CLOCK", font3x7);
 
 // Timing
-unsigned long lastNTPUpdate = 0;
 unsigned long startupTime = 0;
 unsigned long lastModeChange = 0;
+unsigned long lastBrightnessUpdate = 0;
+unsigned long lastSensorUpdate = 0;
+unsigned long lastRtcSnapshot = 0;
+unsigned long lastTempCompSave = 0;
 
 // ======================== FONT HELPER FUNCTIONS ========================
 
 int charWidth(char c, const uint8_t* font) {
+  int fwd = pgm_read_byte(font);
+  int fht = pgm_read_byte(font + 1);
   int offs = pgm_read_byte(font + 2);
   int last = pgm_read_byte(font + 3);
   if (c < offs || c > last) return 0;
   c -= offs;
-  int len = pgm_read_byte(font + 4);
-  return pgm_read_byte(font + 5 + c * len);
+  int fht8 = (fht + 7) / 8;
+  return pgm_read_byte(font + 4 + c * (fht8 * fwd + 1));
 }
 
 int printCharX(char ch, const uint8_t* font, int x) {
@@ -140,6 +190,137 @@ void printString(const char* s, const uint8_t* font) {
   while (*s) printChar(*s++, font);
 }
 
+// ======================== FIELD FORMATTERS ========================
+// The fieldformat.h formatters, drawing each glyph with printChar()
+
+template <uint8_t Digits>
+void printPadded(int value, const uint8_t* font) {
+  formatPadded<Digits>(value, [font](char c) { printChar(c, font); });
+}
+
+void printNumber(int value, const uint8_t* font) {
+  formatNumber(value, [font](char c) { printChar(c, font); });
+}
+
+void printSigned(int value, const uint8_t* font) {
+  formatSigned(value, [font](char c) { printChar(c, font); });
+}
+
+void printMonth(int month, const uint8_t* font) {
+  formatMonth(month, [font](char c) { printChar(c, font); });
+}
+
+// ======================== TIME LAYOUT SOLVER ========================
+// Picks the largest font combination for "H:MM[:SS]" that fits LINE_WIDTH.
+// Solutions are computed once at boot for every (area, format, hour digit count)
+// key, so rendering a frame is just a table lookup.
+
+enum LayoutArea {
+  LAYOUT_TOP_LINE = 0,  // Time on the top 8 rows, second line used for other data
+  LAYOUT_FULL,          // Time may use all 16 rows
+  LAYOUT_AREA_COUNT
+};
+
+struct FontMetrics {
+  const uint8_t* font;
+  uint8_t maxDigit;    // Widest of '0'-'9'
+  uint8_t maxTens12;   // Widest hour tens digit in 12-hour mode ('1')
+  uint8_t maxTens24;   // Widest hour tens digit in 24-hour mode ('0'-'2')
+};
+
+struct TimeLayout {
+  const uint8_t* digitFont;    // Hours and minutes
+  const uint8_t* secondsFont;  // nullptr = seconds omitted
+  int8_t x;                    // Left edge of the (centred) time
+  uint8_t colonAdvance;        // 2 = colon + gap, 1 = tight colon
+};
+
+// Candidate fonts per area, largest first
+const uint8_t* const topLineDigitFonts[] = {digits5x8rn};
+const uint8_t* const fullDigitFonts[] = {digits7x16, digits5x16rn};
+const uint8_t* const topLineSecondsFont = digits3x5;
+const uint8_t* const fullSecondsFont = font3x7;  // Drawn on the top rows, beside the minutes
+
+TimeLayout timeLayouts[LAYOUT_AREA_COUNT][2][2];  // [area][use24Hour][hourDigits - 1]
+
+FontMetrics measureFont(const uint8_t* font) {
+  FontMetrics m = {font, 0, 0, 0};
+  for (char c = '0'; c <= '9'; c++) {
+    uint8_t w = charWidth(c, font);
+    m.maxDigit = max(m.maxDigit, w);
+    if (c <= '2') m.maxTens24 = max(m.maxTens24, w);
+  }
+  m.maxTens12 = charWidth('1', font);
+  return m;
+}
+
+// Worst-case pixel width of a layout (trailing inter-glyph gap excluded)
+int layoutWidth(const FontMetrics& d, const FontMetrics* s, bool use24Hour, int hourDigits, int colonAdvance) {
+  int w = d.maxDigit + 1;
+  if (hourDigits == 2) w += (use24Hour ? d.maxTens24 : d.maxTens12) + 1;
+  w += colonAdvance + 2 * (d.maxDigit + 1);
+  if (s) w += 2 * (s->maxDigit + 1);
+  return w - 1;
+}
+
+// Preference order: bigger digits, then showing seconds, then a normal colon gap.
+TimeLayout solveTimeLayout(LayoutArea area, bool use24Hour, int hourDigits) {
+  const uint8_t* const* fonts = (area == LAYOUT_FULL) ? fullDigitFonts : topLineDigitFonts;
+  int numFonts = (area == LAYOUT_FULL) ? sizeof(fullDigitFonts) / sizeof(fullDigitFonts[0])
+                                       : sizeof(topLineDigitFonts) / sizeof(topLineDigitFonts[0]);
+  FontMetrics secs = measureFont((area == LAYOUT_FULL) ? fullSecondsFont : topLineSecondsFont);
+
+  for (int f = 0; f < numFonts; f++) {
+    FontMetrics digits = measureFont(fonts[f]);
+    for (int withSeconds = 1; withSeconds >= 0; withSeconds--) {
+      for (int colon = 2; colon >= 1; colon--) {
+        int w = layoutWidth(digits, withSeconds ? &secs : nullptr, use24Hour, hourDigits, colon);
+        if (w <= LINE_WIDTH) {
+          return {fonts[f], withSeconds ? secs.font : nullptr, (int8_t)((LINE_WIDTH - w) / 2), (uint8_t)colon};
+        }
+      }
+    }
+  }
+  // Nothing fits: fall back to the smallest font without seconds
+  return {fonts[numFonts - 1], nullptr, 0, 1};
+}
+
+void initTimeLayouts() {
+  for (int area = 0; area < LAYOUT_AREA_COUNT; area++) {
+    for (int fmt = 0; fmt < 2; fmt++) {
+      for (int digits = 1; digits <= 2; digits++) {
+        TimeLayout& l = timeLayouts[area][fmt][digits - 1];
+        l = solveTimeLayout((LayoutArea)area, fmt, digits);
+        DBG_VERBOSE("Layout area=%d %dh digits=%d: x=%d colon=%d seconds=%s",
+                    area, fmt ? 24 : 12, digits, l.x, l.colonAdvance, l.secondsFont ? "yes" : "no");
+      }
+    }
+  }
+}
+
+// Draws a time (h24 in 0-23) in the given area using the cached layout
+void printTime(LayoutArea area, int h24, int m, int sec) {
+  int h = use24HourFormat ? h24 : ((h24 == 0) ? 12 : (h24 > 12) ? h24 - 12 : h24);
+  int hourDigits = (use24HourFormat || h > 9) ? 2 : 1;
+  const TimeLayout& l = timeLayouts[area][use24HourFormat][hourDigits - 1];
+
+  xPos = l.x;
+  if (use24HourFormat) {
+    printPadded<2>(h, l.digitFont);
+  } else {
+    printNumber(h, l.digitFont);
+  }
+  if (showDots) printCharX(':', l.digitFont, xPos);
+  xPos += l.colonAdvance;
+  printPadded<2>(m, l.digitFont);
+  if (l.secondsFont) printPadded<2>(sec, l.secondsFont);
+}
+
+// Draws the current local time
+void printTime(LayoutArea area) {
+  printTime(area, hours24, minutes, seconds);
+}
+
 // ======================== TEMPERATURE HELPER FUNCTION ========================
 
 int getDisplayTemperature() {
@@ -157,9 +338,31 @@ char getTempUnit() {
 
 void printBanner();
 void showMessage(const char* message);
+void showMessage(const FrameImage& image);
 void testSensor();
 void updateSensorData();
-bool syncNTP();
+void recordPressureSample(int deciHpa);
+const char* forecastLabel();
+void recordHistorySample();
+void requestNtpSync();
+bool setNtpServers(const char* list);
+void applyTimezone(int index);
+int32_t localOffsetAt(int64_t utc);
+void saveRtcSnapshot();
+bool restoreRtcSnapshot();
+void initTimeSources();
+void loadTempComp();
+void saveTempComp();
+void tempCompTemperature(bool valid);
+void tempCompSync(const TimeSample& t);
+void serviceTimeSources();
+int64_t clockNowUs();
+int64_t displayNowUs();
+int64_t fleetOffsetUs();
+void serviceFleet();
+void restartModeCycle();
+int scheduledCyclePos(int64_t ms);
+void serviceNtp(unsigned long now);
 void updateTime();
 void handleBrightnessAndMotion();
 void setupWebServer();
@@ -168,6 +371,27 @@ void printStatus();
 void displayTimeAndTemp();
 void displayTimeLarge();
 void displayTimeAndDate();
+void displayWorldClock();
+void displayStopwatch();
+void displayCountdown();
+void displayPressure();
+void displaySparkline();
+void displayTicker();
+void displayWeather();
+void displayCalendar();
+unsigned long tickerFrameSlot();
+bool serviceNotifications();
+unsigned long stopwatchFrameSlot();
+unsigned long countdownFrameSlot();
+void initWorldClock();
+void renderCurrentMode();
+void serviceDisplayModes(unsigned long now);
+bool timerTicking();
+void timerRebase(int64_t shiftMs);
+void idleUntilNextFrame();
+void serviceWeather(unsigned long now);
+void serviceCalendar(unsigned long now);
+bool setCalendarUrl(const char* url);
 
 // Centralized display power/intensity application
 int updateAmbientLightReading();
@@ -192,33 +416,51 @@ void setup()
   initMAX7219();
   sendCmdAll(CMD_SHUTDOWN, 1);
   sendCmdAll(CMD_INTENSITY, 5);
+  initTimeLayouts();
+  initWorldClock();
+  setCalendarUrl(CALENDAR_URL);
 
   // Initialize I2C and BME280
   DBG_INFO("Initializing I2C and BME280 sensor");
   Wire.begin();
   delay(100);
   testSensor();
+  loadTempComp();
+
+  // Warm restart or RTC chip: show the clock straight away, NTP corrects it in the background
+  initTimeSources();
+  bool warmStart = restoreRtcSnapshot();
+  serviceTimeSources();
+  applyTimezone(currentTimezone);
+  if (clockValid) renderCurrentMode();
 
   // Initialize PIR
   pinMode(PIR_PIN, INPUT);
   DBG_INFO("PIR sensor initialized");
 
   // WiFiManager setup
-  showMessage("WIFI...");
+  if (!clockValid) showMessage(MSG_WIFI);
   DBG_INFO("Starting WiFi Manager");
   wifiManager.setConfigPortalTimeout(180);
   wifiManager.setAPCallback(configModeCallback);
 
   if (!wifiManager.autoConnect(WIFI_AP_NAME)) {
-    DBG_ERROR("WiFi failed to connect, restarting");
-    showMessage("WIFI FAIL");
-    delay(3000);
-    ESP.restart();
+    if (clockValid) {
+      // Another time source keeps the clock going; the station reconnects on its own
+      DBG_WARN("WiFi failed to connect, running offline");
+    } else {
+      DBG_ERROR("WiFi failed to connect, restarting");
+      showMessage(MSG_WIFI_FAIL);
+      delay(3000);
+      ESP.restart();
+    }
+  } else {
+    DBG_INFO("WiFi connected: %s", WiFi.localIP().toString().c_str());
+  }
+  if (!warmStart && WiFi.status() == WL_CONNECTED) {
+    showMessage(WiFi.localIP().toString().c_str());
+    delay(2000);
   }
-
-  DBG_INFO("WiFi connected: %s", WiFi.localIP().toString().c_str());
-  showMessage(WiFi.localIP().toString().c_str());
-  delay(2000);
 
   // OTA setup
   ArduinoOTA.setHostname(OTA_HOSTNAME);
@@ -229,6 +471,7 @@ void setup()
   });
   ArduinoOTA.onEnd([]() {
     DBG_INFO("OTA complete");
+    saveRtcSnapshot();
   });
   ArduinoOTA.onProgress([](unsigned int progress, unsigned int total) {
     DBG_VERBOSE("OTA: %u%%", progress * 100 / total);
@@ -239,13 +482,10 @@ void setup()
   ArduinoOTA.begin();
   DBG_INFO("OTA ready: hostname=%s", OTA_HOSTNAME);
 
-  // NTP sync
-  showMessage("SYNC TIME");
-  if (syncNTP()) {
-    DBG_INFO("Time synchronized");
-  } else {
-    DBG_WARN("Time sync failed, will retry");
-  }
+  // NTP sync: completes in the background, loop() shows "SYNC TIME" until then
+  if (!clockValid) showMessage(MSG_SYNC_TIME);
+  setNtpServers(NTP_SERVERS);
+  requestNtpSync();
 
   updateSensorData();
 
@@ -253,8 +493,10 @@ void setup()
   server.begin();
   DBG_INFO("Web server started");
 
-  showMessage("READY!");
-  delay(1000);
+  if (!clockValid) {
+    showMessage(MSG_READY);
+    delay(1000);
+  }
 
   DBG_INFO("Setup complete");
 }
@@ -269,202 +511,1774 @@ void loop()
   server.handleClient();
   ArduinoOTA.handle();
 
-  // Periodic NTP sync
-  if (currentMillis - lastNTPUpdate >= NTP_UPDATE_INTERVAL) {
-    lastNTPUpdate = currentMillis;
-    DBG_INFO("Periodic update");
-    syncNTP();
-    if (SENSOR_UPDATE_WITH_NTP) {
-      updateSensorData();
+  // NTP sync state machine (periodic re-sync, timeout and retry backoff)
+  serviceNtp(currentMillis);
+  serviceTimeSources();
+
+  // Beacons to / from the other clocks on the network (shared second ticks)
+  serviceFleet();
+
+  // Periodic sensor read (independent of NTP so the pressure history is evenly spaced)
+  if (currentMillis - lastSensorUpdate >= SENSOR_UPDATE_INTERVAL) {
+    updateSensorData();
+  }
+
+  // Keep the warm-restart snapshot fresh (covers watchdog and exception resets)
+  if (currentMillis - lastRtcSnapshot >= RTC_SNAPSHOT_INTERVAL) {
+    saveRtcSnapshot();
+  }
+
+  // Persist newly learned crystal drift (rarely: flash wear)
+  if (currentMillis - lastTempCompSave >= TEMPCOMP_SAVE_INTERVAL) {
+    saveTempComp();
+  }
+
+  // Outdoor weather / calendar fetches (incremental, a few hundred bytes per pass)
+  serviceWeather(currentMillis);
+  serviceCalendar(currentMillis);
+
+  // Update current time (and the colon phase)
+  updateTime();
+
+  // Handle brightness and motion detection (may change displayOn).
+  // Runs on its own fixed tick: the motion timer counts these calls.
+  if (currentMillis - lastBrightnessUpdate >= BRIGHTNESS_MOTION_INTERVAL) {
+    lastBrightnessUpdate = currentMillis;
+    handleBrightnessAndMotion();
+  }
+
+  // Cycle display modes and render at the current mode's frame rate
+  serviceDisplayModes(currentMillis);
+  
+  // Status output (throttled, gated by DBG_INFO inside printStatus)
+  static unsigned long lastDebug = 0;
+  if (currentMillis - lastDebug > 2000) {
+    lastDebug = currentMillis;
+    printStatus();
+  }
+  
+  // Idle, or wait out the last few ms to the next half second and render right on it
+  idleUntilNextFrame();
+}
+
+// ======================== FRAME TIMING ========================
+// Histogram of frame-to-frame periods of the running stopwatch/countdown (the 10 Hz
+// frames only), exposed by /api/timer.
+
+const uint16_t framePeriodBoundsMs[] = {80, 90, 98, 102, 110, 120, 200};
+const int numFramePeriodBuckets = sizeof(framePeriodBoundsMs) / sizeof(framePeriodBoundsMs[0]) + 1;
+uint32_t framePeriodHist[numFramePeriodBuckets];
+uint32_t lastFrameMicros = 0;
+uint32_t maxFramePeriodUs = 0;
+
+void resetFramePeriodStats() {
+  memset(framePeriodHist, 0, sizeof(framePeriodHist));
+  lastFrameMicros = 0;
+  maxFramePeriodUs = 0;
+}
+
+void recordFramePeriod(uint32_t nowUs) {
+  if (lastFrameMicros != 0) {
+    uint32_t period = nowUs - lastFrameMicros;
+    // A gap of more than a second means rendering was paused, not jitter
+    if (period < 1000000) {
+      int b = 0;
+      while (b < numFramePeriodBuckets - 1 && period >= framePeriodBoundsMs[b] * 1000UL) b++;
+      framePeriodHist[b]++;
+      maxFramePeriodUs = max(maxFramePeriodUs, period);
     }
   }
+  lastFrameMicros = nowUs;
+}
+
+// ======================== SECOND ALIGNMENT ========================
+// The clock face changes on second (digits) and half-second (colon) boundaries of the
+// display timebase (the clock, shifted onto the fleet leader's; see FLEET SYNC).
+// When one is less than an idle period away, the loop waits for it and renders at
+// once, so the digits flip within about a millisecond of the true second instead of
+// whenever the next loop pass happens to run. The flip latency (second boundary to
+// frame pushed out) is histogrammed for /api/flip.
+
+const uint16_t flipLatencyBoundsUs[] = {250, 500, 1000, 2000, 5000, 10000, 50000};
+const int numFlipLatencyBuckets = sizeof(flipLatencyBoundsUs) / sizeof(flipLatencyBoundsUs[0]) + 1;
+uint32_t flipLatencyHist[numFlipLatencyBuckets];
+uint32_t maxFlipLatencyUs = 0;
+uint32_t flipCount = 0;
+
+void resetFlipLatencyStats() {
+  memset(flipLatencyHist, 0, sizeof(flipLatencyHist));
+  maxFlipLatencyUs = 0;
+  flipCount = 0;
+}
+
+void recordFlipLatency(uint32_t latencyUs) {
+  int b = 0;
+  while (b < numFlipLatencyBuckets - 1 && latencyUs >= flipLatencyBoundsUs[b]) b++;
+  flipLatencyHist[b]++;
+  maxFlipLatencyUs = max(maxFlipLatencyUs, latencyUs);
+  flipCount++;
+}
+
+void idleUntilNextFrame() {
+  int64_t now = displayNowUs();
+  int64_t boundary = (now / 500000 + 1) * 500000;
+  int64_t wait = boundary - now;
+  if (wait > LOOP_IDLE_DELAY * 1000L + FLIP_SPIN_US) {
+    delay(LOOP_IDLE_DELAY);
+    return;
+  }
+
+  // Sleep (yielding to WiFi) until shortly before the boundary, then spin onto it
+  if (wait > FLIP_SPIN_US) delay((wait - FLIP_SPIN_US) / 1000);
+  while (displayNowUs() < boundary) delayMicroseconds(20);
 
-  // Update current time
   updateTime();
+  serviceDisplayModes(millis());
+}
 
-  // Blink dots (2 Hz)
-  showDots = (currentMillis % 1000) < 500;
+// ======================== DISPLAY MODE REGISTRY ========================
+
+struct DisplayMode {
+  const char* name;
+  void (*render)();
+  unsigned long dwellMs;       // Time on screen per pass through the cycle
+  uint16_t frameIntervalMs;    // Render period: 1000 = 1 Hz, 500 = 2 Hz (dots), 100 = 10 Hz
+  bool enabled;
+  unsigned long (*frameSlot)();  // Optional frame clock; nullptr = millis() / frameIntervalMs
+};
+
+// The registry: id, name, render, dwell, frame interval, enabled, frame slot.
+// Modes past Time+Date are not in the default cycle.
+#define DISPLAY_MODES(X) \
+  X(TIME_TEMP,  "Time+Temp",   displayTimeAndTemp, MODE_CYCLE_TIME, 500, true, nullptr) \
+  X(TIME_LARGE, "Large Time",  displayTimeLarge,   MODE_CYCLE_TIME, 500, true, nullptr) \
+  X(TIME_DATE,  "Time+Date",   displayTimeAndDate, MODE_CYCLE_TIME, 500, true, nullptr) \
+  X(WORLD,      "World Clock", displayWorldClock,  MODE_CYCLE_TIME, 500, true, nullptr) \
+  X(STOPWATCH,  "Stopwatch",   displayStopwatch,   MODE_CYCLE_TIME, 100, true, stopwatchFrameSlot) \
+  X(COUNTDOWN,  "Countdown",   displayCountdown,   MODE_CYCLE_TIME, 100, true, countdownFrameSlot) \
+  X(PRESSURE,   "Pressure",    displayPressure,    MODE_CYCLE_TIME, 1000, true, nullptr) \
+  X(SPARKLINE,  "Sparkline",   displaySparkline,   MODE_CYCLE_TIME, 1000, true, nullptr) \
+  X(TICKER,     "Ticker",      displayTicker,      MODE_CYCLE_TIME, TICKER_PIXEL_MS, true, tickerFrameSlot) /* Notifications only */ \
+  X(WEATHER,    "Weather",     displayWeather,     MODE_CYCLE_TIME, 1000, true, nullptr) \
+  X(CALENDAR,   "Calendar",    displayCalendar,    MODE_CYCLE_TIME, 1000, true, nullptr)
+
+// Mode ids follow the registry order, so reordering it cannot misnumber them
+#define X(id, ...) MODE_##id,
+enum DisplayModeId { DISPLAY_MODES(X) };
+#undef X
+
+#define X(id, ...) {__VA_ARGS__},
+DisplayMode displayModes[] = { DISPLAY_MODES(X) };
+#undef X
+const int numDisplayModes = sizeof(displayModes) / sizeof(displayModes[0]);
+
+// Cycle order (indices into displayModes[]), configurable via /modes
+uint8_t modeCycle[MODE_CYCLE_MAX] = {0, 1, 2};
+int modeCycleLength = 3;
+
+void setDisplayMode(int mode) {
+  if (mode != currentMode) {
+    DBG_VERBOSE("Display mode: %s", displayModes[mode].name);
+  }
+  currentMode = mode;
+  lastModeChange = millis();
+  redrawRequested = true;
+}
 
-  // Cycle display modes
-  int newMode = (currentMillis % (MODE_CYCLE_TIME * 3)) / MODE_CYCLE_TIME;
-  if (newMode != currentMode) {
-    currentMode = newMode;
-    DBG_VERBOSE("Display mode: %d", currentMode);
+// Advance to the next enabled entry of the cycle list; stays put if none is enabled.
+void advanceModeCycle() {
+  for (int step = 1; step <= modeCycleLength; step++) {
+    int pos = (modeCyclePos + step) % modeCycleLength;
+    if (displayModes[modeCycle[pos]].enabled) {
+      modeCyclePos = pos;
+      setDisplayMode(modeCycle[pos]);
+      return;
+    }
   }
+  lastModeChange = millis();
+}
 
-  // Handle brightness and motion detection (may change displayOn)
-  handleBrightnessAndMotion();
+void renderCurrentMode() {
+  displayModes[currentMode].render();
+  refreshAll();
+}
+
+// Renders only when the mode's frame slot rolls over, the displayed second changes,
+// or a redraw was requested, instead of on every loop pass. Default frame slots are
+// counted on the display time sampled by updateTime(), so they roll over together
+// with the seconds digit and the colon phase.
+void serviceDisplayModes(unsigned long now) {
+  if (serviceNotifications()) {
+    // A queued notification preempts the cycle (and a pinned timer) while it scrolls
+    if (currentMode != MODE_TICKER) {
+      resumeMode = currentMode;
+      setDisplayMode(MODE_TICKER);
+    }
+  } else if (currentMode == MODE_TICKER) {
+    setDisplayMode(resumeMode);
+  } else if (pinnedMode >= 0) {
+    if (currentMode != pinnedMode) setDisplayMode(pinnedMode);
+  } else if (clockValid) {
+    // Scheduled on the display timebase, so a fleet of clocks changes mode together
+    int pos = scheduledCyclePos(timeSampledUs / 1000);
+    if (pos >= 0 && (pos != modeCyclePos || currentMode != modeCycle[pos])) {
+      modeCyclePos = pos;
+      setDisplayMode(modeCycle[pos]);
+    }
+  } else {
+    const DisplayMode& mode = displayModes[currentMode];
+    if (now - lastModeChange >= mode.dwellMs || !mode.enabled) {
+      advanceModeCycle();
+    }
+  }
 
   // Only render/refresh when display is actually ON.
   // This prevents needless SPI updates and avoids any weird state thrashing.
-  if (displayOn) {
-    switch (currentMode) {
-      case 0: displayTimeAndTemp(); break;
-      case 1: displayTimeLarge(); break;
-      case 2: displayTimeAndDate(); break;
+  if (!displayOn) return;
+
+  // Nothing sensible to show before the first sync (notifications still scroll)
+  if (!clockValid && currentMode != MODE_TICKER) {
+    if (redrawRequested) showMessage(MSG_SYNC_TIME);
+    redrawRequested = false;
+    return;
+  }
+
+  const DisplayMode& mode = displayModes[currentMode];
+  unsigned long slot = mode.frameSlot ? mode.frameSlot() : timeSampledUs / 1000 / mode.frameIntervalMs;
+  if (redrawRequested || slot != lastFrameSlot || seconds != lastRenderedSecond) {
+    renderCurrentMode();
+    if (timerTicking() && !redrawRequested) {
+      recordFramePeriod(micros());
+    } else {
+      lastFrameMicros = 0;  // Not a 10 Hz frame: the next period starts afresh
+    }
+    if (seconds == (lastRenderedSecond + 1) % 60 && !redrawRequested) {
+      recordFlipLatency(displayNowUs() - timeSampledUs / 1000000 * 1000000);
     }
-    refreshAll();
+    lastFrameSlot = slot;
+    lastRenderedSecond = seconds;
+    redrawRequested = false;
   }
+}
+
+// ======================== DISPLAY FUNCTIONS ========================
+
+void displayTimeAndTemp() {
+  clr();
+
+  // Top line: Time
+  yPos = 0;
+  printTime(LAYOUT_TOP_LINE);
   
-  // Status output (throttled, gated by DBG_INFO inside printStatus)
-  static unsigned long lastDebug = 0;
-  if (currentMillis - lastDebug > 2000) {
-    lastDebug = currentMillis;
-    printStatus();
+  // Bottom line: Temperature and Humidity
+  yPos = 1;
+  xPos = 1;
+  if (sensorAvailable) {
+    // "T<temp><unit> H<humidity>%"
+    printChar('T', font3x7);
+    printSigned(getDisplayTemperature(), font3x7);
+    printChar(getTempUnit(), font3x7);
+    printChar(' ', font3x7);
+    printChar('H', font3x7);
+    printNumber(humidity, font3x7);
+    printChar('%', font3x7);
+  } else {
+    printString("NO SENSOR", font3x7);
+  }
+  
+  // Shift bottom line slightly
+  for (int i = 0; i < LINE_WIDTH; i++) scr[LINE_WIDTH + i] <<= 1;
+}
+
+void displayTimeLarge() {
+  clr();
+  yPos = 0;
+  printTime(LAYOUT_FULL);
+}
+
+void displayTimeAndDate() {
+  clr();
+
+  // Top line: Time
+  yPos = 0;
+  printTime(LAYOUT_TOP_LINE);
+  
+  // Bottom line: Date
+  yPos = 1;
+  xPos = 1;
+  // "<day>&<MON>&<YY>" ('&' is a zero-width glyph, i.e. a 1px spacer)
+  printNumber(day, font3x7);
+  printChar('&', font3x7);
+  printMonth(month, font3x7);
+  printChar('&', font3x7);
+  printPadded<2>(year % 100, font3x7);
+  
+  // Shift bottom line slightly
+  for (int i = 0; i < LINE_WIDTH; i++) scr[LINE_WIDTH + i] <<= 1;
+}
+
+// ======================== WORLD CLOCK ========================
+// Each configured zone keeps its parsed TZ rule plus the offset in force and the
+// UTC window it is valid for. Rendering is then an addition on one UTC timestamp;
+// the rule is only re-evaluated when a DST transition is crossed.
+
+struct WorldZone {
+  uint8_t tzIndex;        // Timezone index (TZ_ZONES order)
+  char abbrev[4];         // City abbreviation, e.g. "SYD", "NY"
+  TzRule rule;
+  int32_t offset;         // Cached UTC offset (seconds)
+  int64_t validFrom;      // Offset is valid for validFrom <= utc < validUntil
+  int64_t validUntil;
+};
+
+const uint8_t defaultWorldZones[] = {WORLD_CLOCK_ZONES};
+WorldZone worldZones[WORLD_CLOCK_MAX_ZONES];
+int numWorldZones = 0;
+
+// "Sydney, Australia" -> "SYD", "New York, USA" -> "NY"
+void cityAbbrev(const char* name, char* out) {
+  int n = 0;
+  bool multiWord = false;
+  for (const char* p = name; *p && *p != ','; p++) {
+    if (*p == ' ') multiWord = true;
+  }
+  bool wordStart = true;
+  for (const char* p = name; *p && *p != ',' && n < 3; p++) {
+    if (*p == ' ') {
+      wordStart = true;
+      continue;
+    }
+    if (!multiWord || wordStart) out[n++] = toupper(*p);
+    wordStart = false;
+  }
+  out[n] = '\0';
+}
+
+void setWorldZones(const uint8_t* indices, int count) {
+  numWorldZones = 0;
+  for (int i = 0; i < count && numWorldZones < WORLD_CLOCK_MAX_ZONES; i++) {
+    if (indices[i] >= numTimezones) continue;
+    WorldZone& z = worldZones[numWorldZones];
+    z.tzIndex = indices[i];
+    char name[TZ_NAME_MAX], tz[TZ_RULE_MAX];
+    cityAbbrev(timezoneName(z.tzIndex, name), z.abbrev);
+    if (!tzParse(timezoneRule(z.tzIndex, tz), z.rule)) {
+      DBG_WARN("World clock: cannot parse TZ for %s", name);
+      continue;
+    }
+    z.validFrom = z.validUntil = 0;  // Force evaluation on first use
+    numWorldZones++;
+  }
+  DBG_INFO("World clock: %d zones", numWorldZones);
+}
+
+void initWorldClock() {
+  setWorldZones(defaultWorldZones, sizeof(defaultWorldZones));
+}
+
+int32_t worldZoneOffset(WorldZone& z, int64_t utc) {
+  if (utc < z.validFrom || utc >= z.validUntil) {
+    z.offset = tzOffsetAt(z.rule, utc, &z.validFrom, &z.validUntil);
+  }
+  return z.offset;
+}
+
+void displayWorldClock() {
+  clr();
+  if (numWorldZones == 0) {
+    xPos = 0;
+    yPos = 0;
+    printString("NO ZONES", font3x7);
+    return;
+  }
+
+  int zoneIdx = (timeSampledUs / 1000 / WORLD_CLOCK_ZONE_TIME) % numWorldZones;
+  WorldZone& z = worldZones[zoneIdx];
+  int64_t utc = timeSampledUs / 1000000;
+  int64_t local = utc + worldZoneOffset(z, utc);
+  int32_t days = tzFloorDiv(local, 86400);
+  int32_t secOfDay = local - (int64_t)days * 86400;
+
+  // Top line: zone's local time
+  yPos = 0;
+  printTime(LAYOUT_TOP_LINE, secOfDay / 3600, secOfDay / 60 % 60, secOfDay % 60);
+
+  // Bottom line: "<CITY> <DAY>"
+  static const char weekdays[] = "SUNMONTUEWEDTHUFRISAT";
+  yPos = 1;
+  xPos = 1;
+  printString(z.abbrev, font3x7);
+  printChar(' ', font3x7);
+  for (int i = 0; i < 3; i++) printChar(weekdays[tzWeekday(days) * 3 + i], font3x7);
+
+  // Shift bottom line slightly
+  for (int i = 0; i < LINE_WIDTH; i++) scr[LINE_WIDTH + i] <<= 1;
+}
+
+// ======================== STOPWATCH & COUNTDOWN ========================
+// Timers are based on clockNowUs(), i.e. the NTP-disciplined clock, so a
+// long-running timer agrees with the clock instead of the raw crystal.
+
+struct IntervalTimer {
+  bool running;
+  int64_t startMs;        // utcMillis() at the last start
+  int64_t accumulatedMs;  // Elapsed time banked before the last start
+  int64_t durationMs;     // Countdown length (unused for the stopwatch)
+};
+
+IntervalTimer stopwatchTimer = {false, 0, 0, 0};
+IntervalTimer countdownTimer = {false, 0, 0, COUNTDOWN_DEFAULT_SECONDS * 1000LL};
+
+int64_t utcMillis() {
+  return clockNowUs() / 1000;
+}
+
+int64_t timerElapsedMs(const IntervalTimer& t) {
+  return t.accumulatedMs + (t.running ? utcMillis() - t.startMs : 0);
+}
+
+int64_t countdownRemainingMs() {
+  int64_t remaining = countdownTimer.durationMs - timerElapsedMs(countdownTimer);
+  if (remaining <= 0 && countdownTimer.running) {
+    countdownTimer.running = false;
+    countdownTimer.accumulatedMs = countdownTimer.durationMs;
+    DBG_INFO("Countdown finished");
+  }
+  return max((int64_t)0, remaining);
+}
+
+void timerStart(IntervalTimer& t) {
+  if (t.running) return;
+  t.startMs = utcMillis();
+  t.running = true;
+}
+
+void timerStop(IntervalTimer& t) {
+  if (!t.running) return;
+  t.accumulatedMs += utcMillis() - t.startMs;
+  t.running = false;
+}
+
+void timerReset(IntervalTimer& t) {
+  t.running = false;
+  t.accumulatedMs = 0;
+}
+
+// The clock was stepped by shiftMs (first sync, large correction): running timers
+// keep their elapsed time instead of jumping with it
+void timerRebase(int64_t shiftMs) {
+  if (stopwatchTimer.running) stopwatchTimer.startMs += shiftMs;
+  if (countdownTimer.running) countdownTimer.startMs += shiftMs;
+}
+
+// True while a timer mode shows running tenths, i.e. renders at 10 Hz (an expired
+// countdown flashes at 2 Hz, a stopped timer only redraws on the second)
+bool timerTicking() {
+  if (currentMode == MODE_STOPWATCH) return stopwatchTimer.running;
+  if (currentMode == MODE_COUNTDOWN) return countdownTimer.running;
+  return false;
+}
+
+// Frame clocks follow the timer's own tenths so digits flip exactly on time
+unsigned long stopwatchFrameSlot() {
+  return timerElapsedMs(stopwatchTimer) / 100;
+}
+
+unsigned long countdownFrameSlot() {
+  int64_t remaining = countdownRemainingMs();
+  // Keep ticking at 2 Hz once expired so the display can flash
+  return remaining > 0 ? (unsigned long)((remaining + 99) / 100) : millis() / 500;
+}
+
+// MM:SS in the 16px font with tenths underneath on the right; H:MM + seconds past an hour
+void printDuration(int64_t ms) {
+  uint32_t totalSeconds = ms / 1000;
+  clr();
+  yPos = 0;
+  if (totalSeconds < 3600) {
+    xPos = 2;
+    printPadded<2>(totalSeconds / 60, digits5x16rn);
+    printCharX(':', digits5x16rn, xPos);
+    xPos += 2;
+    printPadded<2>(totalSeconds % 60, digits5x16rn);
+    yPos = 1;
+    printNumber(ms / 100 % 10, font3x7);
+  } else {
+    xPos = 0;
+    printNumber(min(totalSeconds / 3600, (uint32_t)99), digits5x16rn);
+    printCharX(':', digits5x16rn, xPos);
+    xPos += 2;
+    printPadded<2>(totalSeconds / 60 % 60, digits5x16rn);
+    printPadded<2>(totalSeconds % 60, font3x7);
+  }
+}
+
+void displayStopwatch() {
+  printDuration(timerElapsedMs(stopwatchTimer));
+}
+
+void displayCountdown() {
+  int64_t remaining = countdownRemainingMs();
+  // Round up so "00:00.0" only appears once time is really up
+  printDuration(remaining > 0 ? remaining + 99 : 0);
+  if (remaining == 0 && (millis() / 500) % 2) invert();
+}
+
+// Pressure in hPa with 3-hour trend arrow, forecast label below
+void displayPressure() {
+  clr();
+  yPos = 0;
+  if (!sensorAvailable) {
+    xPos = 0;
+    printString("NO SENSOR", font3x7);
+    return;
+  }
+
+  xPos = (pressure >= 1000) ? 0 : 3;
+  printNumber(pressure, digits5x8rn);
+  if (forecastCode != 0) {
+    // '#' / '$' are the up / down arrows in digits5x8rn
+    printChar(pressureTrend >= 16 ? '#' : pressureTrend <= -16 ? '$' : '-', digits5x8rn);
+  }
+
+  yPos = 1;
+  xPos = 1;
+  printString(forecastLabel(), font3x7);
+
+  // Shift bottom line slightly
+  for (int i = 0; i < LINE_WIDTH; i++) scr[LINE_WIDTH + i] <<= 1;
+}
+
+// Current value on top, history graph of the same metric below
+void displaySparkline() {
+  clr();
+  yPos = 0;
+  xPos = 1;
+  if (!sensorAvailable) {
+    printString("NO SENSOR", font3x7);
+    return;
+  }
+
+  switch (sparklineMetric) {
+    case SPARK_HUMIDITY:
+      printChar('H', font3x7);
+      printNumber(humidity, font3x7);
+      printChar('%', font3x7);
+      break;
+    case SPARK_PRESSURE:
+      printChar('P', font3x7);
+      printNumber(pressure, font3x7);
+      break;
+    default: {
+      int t = useFahrenheit ? temperatureDeci * 9 / 5 + 320 : temperatureDeci;
+      printChar('T', font3x7);
+      if (t < 0) printChar('-', font3x7);  // t / 10 is 0 from -0.9 to -0.1: sign separately
+      printNumber(abs(t) / 10, font3x7);
+      printChar('.', font3x7);
+      printNumber(abs(t) % 10, font3x7);
+      printChar(getTempUnit(), font3x7);
+      break;
+    }
+  }
+
+  memcpy(scr + LINE_WIDTH, sparklineColumns, LINE_WIDTH);
+}
+
+// ======================== WEATHER ========================
+// Current conditions from an OpenWeatherMap-compatible endpoint. The fetch is driven
+// from loop() through HttpStream, and the body is fed byte by byte to JsonStream,
+// which keeps only the fields below - the response is never held in memory.
+// A good result (the whole body parsed, with a temperature) is cached for WEATHER_TTL;
+// failures, including a body cut off mid-transfer, retry after WEATHER_RETRY_INTERVAL.
+
+struct WeatherData {
+  bool valid;
+  int tempDeci;        // 0.1 C
+  int humidity;        // %
+  int pressure;        // hPa
+  int conditionId;     // OWM condition code, e.g. 800 = clear
+  char condition[8];   // Upper-cased group ("CLOUDS", "RAIN", ...), fits the top line
+  char city[24];
+};
+
+WeatherData weatherData;                 // Last good result, shown by the Weather mode
+WeatherData weatherPending;              // Filled while a response streams in
+unsigned long weatherFetchedAt = 0;
+unsigned long weatherNextFetch = 0;      // millis() of the next attempt
+uint32_t weatherFetches = 0;
+uint32_t weatherFailures = 0;
+char weatherHost[48] = WEATHER_HOST;
+uint16_t weatherPort = WEATHER_PORT;
+char weatherPath[160] = WEATHER_PATH;
+HttpStream weatherHttp;
+JsonStream weatherJson;
+
+void copyUpper(char* dst, size_t size, const char* src) {
+  size_t i = 0;
+  for (; i + 1 < size && src[i]; i++) dst[i] = toupper(src[i]);
+  dst[i] = '\0';
+}
+
+void onWeatherValue(const char* path, const char* value, void* ctx) {
+  WeatherData& w = *static_cast<WeatherData*>(ctx);
+  if (strcmp(path, "main.temp") == 0) {
+    w.tempDeci = (int)floor(atof(value) * 10 + 0.5);
+    w.valid = true;
+  } else if (strcmp(path, "main.humidity") == 0) {
+    w.humidity = atoi(value);
+  } else if (strcmp(path, "main.pressure") == 0) {
+    w.pressure = atoi(value);
+  } else if (strcmp(path, "weather[0].id") == 0) {
+    w.conditionId = atoi(value);
+  } else if (strcmp(path, "weather[0].main") == 0) {
+    copyUpper(w.condition, sizeof(w.condition), value);
+  } else if (strcmp(path, "name") == 0) {
+    strlcpy(w.city, value, sizeof(w.city));
+  }
+}
+
+void onWeatherBody(const uint8_t* data, size_t len, void* ctx) {
+  for (size_t i = 0; i < len; i++) weatherJson.feed(data[i]);
+}
+
+void startWeatherFetch() {
+  memset(&weatherPending, 0, sizeof(weatherPending));
+  weatherJson.begin(onWeatherValue, &weatherPending);
+  weatherHttp.onBody(onWeatherBody);
+  weatherFetches++;
+  DBG_VERBOSE("Weather fetch: %s:%u", weatherHost, weatherPort);
+  // Lookup and connect happen in the next passes; a failure there is handled like any other
+  weatherHttp.begin(weatherHost, weatherPort, weatherPath, nullptr, HTTP_CONNECT_TIMEOUT, HTTP_IDLE_TIMEOUT, nullptr);
+}
+
+void finishWeatherFetch(unsigned long now, bool completed) {
+  int status = weatherHttp.status();
+  weatherHttp.stop();
+  if (completed && status == 200 && !weatherJson.failed() && weatherJson.done() && weatherPending.valid) {
+    weatherData = weatherPending;
+    weatherFetchedAt = now;
+    weatherNextFetch = now + WEATHER_TTL;
+    DBG_INFO("Weather: %s %d.%d C %d%% (%s)", weatherData.condition, weatherData.tempDeci / 10,
+             abs(weatherData.tempDeci) % 10, weatherData.humidity, weatherData.city);
+    if (currentMode == MODE_WEATHER) redrawRequested = true;
+  } else {
+    weatherFailures++;
+    weatherNextFetch = now + WEATHER_RETRY_INTERVAL;
+    DBG_WARN("Weather fetch failed (HTTP %d)", status);
+  }
+}
+
+void serviceWeather(unsigned long now) {
+  HttpStream::State state = weatherHttp.poll(HTTP_POLL_BUDGET);
+  if (weatherHttp.busy()) return;
+  if (state == HttpStream::DONE || state == HttpStream::FAILED) {
+    finishWeatherFetch(now, state == HttpStream::DONE);
+    return;
+  }
+  if (weatherHost[0] == '\0' || WiFi.status() != WL_CONNECTED) return;
+  if ((long)(now - weatherNextFetch) >= 0) startWeatherFetch();
+}
+
+// Condition group on top, outdoor temperature and humidity below
+void displayWeather() {
+  clr();
+  yPos = 0;
+  xPos = 1;
+  if (!weatherData.valid) {
+    printString(weatherHost[0] ? "NO DATA" : "NO WX", font3x7);
+    return;
+  }
+  printString(weatherData.condition, font3x7);
+
+  yPos = 1;
+  xPos = 1;
+  int t = useFahrenheit ? weatherData.tempDeci * 9 / 5 + 320 : weatherData.tempDeci;
+  printChar('T', font3x7);
+  printSigned((t + (t < 0 ? -5 : 5)) / 10, font3x7);
+  printChar(getTempUnit(), font3x7);
+  printChar(' ', font3x7);
+  printChar('H', font3x7);
+  printNumber(weatherData.humidity, font3x7);
+  printChar('%', font3x7);
+
+  // Shift bottom line slightly
+  for (int i = 0; i < LINE_WIDTH; i++) scr[LINE_WIDTH + i] <<= 1;
+}
+
+// ======================== CALENDAR ========================
+// Next upcoming events from an iCalendar feed (calendarfeed.h). The .ics body
+// streams through IcalStream one line at a time and only the CALENDAR_EVENTS
+// earliest future events are kept. Re-fetches send the ETag / Last-Modified
+// validators of the previous response, so an unchanged calendar costs a 304 and no
+// body; a feed cut off mid-transfer is counted as a failure and changes nothing.
+
+int64_t calendarLocalToUtc(int64_t wallS) {
+  if (!localZoneValid) return wallS - localOffsetAt(wallS - localOffsetAt(wallS));
+  return wallS - localZone.offsetAt(wallS - localZone.rule.stdOffset);
+}
+
+CalendarFeed calendar(calendarLocalToUtc);
+char calendarHost[48] = "";
+uint16_t calendarPort = 80;
+char calendarPath[160] = "";
+unsigned long calendarNextFetch = 0;
+uint32_t calendarFetches = 0;
+uint32_t calendarNotModified = 0;
+uint32_t calendarFailures = 0;
+HttpStream calendarHttp;
+
+bool setCalendarUrl(const char* url) {
+  const char* path;
+  calendarHttp.stop();
+  calendar.clear();
+  calendarNextFetch = millis();
+  if (!url[0] || !httpParseUrl(url, calendarHost, sizeof(calendarHost), calendarPort, path)) {
+    calendarHost[0] = '\0';
+    return !url[0];
+  }
+  strlcpy(calendarPath, path, sizeof(calendarPath));
+  DBG_INFO("Calendar: http://%s:%u%s", calendarHost, calendarPort, calendarPath);
+  return true;
+}
+
+void startCalendarFetch() {
+  const char* validators = calendar.begin(clockNowUs() / 1000000);
+  calendarHttp.onHeader(CalendarFeed::headerHandler);
+  calendarHttp.onBody(CalendarFeed::bodyHandler);
+  calendarFetches++;
+  DBG_VERBOSE("Calendar fetch: %s:%u%s", calendarHost, calendarPort, validators[0] ? " (conditional)" : "");
+  calendarHttp.begin(calendarHost, calendarPort, calendarPath, validators, HTTP_CONNECT_TIMEOUT, HTTP_IDLE_TIMEOUT,
+                     &calendar);
+}
+
+void finishCalendarFetch(unsigned long now, bool completed) {
+  int status = calendarHttp.status();
+  calendarHttp.stop();
+  switch (calendar.finish(completed, status)) {
+    case CalendarFeed::NOT_MODIFIED:
+      calendarNotModified++;
+      calendarNextFetch = now + CALENDAR_REFRESH;
+      DBG_VERBOSE("Calendar not modified");
+      break;
+    case CalendarFeed::UPDATED:
+      calendarNextFetch = now + CALENDAR_REFRESH;
+      DBG_INFO("Calendar: %u events, %d upcoming kept", calendar.parsed(), calendar.count());
+      if (currentMode == MODE_CALENDAR) redrawRequested = true;
+      break;
+    case CalendarFeed::FAILED:
+      calendarFailures++;
+      calendarNextFetch = now + CALENDAR_RETRY_INTERVAL;
+      DBG_WARN("Calendar fetch failed (HTTP %d%s)", status, completed && status == 200 ? ", truncated" : "");
+      break;
+  }
+}
+
+void serviceCalendar(unsigned long now) {
+  HttpStream::State state = calendarHttp.poll(HTTP_POLL_BUDGET);
+  if (calendarHttp.busy()) return;
+  if (state == HttpStream::DONE || state == HttpStream::FAILED) {
+    finishCalendarFetch(now, state == HttpStream::DONE);
+    return;
+  }
+  if (calendarHost[0] == '\0') return;
+  // Started events are dropped and the list is refilled by a full fetch
+  if (calendar.prune(clockNowUs() / 1000000)) {
+    calendarNextFetch = millis();
+    if (currentMode == MODE_CALENDAR) redrawRequested = true;
+  }
+  // Don't fetch before the clock is set: "upcoming" needs the real date
+  if (WiFi.status() != WL_CONNECTED || clockNowUs() / 1000000 < 1600000000) return;
+  if ((long)(now - calendarNextFetch) >= 0) startCalendarFetch();
+}
+
+// Start on top ("NEXT 14:30", "SAT 14:30", "TODAY", "SAT 18"), summary below
+void displayCalendar() {
+  static const char weekdays[] = "SUNMONTUEWEDTHUFRISAT";
+  clr();
+  yPos = 0;
+  xPos = 1;
+  if (calendar.count() == 0) {
+    printString(calendarHost[0] ? "NO EVENTS" : "NO CAL", font3x7);
+    return;
+  }
+  xPos = 0;  // "MON&23:59" needs all 32 columns
+
+  const IcalEvent& e = calendar.event(0);
+  int64_t utc = clockNowUs() / 1000000;
+  int64_t local = e.start + localOffsetAt(e.start);
+  int32_t eventDay = tzFloorDiv(local, 86400);
+  int32_t today = tzFloorDiv(utc + localOffsetAt(utc), 86400);
+  int32_t secOfDay = local - (int64_t)eventDay * 86400;
+
+  // '&' is a zero-width glyph, i.e. a 1px spacer
+  if (eventDay == today) {
+    printString(e.allDay ? "TODAY" : "NEXT", font3x7);
+  } else {
+    for (int i = 0; i < 3; i++) printChar(weekdays[tzWeekday(eventDay) * 3 + i], font3x7);
+  }
+  if (e.allDay) {
+    if (eventDay != today) {
+      int32_t y;
+      int m, d;
+      tzCivilFromDays(eventDay, y, m, d);
+      printChar('&', font3x7);
+      printNumber(d, font3x7);
+    }
+  } else {
+    printChar('&', font3x7);
+    int h = secOfDay / 3600;
+    if (!use24HourFormat) h = (h == 0) ? 12 : (h > 12) ? h - 12 : h;
+    printNumber(h, font3x7);
+    printChar(':', font3x7);
+    printPadded<2>(secOfDay / 60 % 60, font3x7);
+  }
+
+  // Summary, clipped to whole glyphs
+  yPos = 1;
+  xPos = 1;
+  for (const char* p = e.summary; *p; p++) {
+    char c = toupper(*p);
+    if (xPos + charWidth(c, font3x7) > LINE_WIDTH) break;
+    printChar(c, font3x7);
+  }
+
+  // Shift bottom line slightly
+  for (int i = 0; i < LINE_WIDTH; i++) scr[LINE_WIDTH + i] <<= 1;
+}
+
+// ======================== NOTIFICATIONS ========================
+// Pushed via /api/message into a fixed pool (no heap). The highest-priority live
+// message scrolls across the matrix, preempting the mode cycle; identical texts
+// are coalesced into one entry. Enqueueing is O(NOTIFY_QUEUE_SIZE) and never
+// touches the display, so bursts of requests don't stall rendering.
+
+struct Notification {
+  char text[NOTIFY_TEXT_MAX + 1];
+  uint8_t priority;          // 0-9, higher first
+  uint8_t repeatsLeft;       // Scroll passes still to show
+  unsigned long expiresAt;   // millis(); dropped if not shown by then
+  uint32_t seq;              // Arrival order, FIFO within a priority
+  bool used;
+};
+
+Notification notifyQueue[NOTIFY_QUEUE_SIZE];
+uint32_t notifySeq = 0;
+uint32_t notifyCoalesced = 0;
+uint32_t notifyDropped = 0;
+
+int tickerSlot = -1;                                   // Queue entry being scrolled
+uint8_t tickerColumns[NOTIFY_TEXT_MAX * 6];            // Rasterised font3x7 columns
+int tickerLength = 0;
+unsigned long tickerStart = 0;
+
+int notifyDepth() {
+  int n = 0;
+  for (int i = 0; i < NOTIFY_QUEUE_SIZE; i++) n += notifyQueue[i].used;
+  return n;
+}
+
+// Returns false if the queue is full of equal or higher priority messages
+bool enqueueNotification(const char* text, int priority, unsigned long ttlMs, int repeats, bool* coalesced) {
+  char upper[NOTIFY_TEXT_MAX + 1];
+  int n = 0;
+  for (; text[n] && n < NOTIFY_TEXT_MAX; n++) upper[n] = toupper(text[n]);
+  upper[n] = '\0';
+  priority = constrain(priority, 0, 9);
+  repeats = constrain(repeats, 1, 255);
+  unsigned long expiresAt = millis() + ttlMs;
+
+  *coalesced = false;
+  int freeSlot = -1;
+  int weakest = -1;  // Lowest priority, oldest entry that is not on screen
+  for (int i = 0; i < NOTIFY_QUEUE_SIZE; i++) {
+    Notification& q = notifyQueue[i];
+    if (!q.used) {
+      if (freeSlot < 0) freeSlot = i;
+      continue;
+    }
+    if (strcmp(q.text, upper) == 0) {
+      q.priority = max((int)q.priority, priority);
+      q.repeatsLeft = max((int)q.repeatsLeft, repeats);
+      if ((long)(expiresAt - q.expiresAt) > 0) q.expiresAt = expiresAt;
+      notifyCoalesced++;
+      *coalesced = true;
+      return true;
+    }
+    if (i != tickerSlot && (weakest < 0 || q.priority < notifyQueue[weakest].priority ||
+        (q.priority == notifyQueue[weakest].priority && q.seq < notifyQueue[weakest].seq))) {
+      weakest = i;
+    }
+  }
+
+  int slot = freeSlot;
+  if (slot < 0) {
+    notifyDropped++;  // Either the new message or the evicted one is lost
+    if (weakest < 0 || notifyQueue[weakest].priority >= priority) return false;
+    slot = weakest;
+  }
+
+  Notification& q = notifyQueue[slot];
+  memcpy(q.text, upper, n + 1);
+  q.priority = priority;
+  q.repeatsLeft = repeats;
+  q.expiresAt = expiresAt;
+  q.seq = notifySeq++;
+  q.used = true;
+  return true;
+}
+
+void startTicker(int slot) {
+  tickerSlot = slot;
+  tickerLength = 0;
+  for (const char* p = notifyQueue[slot].text; *p; p++) {
+    char ch = *p;
+    int w = charWidth(ch, font3x7);
+    if (w > 0) {
+      const uint8_t* glyph = font3x7 + 4 + (ch - pgm_read_byte(font3x7 + 2)) * 6 + 1;
+      for (int i = 0; i < w; i++) tickerColumns[tickerLength++] = pgm_read_byte(glyph + i);
+    }
+    tickerColumns[tickerLength++] = 0;  // Gap (or 1px blank for unknown glyphs, as printChar())
+  }
+  tickerStart = millis();
+  DBG_INFO("Notification: \"%s\" (p%d)", notifyQueue[slot].text, notifyQueue[slot].priority);
+}
+
+// Returns true while a notification is scrolling
+bool serviceNotifications() {
+  unsigned long now = millis();
+
+  // Nothing scrolls or is dequeued unseen: while the display is off (schedule, PIR,
+  // manual) a message on screen restarts its pass and queued ones wait (TTL still runs)
+  if (!displayOn) {
+    if (tickerSlot >= 0) tickerStart = now;
+    return tickerSlot >= 0;
+  }
+
+  if (tickerSlot >= 0) {
+    unsigned long pos = (now - tickerStart) / TICKER_PIXEL_MS;
+    if (pos < (unsigned long)(tickerLength + LINE_WIDTH)) return true;
+    // Pass complete
+    Notification& q = notifyQueue[tickerSlot];
+    if (--q.repeatsLeft == 0) q.used = false;
+    tickerSlot = -1;
+  }
+
+  int best = -1;
+  for (int i = 0; i < NOTIFY_QUEUE_SIZE; i++) {
+    Notification& q = notifyQueue[i];
+    if (!q.used) continue;
+    if ((long)(now - q.expiresAt) >= 0) {
+      q.used = false;
+      continue;
+    }
+    if (best < 0 || q.priority > notifyQueue[best].priority ||
+        (q.priority == notifyQueue[best].priority && q.seq < notifyQueue[best].seq)) {
+      best = i;
+    }
+  }
+  if (best < 0) return false;
+
+  startTicker(best);
+  return true;
+}
+
+unsigned long tickerFrameSlot() {
+  return (millis() - tickerStart) / TICKER_PIXEL_MS;
+}
+
+// Text enters from the right, vertically centred across both bands
+void displayTicker() {
+  clr();
+  if (tickerSlot < 0) return;
+  int pos = (millis() - tickerStart) / TICKER_PIXEL_MS;
+  for (int x = 0; x < LINE_WIDTH; x++) {
+    int idx = pos - LINE_WIDTH + x;
+    if (idx < 0 || idx >= tickerLength) continue;
+    uint16_t col = tickerColumns[idx] << 3;  // Glyph rows 2-6 -> display rows 5-9
+    scr[x] = col & 0xFF;
+    scr[LINE_WIDTH + x] = col >> 8;
+  }
+}
+
+void showMessage(const char* message) {
+  clr();
+  xPos = 0;
+  yPos = 0;
+  printString(message, font3x7);
+  refreshAll();
+}
+
+// Constant messages are rendered at compile time; just copy the image from flash
+void showMessage(const FrameImage& image) {
+  memcpy_P(scr, image.rows, sizeof(image.rows));
+  refreshAll();
+}
+
+// ======================== TIME FUNCTIONS ========================
+// NTP sync is a state machine driven from loop(): requestNtpSync() sends a request
+// to every server in NTP_SERVERS at once (sntpclient.h) and returns immediately, and
+// serviceNtp() collects the replies and feeds the lowest-delay sample to the clock
+// discipline. Servers whose address is not cached are resolved by serviceNtp(), one
+// per loop pass, so a slow DNS server stalls the display for at most NTP_DNS_TIMEOUT.
+// A request that gets no usable answer within NTP_SYNC_TIMEOUT is retried with
+// exponential backoff.
+
+enum NtpState : uint8_t { NTP_UNSYNCED, NTP_REQUESTED, NTP_SYNCED, NTP_RETRY_WAIT };
+const char* const ntpStateNames[] = {"unsynced", "requested", "synced", "retry_wait"};
+
+NtpState ntpState = NTP_UNSYNCED;
+unsigned long ntpRequestedAt = 0;
+unsigned long ntpLastSync = 0;            // millis() of the last successful sync
+unsigned long ntpNextAttempt = 0;
+unsigned long ntpRetryDelay = NTP_RETRY_MIN;
+long ntpLastLatency = -1;                 // ms from request to clock set, -1 = never synced
+uint32_t ntpSyncCount = 0;
+uint32_t ntpFailCount = 0;
+
+const ClockDisciplineConfig clockConfig = {
+  CLOCK_POLL_MIN_S, CLOCK_POLL_MAX_S, CLOCK_STEP_THRESHOLD_MS * 1000, CLOCK_SLEW_MAX_PPM,
+  CLOCK_POLL_TIGHT_MS * 1000, CLOCK_POLL_LOOSE_MS * 1000, 4
+};
+ClockDiscipline clockDiscipline(clockConfig);
+
+// Offsets are measured against the displayed (disciplined) clock
+SntpClient sntp(clockNowUs);
+
+// The system clock (gettimeofday) is set at every sync for the SDK's sake; the
+// displayed time comes from clockDiscipline, a drift-corrected, slewed model of
+// the local microsecond counter.
+int64_t systemUtcUs() {
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+// Disciplined UTC in microseconds; the raw system clock until the first sync
+int64_t clockNowUs() {
+  if (!clockDiscipline.synced()) return systemUtcUs();
+  return clockDiscipline.now(micros64());
+}
+
+bool setNtpServers(const char* list) {
+  if (!sntp.setServers(list)) {
+    DBG_WARN("Invalid NTP server list: %s", list);
+    return false;
+  }
+  if (ntpState == NTP_REQUESTED) ntpState = NTP_RETRY_WAIT;  // setServers() dropped the request
+  return true;
+}
+
+// Queries all NTP servers without waiting for the answers
+void requestNtpSync() {
+  DBG_INFO("Syncing NTP (%d servers)", sntp.serverCount());
+  ntpState = NTP_REQUESTED;
+  ntpRequestedAt = millis();
+  if (!sntp.begin(NTP_SYNC_TIMEOUT, NTP_DNS_TIMEOUT)) {
+    DBG_WARN("NTP request could not be sent");
+  }
+}
+
+// ======================== SYNC TELEMETRY ========================
+// Every sample applied to the clock and every failed NTP sync is logged in a fixed
+// ring of SYNC_LOG_SIZE events, from which /api/sync (JSON) and /metrics
+// (Prometheus text format) report offset, jitter, drift and failure counts.
+// updateTime() additionally counts jumps of the displayed time against the local
+// counter, i.e. what a viewer would see as a skipped or repeated second.
+
+#define SYNC_EVENT_STEP   0x01  // Offset was stepped, not slewed
+#define SYNC_EVENT_FAILED 0x02  // No usable sample (offset/error not valid)
+
+struct SyncEvent {
+  uint32_t atS;         // micros64() / 1e6 when logged
+  int32_t offsetUs;     // Clock offset the sample measured (clamped)
+  uint32_t errorUs;     // Sample's error bound
+  uint16_t durationMs;  // Request to reply (NTP), 0 otherwise
+  int8_t source;        // timeSources index
+  uint8_t flags;
+};
+
+SyncEvent syncLog[SYNC_LOG_SIZE];
+uint8_t syncLogHead = 0;        // Next slot to write
+uint8_t syncLogCount = 0;
+uint32_t syncCount = 0;
+uint32_t syncFailures = 0;
+uint32_t clockJumps = 0;
+int32_t maxClockJumpUs = 0;
+int64_t jumpCheckLocalUs = 0;   // Previous updateTime() sample
+int64_t jumpCheckUtcUs = 0;
+
+void recordSyncEvent(int source, uint8_t flags, int64_t offsetUs, uint32_t errorUs, unsigned long durationMs) {
+  SyncEvent& e = syncLog[syncLogHead];
+  e.atS = micros64() / 1000000;
+  e.offsetUs = offsetUs > INT32_MAX ? INT32_MAX : (offsetUs < -INT32_MAX ? -INT32_MAX : (int32_t)offsetUs);
+  e.errorUs = errorUs;
+  e.durationMs = durationMs > 0xFFFF ? 0xFFFF : durationMs;
+  e.source = source;
+  e.flags = flags;
+  syncLogHead = (syncLogHead + 1) % SYNC_LOG_SIZE;
+  if (syncLogCount < SYNC_LOG_SIZE) syncLogCount++;
+  if (flags & SYNC_EVENT_FAILED) syncFailures++;
+  else syncCount++;
+}
+
+// i = 0 is the oldest kept event
+const SyncEvent& syncEvent(int i) {
+  return syncLog[(syncLogHead + SYNC_LOG_SIZE - syncLogCount + i) % SYNC_LOG_SIZE];
+}
+
+// Most recent successful event, nullptr if none is kept
+const SyncEvent* lastSyncEvent() {
+  for (int i = syncLogCount - 1; i >= 0; i--) {
+    if (!(syncEvent(i).flags & SYNC_EVENT_FAILED)) return &syncEvent(i);
+  }
+  return nullptr;
+}
+
+// RMS difference of successive slewed offsets from the same source (NTP's jitter)
+uint32_t syncJitterUs() {
+  double sum = 0;
+  int n = 0;
+  const SyncEvent* prev = nullptr;
+  for (int i = 0; i < syncLogCount; i++) {
+    const SyncEvent& e = syncEvent(i);
+    if (e.flags) continue;
+    if (prev && prev->source == e.source) {
+      double d = (double)e.offsetUs - prev->offsetUs;
+      sum += d * d;
+      n++;
+    }
+    prev = &e;
+  }
+  return n ? (uint32_t)sqrt(sum / n) : 0;
+}
+
+// {name="value"} with the value escaped as the text format requires
+String promLabel(const char* name, const char* value) {
+  String out = "{";
+  out += name;
+  out += "=\"";
+  for (const char* p = value; *p; p++) {
+    if (*p == '\\' || *p == '"') out += '\\';
+    if (*p == '\n') {
+      out += "\\n";
+    } else {
+      out += *p;
+    }
+  }
+  out += "\"}";
+  return out;
+}
+
+// One Prometheus sample with its HELP/TYPE header (labels: e.g. "{source=\"NTP\"}")
+void promMetric(String& out, const char* name, const char* type, const char* help, const String& value,
+                const char* labels = "") {
+  out += "# HELP ledclock_";
+  out += name;
+  out += " ";
+  out += help;
+  out += "\n# TYPE ledclock_";
+  out += name;
+  out += " ";
+  out += type;
+  out += "\nledclock_";
+  out += name;
+  out += labels;
+  out += " ";
+  out += value;
+  out += "\n";
+}
+
+// Called by updateTime(): the clock may only slew (<= CLOCK_SLEW_MAX_PPM) against
+// the counter between two samples; anything more is a visible jump
+void checkClockJump(int64_t localUs, int64_t utcUs) {
+  if (jumpCheckLocalUs != 0) {
+    int64_t d = (utcUs - jumpCheckUtcUs) - (localUs - jumpCheckLocalUs);
+    if (d < 0) d = -d;
+    if (d > CLOCK_JUMP_THRESHOLD_MS * 1000) {
+      clockJumps++;
+      if (d > maxClockJumpUs) maxClockJumpUs = d > INT32_MAX ? INT32_MAX : (int32_t)d;
+    }
+  }
+  jumpCheckLocalUs = localUs;
+  jumpCheckUtcUs = utcUs;
+}
+
+// ======================== TIME SOURCES ========================
+// Every time source posts samples to timeSources (timesource.h), which keeps the
+// best one selected; only its samples discipline the clock. In priority order:
+//   PPS        second edges on PPS_PIN, numbered from the clock (stratum 0)
+//   NTP        best reply of each sync (server stratum)
+//   DS3231     I2C RTC chip read at its second edge; reset from the clock when off
+//   RTC timer  the warm-restart snapshot, carried across the reset by the RTC timer
+
+TimeSources timeSources(TIME_SOURCE_MIN_FEED_S, TIME_SOURCE_AGING_PPM, TIME_SOURCE_SET_THRESHOLD_MS * 1000);
+int tsPps = -1, tsNtp = -1, tsRtcChip = -1, tsRtcTimer = -1;
+
+volatile uint32_t ppsEdgeMicros = 0;   // Written by the PPS interrupt
+volatile uint32_t ppsEdges = 0;
+uint32_t ppsEdgesSeen = 0;
+
+bool rtcChipPresent = false;
+uint8_t rtcChipStratum = TIME_SOURCE_RTC_CHIP_STRATUM;  // Until set from a better source
+bool rtcChipHunting = false;           // Polling for the next second edge
+int64_t rtcChipLastSecond = 0;
+int64_t rtcChipLastPollUs = 0;
+unsigned long rtcChipLastPoll = 0;
+unsigned long rtcChipNextRead = 0;
+
+void IRAM_ATTR onPpsEdge() {
+  ppsEdgeMicros = micros();
+  ppsEdges++;
+}
+
+void applyTimeSample(const TimeSample& t) {
+  uint32_t steps = clockDiscipline.steps();
+  int64_t before = clockNowUs();
+  clockDiscipline.sync(t.localUs, t.utcUs);
+  timerRebase((clockNowUs() - before) / 1000);  // Only a step moves the clock at once
+  int sel = timeSources.selected();
+  recordSyncEvent(sel, clockDiscipline.steps() != steps ? SYNC_EVENT_STEP : 0, clockDiscipline.lastOffsetUs(),
+                  t.errorUs, sel == tsNtp ? ntpLastLatency : 0);
+  tempCompSync(t);
+  int64_t now = clockNowUs();
+  struct timeval tv = {(time_t)(now / 1000000), (suseconds_t)(now % 1000000)};
+  settimeofday(&tv, nullptr);
+  clockValid = true;
+  redrawRequested = true;
+  updateTime();
+}
+
+// Writing the seconds register restarts the chip's countdown, so it is only written
+// just after a second boundary (the caller retries otherwise)
+bool setRtcChip(int64_t localUs, int64_t utcUs, uint8_t stratum, void*) {
+  int64_t now = utcUs + ((int64_t)micros64() - localUs);
+  if (now % 1000000 > DS3231_SET_WINDOW_US || !ds3231Write(now / 1000000)) return false;
+  rtcChipStratum = stratum;
+  rtcChipNextRead = millis();  // Read it back
+  DBG_INFO("DS3231 set from clock (stratum %u)", stratum);
+  return true;
+}
+
+// The chip only has whole seconds: poll the seconds register every DS3231_POLL_MS
+// until it changes; the edge lies between the last two polls.
+void serviceRtcChip(unsigned long now) {
+  if (!rtcChipPresent) return;
+  if (rtcChipHunting ? now - rtcChipLastPoll < DS3231_POLL_MS : (long)(now - rtcChipNextRead) < 0) return;
+
+  int64_t pollUs = micros64();
+  int64_t sec;
+  rtcChipLastPoll = now;
+  if (!ds3231Read(sec)) {
+    rtcChipHunting = false;
+    rtcChipNextRead = now + DS3231_READ_INTERVAL;
+    return;
+  }
+  if (!rtcChipHunting || sec == rtcChipLastSecond) {
+    rtcChipHunting = true;
+    rtcChipLastSecond = sec;
+    rtcChipLastPollUs = pollUs;
+    return;
+  }
+
+  uint32_t window = pollUs - rtcChipLastPollUs;
+  TimeSample t = {rtcChipLastPollUs + window / 2, sec * 1000000, window / 2 + DS3231_ERROR_US, rtcChipStratum};
+  timeSources.post(tsRtcChip, t);
+  rtcChipHunting = false;
+  rtcChipNextRead = now + DS3231_READ_INTERVAL;
+}
+
+// A PPS edge only marks a second; which second comes from the clock, so the clock
+// must already be well within half a second
+void servicePps() {
+  if (tsPps < 0 || ppsEdges == ppsEdgesSeen) return;
+  noInterrupts();
+  uint32_t edge = ppsEdgeMicros;
+  ppsEdgesSeen = ppsEdges;
+  interrupts();
+
+  int64_t localUs = micros64() - (uint32_t)(micros() - edge);
+  int sel = timeSources.selected();
+  if (!clockValid || sel < 0 || timeSources.errorUs(sel, localUs) > PPS_LABEL_MAX_ERROR_US) return;
+  int64_t second = (clockDiscipline.now(localUs) + 500000) / 1000000;
+  TimeSample t = {localUs, second * 1000000, PPS_ERROR_US, 0};
+  timeSources.post(tsPps, t);
+}
+
+void initTimeSources() {
+  if (PPS_PIN >= 0) {
+    tsPps = timeSources.add("PPS", 2);
+    pinMode(PPS_PIN, INPUT);
+    attachInterrupt(digitalPinToInterrupt(PPS_PIN), onPpsEdge, RISING);
+    DBG_INFO("PPS input on GPIO %d", PPS_PIN);
+  }
+  tsNtp = timeSources.add("NTP", 2 * CLOCK_POLL_MAX_S);
+
+  rtcChipPresent = ds3231Present();
+  if (rtcChipPresent) {
+    tsRtcChip = timeSources.add("DS3231", 3 * DS3231_READ_INTERVAL / 1000, setRtcChip);
+    if (ds3231Lost()) {
+      timeSources.invalidate(tsRtcChip);
+      DBG_WARN("DS3231 lost its time, waiting for another source");
+    } else {
+      // Catch one second edge now so the clock can be shown before WiFi is up
+      unsigned long start = millis();
+      while (timeSources.samples(tsRtcChip) == 0 && millis() - start < 1100) {
+        serviceRtcChip(millis());
+        delay(1);
+      }
+      DBG_INFO("DS3231 found");
+    }
+  }
+
+  tsRtcTimer = timeSources.add("RTC timer", RTC_SNAPSHOT_MAX_AGE);
+}
+
+void serviceTimeSources() {
+  servicePps();
+  serviceRtcChip(millis());
+
+  int before = timeSources.selected();
+  TimeSample t;
+  if (timeSources.service(micros64(), t)) {
+    applyTimeSample(t);
+  }
+  int sel = timeSources.selected();
+  if (sel != before) {
+    DBG_INFO("Time source: %s", sel >= 0 ? timeSources.name(sel) : "none");
+  }
+
+  if (clockValid) {
+    int64_t localUs = micros64();
+    timeSources.discipline(localUs, clockDiscipline.now(localUs));
+  }
+}
+
+void serviceNtp(unsigned long now) {
+  if (ntpState == NTP_REQUESTED) {
+    SntpClient::State st = sntp.poll();
+    if (st == SntpClient::WAITING) return;
+
+    if (st == SntpClient::DONE) {
+      const SntpSample& best = sntp.best();
+      TimeSample t = {best.rxLocalUs, best.refUtcUs(), (uint32_t)best.delayUs / 2, best.stratum};
+      ntpLastLatency = now - ntpRequestedAt;
+      timeSources.post(tsNtp, t);
+      serviceTimeSources();  // Applies it if NTP is the selected source
+      ntpState = NTP_SYNCED;
+      ntpSyncCount++;
+      ntpLastSync = now;
+      ntpRetryDelay = NTP_RETRY_MIN;
+      ntpNextAttempt = now + clockDiscipline.pollIntervalS() * 1000UL;
+      char tzName[TZ_NAME_MAX];
+      DBG_INFO("Time synced: %02d:%02d:%02d (TZ: %s, %ld ms)", hours24, minutes, seconds,
+               timezoneName(currentTimezone, tzName), ntpLastLatency);
+      DBG_INFO("NTP: %s stratum %u, offset %ld us, delay %ld us", sntp.server(best.server).host,
+               best.stratum, (long)best.offsetUs, (long)best.delayUs);
+      DBG_INFO("Clock: offset %ld us, drift %d ppb, next poll %u s", (long)clockDiscipline.lastOffsetUs(),
+               (int)(clockDiscipline.freqPpm() * 1000), clockDiscipline.pollIntervalS());
+      if (SENSOR_UPDATE_WITH_NTP) {
+        updateSensorData();
+      }
+      return;
+    }
+
+    ntpFailCount++;
+    recordSyncEvent(tsNtp, SYNC_EVENT_FAILED, 0, 0, now - ntpRequestedAt);
+    ntpState = NTP_RETRY_WAIT;
+    ntpNextAttempt = now + ntpRetryDelay;
+    DBG_WARN("NTP sync failed, retry in %lu s", ntpRetryDelay / 1000);
+    ntpRetryDelay = min(ntpRetryDelay * 2, (unsigned long)NTP_RETRY_MAX);
+    return;
+  }
+
+  if ((long)(now - ntpNextAttempt) >= 0) {
+    requestNtpSync();
+  }
+}
+
+// Local time is derived from a cached "local day": the UTC window in which the
+// date, weekday and UTC offset are all constant. It ends at the next local midnight
+// or DST transition, whichever is first, and starts at the later of the two before
+// (a backward step into the hours before a transition must not reuse the offset),
+// so within it hours/minutes/seconds are plain arithmetic on time(). The window is
+// rebuilt (with tzLocalDay()) only when time() leaves it - at midnight, a
+// transition, or an NTP step.
+
+TzLocalDay localDay = {};    // Window of the current date and offset (empty: rebuild)
+uint32_t localDayRebuilds = 0;
+
+// Keeps the zone's transition table spanning the year before utc to two years after
+void ensureLocalZoneTable(int64_t utc) {
+  if (!localZone.rule.hasDst || localZone.covers(utc)) return;
+  int32_t y;
+  int m, d;
+  tzCivilFromDays(tzFloorDiv(utc, 86400), y, m, d);
+  localZone.build(localZone.rule, y - 1);
+}
+
+// Seconds east of UTC at utc, from localtime() when the rule was not understood
+int32_t localOffsetAt(int64_t utc) {
+  if (localZoneValid) return localZone.offsetAt(utc);
+  time_t now = utc;
+  struct tm* t = localtime(&now);
+  int64_t local = (int64_t)tzDaysFromCivil(t->tm_year + 1900, t->tm_mon + 1, t->tm_mday) * 86400 +
+                  t->tm_hour * 3600 + t->tm_min * 60 + t->tm_sec;
+  return local - utc;
+}
+
+void rebuildLocalDay(int64_t utc) {
+  localDayRebuilds++;
+  if (!localZoneValid) {
+    // Unparsed rule: let newlib do it, and re-evaluate every second
+    time_t now = utc;
+    struct tm* timeinfo = localtime(&now);
+    localDay.midnight = utc - (timeinfo->tm_hour * 3600 + timeinfo->tm_min * 60 + timeinfo->tm_sec);
+    localDay.from = utc;
+    localDay.until = utc + 1;
+    day = timeinfo->tm_mday;
+    month = timeinfo->tm_mon + 1;
+    year = timeinfo->tm_year + 1900;
+    dayOfWeek = timeinfo->tm_wday;
+    return;
+  }
+
+  ensureLocalZoneTable(utc);
+  int64_t validFrom, validUntil;
+  int32_t offset = localZone.offsetAt(utc, &validFrom, &validUntil);
+  localDay = tzLocalDay(utc, offset, validFrom, validUntil);
+  year = localDay.year;
+  month = localDay.month;
+  day = localDay.day;
+  dayOfWeek = localDay.weekday;
+}
+
+void updateTime() {
+  int64_t clockUs = clockNowUs();
+  timeSampledUs = clockUs + fleetOffsetUs();
+  if (clockValid) checkClockJump(micros64(), clockUs);
+  int64_t utc = timeSampledUs / 1000000;
+  if (!localDay.contains(utc)) {
+    rebuildLocalDay(utc);
+  }
+
+  int32_t secOfDay = utc - localDay.midnight;
+
+  // Keep 24-hour time for schedule logic
+  hours24 = secOfDay / 3600;
+
+  // Convert to 12-hour format for display rendering
+  hours = (hours24 == 0) ? 12 : (hours24 > 12) ? hours24 - 12 : hours24;
+
+  minutes = secOfDay / 60 % 60;
+  seconds = secOfDay % 60;
+
+  // Blink dots (2 Hz), in phase with the second
+  showDots = timeSampledUs % 1000000 < 500000;
+}
+
+// Switches the local zone without touching the UTC clock: the new rules apply from the
+// next localtime() call, so no network round trip is needed.
+void applyTimezone(int index) {
+  currentTimezone = index;
+  char tz[TZ_RULE_MAX];
+  timezoneRule(index, tz);
+  setenv("TZ", tz, 1);
+  tzset();
+  TzRule rule;
+  localZoneValid = tzParse(tz, rule);
+  if (!localZoneValid) {
+    DBG_WARN("TZ rule not understood, using localtime(): %s", tz);
+    rule = TzRule();  // A failed parse can leave a half-filled rule; the table stays UTC
   }
-  
-  delay(100);
+  localZone.build(rule, 1970);  // Re-centred on the current year by ensureLocalZoneTable()
+  localDay = {};  // Force a recompute
+  updateTime();
+  redrawRequested = true;
 }
 
-// ======================== DISPLAY FUNCTIONS ========================
+// ======================== FLEET SYNC ========================
+// Clocks on one network tick their seconds, blink their colons and rotate display
+// modes together (fleetsync.h). They elect the clock nearest a reference as leader,
+// and the others shift their display timebase onto its clock. The shift never feeds
+// back into clockDiscipline: timers, logs and the time sources keep this clock's
+// own UTC. Mode rotation is a function of the display time and the leader's cycle
+// epoch, so every clock with the same cycle settings shows the same mode.
+
+FleetSync fleet(clockNowUs);
+WiFiUDP fleetUdp;                      // Joined to FLEET_GROUP while fleet.running()
+IPAddress fleetGroup;
+IPAddress fleetLocalIp;                // Address the multicast socket is bound to
+unsigned long fleetStartedAt = 0;
+uint32_t fleetLastLeader = 0;
+uint32_t cycleEpochS = 0;              // UTC second at which the mode rotation (re)started
+
+int64_t fleetOffsetUs() { return fleet.offsetUs(); }
+
+// Display timebase: the clock, shifted onto the fleet leader's
+int64_t displayNowUs() { return clockNowUs() + fleet.offsetUs(); }
+
+// Identifies the rotation: cycle order, and dwell and state of each entry
+uint32_t modeCycleHash() {
+  uint32_t h = 2166136261u;  // FNV-1a
+  for (int i = 0; i < modeCycleLength; i++) {
+    const DisplayMode& m = displayModes[modeCycle[i]];
+    uint32_t v[3] = {modeCycle[i], m.enabled, (uint32_t)m.dwellMs};
+    const uint8_t* b = (const uint8_t*)v;
+    for (size_t k = 0; k < sizeof(v); k++) h = (h ^ b[k]) * 16777619u;
+  }
+  return h;
+}
 
-void displayTimeAndTemp() {
-  clr();
+// Cycle settings changed here: the rotation starts over from its first entry
+void restartModeCycle() {
+  if (clockValid) cycleEpochS = clockNowUs() / 1000000;
+  modeCyclePos = -1;  // Re-applied by the next serviceDisplayModes()
+  lastModeChange = millis();
+}
 
-  // Top line: Time
-  yPos = 0;
-  if (use24HourFormat) {
-    // 24-hour mode: show HH:MM (no seconds) due to 32px width constraint.
-    xPos = 0;
-    sprintf(txt, "%02d", hours24);
-    printString(txt, digits5x8rn);
-    if (showDots) printCharX(':', digits5x8rn, xPos);
-    xPos += 2;
-    sprintf(txt, "%02d", minutes);
-    printString(txt, digits5x8rn);
-  } else {
-    // 12-hour mode: show H:MM:SS (seconds fit because hour is not zero-padded)
-    xPos = (hours > 9) ? 0 : 2;
-    sprintf(txt, "%d", hours);
-    printString(txt, digits5x8rn);
-    if (showDots) printCharX(':', digits5x8rn, xPos);
-    xPos += (hours >= 20) ? 1 : 2;
-    sprintf(txt, "%02d", minutes);
-    printString(txt, digits5x8rn);
-    sprintf(txt, "%02d", seconds);
-    printString(txt, digits3x5);
+// Entry of modeCycle[] on screen at display time ms: from the fleet's cycle epoch
+// the enabled entries follow each other for their dwell times. -1 if none is enabled.
+int scheduledCyclePos(int64_t ms) {
+  int64_t period = 0;
+  for (int i = 0; i < modeCycleLength; i++) {
+    if (displayModes[modeCycle[i]].enabled) period += displayModes[modeCycle[i]].dwellMs;
   }
-  
-  // Bottom line: Temperature and Humidity
-  yPos = 1;
-  xPos = 1;
-  if (sensorAvailable) {
-    int displayTemp = getDisplayTemperature();
-    char tempUnit = getTempUnit();
-    sprintf(txt, "T%d%c H%d%%", displayTemp, tempUnit, humidity);
-  } else {
-    sprintf(txt, "NO SENSOR");
+  if (period == 0) return -1;
+  int64_t t = (ms - (int64_t)fleet.epochS() * 1000) % period;
+  if (t < 0) t += period;
+  for (int i = 0; i < modeCycleLength; i++) {
+    const DisplayMode& m = displayModes[modeCycle[i]];
+    if (!m.enabled) continue;
+    if (t < (int64_t)m.dwellMs) return i;
+    t -= m.dwellMs;
   }
-  printString(txt, font3x7);
-  
-  // Shift bottom line slightly
-  for (int i = 0; i < LINE_WIDTH; i++) scr[LINE_WIDTH + i] <<= 1;
+  return -1;
 }
 
-void displayTimeLarge() {
-  clr();
-  yPos = 0;
+// FleetSync::Transport over the multicast socket
+bool fleetSend(const uint8_t* pkt, size_t len, void*) {
+  return fleetUdp.beginPacketMulticast(fleetGroup, FLEET_PORT, fleetLocalIp) && fleetUdp.write(pkt, len) == len &&
+         fleetUdp.endPacket();
+}
 
-  // This mode uses a larger time font. Keep existing 12-hour rendering.
-  // (24-hour support here would require more layout work than the 8px modes.)
-  xPos = (hours > 9) ? 0 : 3;
-  sprintf(txt, "%d", hours);
-  printString(txt, digits5x16rn);
-  if (showDots) printCharX(':', digits5x16rn, xPos);
-  xPos += (hours >= 20) ? 1 : 2;
-  sprintf(txt, "%02d", minutes);
-  printString(txt, digits5x16rn);
-  sprintf(txt, "%02d", seconds);
-  printString(txt, font3x7);
+int fleetReceive(uint8_t* buf, size_t size, uint32_t& fromIp, void*) {
+  if (fleetUdp.parsePacket() <= 0) return 0;
+  int n = fleetUdp.read(buf, size);
+  fleetUdp.flush();
+  fromIp = fleetUdp.remoteIP();
+  return n > 0 ? n : 0;
 }
 
-void displayTimeAndDate() {
-  clr();
+void stopFleet() {
+  if (fleet.running()) fleetUdp.stop();
+  fleet.stop();
+}
 
-  // Top line: Time
-  yPos = 0;
-  if (use24HourFormat) {
-    // 24-hour mode: show HH:MM (no seconds) due to 32px width constraint.
-    xPos = 0;
-    sprintf(txt, "%02d", hours24);
-    printString(txt, digits5x8rn);
-    if (showDots) printCharX(':', digits5x8rn, xPos);
-    xPos += 2;
-    sprintf(txt, "%02d", minutes);
-    printString(txt, digits5x8rn);
+void startFleet() {
+  stopFleet();
+  fleetGroup.fromString(FLEET_GROUP);
+  fleetLocalIp = WiFi.localIP();
+  fleetStartedAt = millis();
+  if (fleetUdp.beginMulticast(fleetLocalIp, fleetGroup, FLEET_PORT)) {
+    fleet.begin(ESP.getChipId(), {fleetSend, fleetReceive, nullptr}, FLEET_BEACON_INTERVAL, FLEET_PEER_TIMEOUT,
+                FLEET_MAX_OFFSET_MS * 1000UL);
+    DBG_INFO("Fleet sync: %s:%u as %08lx", FLEET_GROUP, FLEET_PORT, (unsigned long)fleet.id());
   } else {
-    // 12-hour mode: show H:MM:SS
-    xPos = (hours > 9) ? 0 : 2;
-    sprintf(txt, "%d", hours);
-    printString(txt, digits5x8rn);
-    if (showDots) printCharX(':', digits5x8rn, xPos);
-    xPos += (hours >= 20) ? 1 : 2;
-    sprintf(txt, "%02d", minutes);
-    printString(txt, digits5x8rn);
-    sprintf(txt, "%02d", seconds);
-    printString(txt, digits3x5);
+    DBG_WARN("Fleet sync: could not join %s", FLEET_GROUP);
   }
-  
-  // Bottom line: Date
-  yPos = 1;
-  xPos = 1;
-  const char* months[] = {"JAN","FEB","MAR","APR","MAY","JUN",
-                          "JUL","AUG","SEP","OCT","NOV","DEC"};
-  sprintf(txt, "%d&%s&%d", day, months[month - 1], year % 100);
-  printString(txt, font3x7);
-  
-  // Shift bottom line slightly
-  for (int i = 0; i < LINE_WIDTH; i++) scr[LINE_WIDTH + i] <<= 1;
 }
 
-void showMessage(const char* message) {
-  clr();
-  xPos = 0;
-  yPos = 0;
-  printString(message, font3x7);
-  refreshAll();
-}
+void serviceFleet() {
+  if (!FLEET_SYNC_ENABLED) return;
+  if (WiFi.status() != WL_CONNECTED) {
+    if (fleet.running()) {
+      stopFleet();
+      DBG_WARN("Fleet sync stopped (WiFi down)");
+    }
+    return;
+  }
+  // (Re)join after a reconnect, retrying a failed join every peer timeout
+  if ((!fleet.running() || WiFi.localIP() != fleetLocalIp) &&
+      (fleetStartedAt == 0 || millis() - fleetStartedAt >= FLEET_PEER_TIMEOUT)) {
+    startFleet();
+  }
 
-// ======================== TIME FUNCTIONS ========================
+  // Advertised quality: one stratum below the selected source; a clock in holdover
+  // (sources lost) still beats one that has no time at all
+  int64_t localUs = micros64();
+  int sel = timeSources.selected();
+  uint8_t stratum = FLEET_UNSYNCED;
+  uint32_t errorUs = 0xFFFFFFFF;
+  if (clockValid && sel >= 0) {
+    stratum = min(timeSources.last(sel).stratum + 1, FLEET_UNSYNCED - 1);
+    errorUs = timeSources.errorUs(sel, localUs);
+  } else if (clockValid) {
+    stratum = 16;  // NTP's "unsynchronized"
+  }
+  fleet.setLocal(stratum, errorUs, cycleEpochS, modeCycleHash());
+  fleet.service(localUs);
 
-bool syncNTP() {
-  DBG_INFO("Syncing NTP");
+  if (fleet.leaderId() != fleetLastLeader) {
+    fleetLastLeader = fleet.leaderId();
+    DBG_INFO("Fleet leader: %08lx%s (%d peers)", (unsigned long)fleetLastLeader, fleet.leading() ? " (this clock)" : "",
+             fleet.peerCount());
+  }
+}
 
-  const char* tzString = timezones[currentTimezone].tzString;
-  configTime(tzString, NTP_SERVERS);
+// ======================== WARM RESTART SNAPSHOT ========================
+// A checksummed copy of the clock and settings (rtcsnapshot.h) is kept in RTC user
+// memory, which survives ESP.restart(), OTA updates and watchdog/exception resets
+// (not power loss). It is written before every intentional restart, at the end of
+// an OTA update and every RTC_SNAPSHOT_INTERVAL. The RTC timer keeps counting
+// through the reset, so setup() can work out the current UTC from it (the "RTC
+// timer" time source) and show the clock before WiFi is up; the first NTP sync
+// then corrects it.
+
+void saveRtcSnapshot() {
+  lastRtcSnapshot = millis();
+  if (!clockValid) return;  // Nothing worth restoring yet
+
+  RtcSnapshot snap;
+  memset(&snap, 0, sizeof(snap));
+  snap.rtcTicks = system_get_rtc_time();
+  snap.utcUs = clockNowUs();
+  snap.temperatureDeci = temperatureDeci;
+  snap.pressureDeci = pressureDeci;
+  snap.humidity = humidity;
+  snap.timezone = currentTimezone;
+  snap.manualBrightness = manualBrightness;
+  snap.flags = (use24HourFormat ? RTC_SNAP_24H : 0) | (useFahrenheit ? RTC_SNAP_FAHRENHEIT : 0) |
+               (brightnessManualOverride ? RTC_SNAP_MANUAL_BRIGHTNESS : 0) |
+               (scheduleOffEnabled ? RTC_SNAP_SCHEDULE : 0) | (sensorAvailable ? RTC_SNAP_SENSOR : 0);
+  snap.scheduleStartHour = scheduleOffStartHour;
+  snap.scheduleStartMinute = scheduleOffStartMinute;
+  snap.scheduleEndHour = scheduleOffEndHour;
+  snap.scheduleEndMinute = scheduleOffEndMinute;
+  rtcSnapshotSeal(snap);
+  ESP.rtcUserMemoryWrite(RTC_SNAPSHOT_BLOCK, (uint32_t*)&snap, sizeof(snap));
+}
 
-  int attempts = 0;
-  while (!time(nullptr) && attempts < 20) {
-    delay(500);
-    attempts++;
+// Restores time and settings from a snapshot left by the previous run; false after
+// a power-on, a corrupt snapshot, or one older than RTC_SNAPSHOT_MAX_AGE
+bool restoreRtcSnapshot() {
+  RtcSnapshot snap;
+  if (!ESP.rtcUserMemoryRead(RTC_SNAPSHOT_BLOCK, (uint32_t*)&snap, sizeof(snap))) return false;
+  uint64_t elapsedUs;
+  switch (rtcSnapshotCheck(snap, system_get_rtc_time(), system_rtc_clock_cali_proc(), RTC_SNAPSHOT_MAX_AGE, elapsedUs)) {
+    case RTC_SNAPSHOT_VALID:
+      break;
+    case RTC_SNAPSHOT_CORRUPT:
+      return false;  // Power-on
+    case RTC_SNAPSHOT_RESET:
+    case RTC_SNAPSHOT_STALE:
+      DBG_INFO("RTC snapshot too old, waiting for NTP");
+      return false;
   }
 
-  if (attempts >= 20) {
-    DBG_WARN("NTP sync failed");
-    return false;
+  TimeSample t = {(int64_t)micros64(), snap.utcUs + (int64_t)elapsedUs,
+                  (uint32_t)(1000 + elapsedUs * RTC_TIMER_ERROR_PPM / 1000000), TIME_SOURCE_RTC_TIMER_STRATUM};
+  timeSources.post(tsRtcTimer, t);
+
+  if (snap.timezone < numTimezones) currentTimezone = snap.timezone;
+  use24HourFormat = snap.flags & RTC_SNAP_24H;
+  useFahrenheit = snap.flags & RTC_SNAP_FAHRENHEIT;
+  brightnessManualOverride = snap.flags & RTC_SNAP_MANUAL_BRIGHTNESS;
+  manualBrightness = constrain(snap.manualBrightness, 1, 15);
+  scheduleOffEnabled = snap.flags & RTC_SNAP_SCHEDULE;
+  scheduleOffStartHour = snap.scheduleStartHour % 24;
+  scheduleOffStartMinute = snap.scheduleStartMinute % 60;
+  scheduleOffEndHour = snap.scheduleEndHour % 24;
+  scheduleOffEndMinute = snap.scheduleEndMinute % 60;
+  if (snap.flags & RTC_SNAP_SENSOR) {
+    temperatureDeci = snap.temperatureDeci;
+    temperature = temperatureDeci / 10;
+    pressureDeci = snap.pressureDeci;
+    pressure = pressureDeci / 10;
+    humidity = snap.humidity;
+    sensorAvailable = true;
   }
-
-  updateTime();
-  DBG_INFO("Time synced: %02d:%02d:%02d (TZ: %s)", hours, minutes, seconds, timezones[currentTimezone].name);
+  DBG_INFO("Warm restart: clock restored from RTC snapshot (%lu ms old)", (unsigned long)(elapsedUs / 1000));
   return true;
 }
 
-void updateTime() {
-  time_t now = time(nullptr);
-  struct tm* timeinfo = localtime(&now);
+// ======================== TEMPERATURE COMPENSATION ========================
+// The crystal's frequency moves by several ppm with temperature, which the drift
+// estimate from past syncs cannot follow, so it is predicted from the BME280 reading
+// instead. tempComp (tempcomp.h) learns drift against temperature from the intervals
+// between NTP/PPS samples; once it has enough of them, every sensor read and every
+// sync sets the clock's frequency correction from it. The model is kept in flash
+// (EEPROM emulation) so that holdover after a power cut is compensated too.
 
-  // Keep 24-hour time for schedule logic
-  hours24 = timeinfo->tm_hour;
+#define TEMPCOMP_MAGIC 0x54434D31  // "TCM1"
 
-  // Convert to 12-hour format for display rendering
-  hours = (hours24 == 0) ? 12 : (hours24 > 12) ? hours24 - 12 : hours24;
+struct TempCompRecord {
+  uint32_t magic;
+  TempDriftState state;
+  uint32_t crc;
+};
+
+TempDriftModel tempComp;
+bool tempCompDirty = false;    // Learned since the last save
+
+void applyTempComp() {
+  if (!TEMPCOMP_ENABLED || !tempComp.ready() || !sensorAvailable) return;
+  clockDiscipline.setFrequencyPpb(micros64(), tempComp.predict(temperatureDeci));
+}
+
+void loadTempComp() {
+  TempCompRecord rec;
+  EEPROM.begin(TEMPCOMP_EEPROM_ADDR + sizeof(rec));
+  EEPROM.get(TEMPCOMP_EEPROM_ADDR, rec);
+  EEPROM.end();
+  if (rec.magic != TEMPCOMP_MAGIC || rec.crc != crc32((const uint8_t*)&rec, offsetof(TempCompRecord, crc))) {
+    DBG_INFO("Temp comp: no saved drift model");
+    return;
+  }
+  tempComp.state() = rec.state;
+  const TempDriftState& s = rec.state;
+  DBG_INFO("Temp comp: model loaded (%u intervals, %d.%d..%d.%d C, %d ppb at 25 C)", s.samples,
+           s.minDeci / 10, abs(s.minDeci % 10), s.maxDeci / 10, abs(s.maxDeci % 10), (int)s.a);
+}
+
+void saveTempComp() {
+  lastTempCompSave = millis();
+  if (!tempCompDirty) return;
+  TempCompRecord rec;
+  rec.magic = TEMPCOMP_MAGIC;
+  rec.state = tempComp.state();
+  rec.crc = crc32((const uint8_t*)&rec, offsetof(TempCompRecord, crc));
+  EEPROM.begin(TEMPCOMP_EEPROM_ADDR + sizeof(rec));
+  EEPROM.put(TEMPCOMP_EEPROM_ADDR, rec);
+  if (EEPROM.end()) {  // Commits and frees the RAM copy
+    tempCompDirty = false;
+    DBG_INFO("Temp comp: model saved (%u intervals)", rec.state.samples);
+  } else {
+    DBG_WARN("Temp comp: flash write failed");
+  }
+}
+
+// Called after every sensor read
+void tempCompTemperature(bool valid) {
+  if (!valid) {
+    tempComp.temperatureLost();
+    return;
+  }
+  tempComp.temperature(micros64(), temperatureDeci);
+  applyTempComp();
+}
 
-  minutes = timeinfo->tm_min;
-  seconds = timeinfo->tm_sec;
-  day = timeinfo->tm_mday;
-  month = timeinfo->tm_mon + 1;
-  year = timeinfo->tm_year + 1900;
-  dayOfWeek = timeinfo->tm_wday;
+// Called after a sample has disciplined the clock. Only NTP and PPS are good enough
+// to learn from; the RTC chip and timer would teach the model their own drift.
+void tempCompSync(const TimeSample& t) {
+  int sel = timeSources.selected();
+  if (sel == tsNtp || sel == tsPps) {
+    if (tempComp.sync(t.localUs, t.utcUs)) {
+      tempCompDirty = true;
+      DBG_VERBOSE("Temp comp: %u intervals, %d ppb at %d.%d C", tempComp.state().samples,
+                  (int)tempComp.predict(temperatureDeci), temperatureDeci / 10, abs(temperatureDeci % 10));
+    }
+  }
+  applyTempComp();  // The sync replaced the frequency with the sample-based estimate
 }
 
 // ======================== SENSOR FUNCTIONS ========================
@@ -499,9 +2313,13 @@ void testSensor() {
 }
 
 void updateSensorData() {
+  lastSensorUpdate = millis();
+
   // Read sensor values
-  temperature = (int)bme280.readTemperature();
-  pressure = (int)bme280.readPressure() / 100;  // Convert Pa to hPa
+  temperatureDeci = (int)(bme280.readTemperature() * 10);
+  temperature = temperatureDeci / 10;
+  pressureDeci = (int)bme280.readPressure() / 10;  // Convert Pa to 0.1 hPa
+  pressure = pressureDeci / 10;
   humidity = (int)bme280.readHumidity();
   
   // Check if readings are valid
@@ -511,7 +2329,160 @@ void updateSensorData() {
   } else {
     sensorAvailable = true;
     DBG_VERBOSE("Sensor: %dC, %d%% RH, %d hPa", temperature, humidity, pressure);
+    recordPressureSample(pressureDeci);
+    recordHistorySample();
+  }
+  tempCompTemperature(sensorAvailable);
+}
+
+// ======================== SENSOR HISTORY & SPARKLINE ========================
+// Fixed-point ring buffer covering SPARKLINE_HOURS. Each of the 32 display columns
+// covers historySamplesPerColumn samples drawn as a min..max bar on the bottom 8 rows.
+// The column bitmaps are rebuilt only when a sample arrives or the metric changes.
+
+struct SensorSample {
+  int16_t temperatureDeci;  // 0.1 C
+  uint16_t pressureDeci;    // 0.1 hPa
+  uint8_t humidity;         // %
+};
+
+const int historySamplesPerColumn = HISTORY_SAMPLES / LINE_WIDTH;
+const unsigned long historySampleInterval = SPARKLINE_HOURS * 3600000UL / HISTORY_SAMPLES;
+SensorSample sensorHistory[HISTORY_SAMPLES];
+int sensorHistoryHead = 0;      // Next write position
+int sensorHistoryCount = 0;
+unsigned long lastHistorySample = 0;
+
+int sampleValue(const SensorSample& s, SparklineMetric metric) {
+  switch (metric) {
+    case SPARK_HUMIDITY: return s.humidity;
+    case SPARK_PRESSURE: return s.pressureDeci;
+    default: return s.temperatureDeci;
+  }
+}
+
+// Smallest value span the graph is stretched to, so sensor noise stays flat
+int sparklineMinSpan(SparklineMetric metric) {
+  switch (metric) {
+    case SPARK_HUMIDITY: return 8;   // 8 %
+    case SPARK_PRESSURE: return 40;  // 4 hPa
+    default: return 20;              // 2 C
+  }
+}
+
+void rebuildSparkline() {
+  memset(sparklineColumns, 0, sizeof(sparklineColumns));
+  if (sensorHistoryCount == 0) return;
+
+  // Newest samples on the right; a partly filled history leaves the left side empty
+  int columns = (sensorHistoryCount + historySamplesPerColumn - 1) / historySamplesPerColumn;
+  int oldest = (sensorHistoryHead + HISTORY_SAMPLES - sensorHistoryCount) % HISTORY_SAMPLES;
+  int colMin[LINE_WIDTH], colMax[LINE_WIDTH];
+  int lo = INT16_MAX, hi = INT16_MIN;
+
+  for (int c = 0; c < columns; c++) {
+    colMin[c] = INT16_MAX;
+    colMax[c] = INT16_MIN;
+    // Align so the last column holds the newest sample
+    int first = sensorHistoryCount - (columns - c) * historySamplesPerColumn;
+    for (int k = 0; k < historySamplesPerColumn; k++) {
+      int i = first + k;
+      if (i < 0) continue;
+      int v = sampleValue(sensorHistory[(oldest + i) % HISTORY_SAMPLES], sparklineMetric);
+      colMin[c] = min(colMin[c], v);
+      colMax[c] = max(colMax[c], v);
+    }
+    lo = min(lo, colMin[c]);
+    hi = max(hi, colMax[c]);
+  }
+
+  int span = max(hi - lo, sparklineMinSpan(sparklineMetric));
+  int base = (lo + hi - span) / 2;  // Centre small ranges vertically
+  for (int c = 0; c < columns; c++) {
+    int top = 7 - (colMax[c] - base) * 7 / span;     // Row 0 = top of the band
+    int bottom = 7 - (colMin[c] - base) * 7 / span;
+    uint8_t bits = 0;
+    for (int r = top; r <= bottom; r++) bits |= 1 << r;
+    sparklineColumns[LINE_WIDTH - columns + c] = bits;
+  }
+}
+
+void setSparklineMetric(SparklineMetric metric) {
+  sparklineMetric = metric;
+  rebuildSparkline();
+}
+
+void recordHistorySample() {
+  unsigned long now = millis();
+  if (sensorHistoryCount > 0 && now - lastHistorySample < historySampleInterval) return;
+  lastHistorySample = now;
+
+  SensorSample& s = sensorHistory[sensorHistoryHead];
+  s.temperatureDeci = temperatureDeci;
+  s.pressureDeci = pressureDeci;
+  s.humidity = humidity;
+  sensorHistoryHead = (sensorHistoryHead + 1) % HISTORY_SAMPLES;
+  if (sensorHistoryCount < HISTORY_SAMPLES) sensorHistoryCount++;
+
+  rebuildSparkline();
+}
+
+// ======================== PRESSURE TREND & FORECAST ========================
+// One sample every PRESSURE_SAMPLE_INTERVAL in a ring covering 3 hours. The trend
+// and a Zambretti-style forecast are recomputed in O(1) when a sample arrives, so
+// the display only draws cached values.
+
+const int pressureHistorySlots = (3UL * 3600000UL) / PRESSURE_SAMPLE_INTERVAL + 1;
+uint16_t pressureHistory[pressureHistorySlots];  // 0.1 hPa
+int pressureHistoryHead = 0;                     // Next write position
+int pressureHistoryCount = 0;
+unsigned long lastPressureSample = 0;
+
+// Short labels that fit the 32px line in font3x7 (no Q/X glyphs)
+const char* const forecastLabels[] = {"SETTLED", "FINE", "FAIR", "SHOWERY", "CHANGE", "UNSETTLD", "RAIN", "STORMY"};
+
+// Zambretti number (1-32) -> label index
+const uint8_t forecastLabelIndex[32] PROGMEM = {
+  0, 1, 2, 2, 3, 5, 6, 6, 5,         // 1-9: falling
+  0, 1, 2, 2, 3, 4, 5, 6, 6, 7,      // 10-19: steady
+  0, 1, 1, 2, 2, 3, 4, 5, 5, 5, 5, 7, 7  // 20-32: rising
+};
+
+const char* forecastLabel() {
+  if (forecastCode == 0) return "WAIT";
+  return forecastLabels[pgm_read_byte(&forecastLabelIndex[forecastCode - 1])];
+}
+
+void recordPressureSample(int deciHpa) {
+  unsigned long now = millis();
+  if (pressureHistoryCount > 0 && now - lastPressureSample < PRESSURE_SAMPLE_INTERVAL) return;
+  lastPressureSample = now;
+
+  pressureHistory[pressureHistoryHead] = deciHpa;
+  pressureHistoryHead = (pressureHistoryHead + 1) % pressureHistorySlots;
+  if (pressureHistoryCount < pressureHistorySlots) pressureHistoryCount++;
+
+  // Need at least an hour of history before calling a trend
+  int spanSlots = pressureHistoryCount - 1;
+  if (spanSlots * PRESSURE_SAMPLE_INTERVAL < 3600000UL) return;
+
+  int oldest = pressureHistory[(pressureHistoryHead + pressureHistorySlots - pressureHistoryCount) % pressureHistorySlots];
+  pressureTrend = (deciHpa - oldest) * (pressureHistorySlots - 1) / spanSlots;  // Scale to 3 hours
+
+  // Zambretti: Z = 127 - 0.12P (falling), 144 - 0.13P (steady), 185 - 0.16P (rising),
+  // P = sea-level pressure in hPa; here p is in 0.1 hPa. Each trend keeps its own band.
+  long p = deciHpa + PRESSURE_SEA_LEVEL_OFFSET * 10L;
+  int z;
+  if (pressureTrend <= -16) {
+    z = constrain(127 - 12 * p / 1000, 1, 9);
+  } else if (pressureTrend >= 16) {
+    z = constrain(185 - 16 * p / 1000, 20, 32);
+  } else {
+    z = constrain(144 - 13 * p / 1000, 10, 19);
   }
+  forecastCode = z;
+  DBG_VERBOSE("Pressure %d.%d hPa, trend %d (0.1 hPa/3h), forecast Z%d %s",
+              deciHpa / 10, deciHpa % 10, pressureTrend, forecastCode, forecastLabel());
 }
 
 // ======================== BRIGHTNESS & MOTION ========================
@@ -697,7 +2668,26 @@ void handleBrightnessAndMotion() {
 
 // ======================== WEB SERVER ========================
 
+// Version of the zone list as used in its URL (hash of the names, see tzindex.h)
+String zoneListVersion() {
+  char v[9];
+  snprintf(v, sizeof(v), "%08lx", (unsigned long)tzZoneListVersion);
+  return String(v);
+}
+
+// s as a quoted JSON string, for text from the network or the query string
+String jsonQuoted(const char* s) {
+  String out = "\"";
+  jsonEscape(s, [&out](char c) { out += c; });
+  out += '"';
+  return out;
+}
+
 void setupWebServer() {
+  // Request headers the handlers read (the server discards all others)
+  static const char* headerKeys[] = {"If-None-Match"};
+  server.collectHeaders(headerKeys, 1);
+
   // Root page
   server.on("/", []() {
     String html = "<!DOCTYPE html><html><head><title>LED Clock</title>";
@@ -826,8 +2816,32 @@ void setupWebServer() {
     html += "}";
     html += "function setTimezone() {";
     html += "  let tz = document.getElementById('tz-select').value;";
+    html += "  if (tz === '') return;";
+    html += "  tzCurrent = +tz;";
     html += "  fetch('/timezone?tz=' + tz).then(()=>updateAll()).catch(e=>showError('Request failed'));";
     html += "}";
+    // Zone list: fetched once per firmware (versioned URL, cached by the browser)
+    html += "var tzNames = [], tzCurrent = " + String(currentTimezone) + ";";
+    html += "function showTimezones(zones, label) {";
+    html += "  let s = document.getElementById('tz-select');";
+    html += "  s.innerHTML = '';";
+    html += "  if (!zones.some(z=>z.index===tzCurrent)) s.add(new Option(label, '', true, true));";
+    html += "  zones.forEach(z=>s.add(new Option(z.name, z.index, false, z.index===tzCurrent)));";
+    html += "}";
+    html += "function allTimezones() { return tzNames.map((n,i)=>({index:i,name:n})); }";
+    html += "function loadTimezones() {";
+    html += "  fetch('/api/zones?v=" + zoneListVersion() + "').then(r=>r.text()).then(t=>{";
+    html += "    tzNames = t.split('\\n');";
+    html += "    showTimezones(allTimezones(), '');";
+    html += "  }).catch(e=>showError('Zone list failed'));";
+    html += "}";
+    html += "function searchTimezones() {";
+    html += "  let q = document.getElementById('tz-search').value.trim();";
+    html += "  if (!q) { showTimezones(allTimezones(), ''); return; }";
+    html += "  fetch('/api/zones/search?limit=50&q=' + encodeURIComponent(q)).then(r=>r.json()).then(d=>{";
+    html += "    showTimezones(d.results, d.count + ' match' + (d.count === 1 ? '' : 'es'));";
+    html += "  }).catch(e=>showError('Request failed'));";
+    html += "}";
     html += "function saveSchedule() {";
     html += "  let en = document.getElementById('sched-enabled').checked ? '1' : '0';";
     html += "  let sh = document.getElementById('sched-start-hour').value;";
@@ -839,6 +2853,7 @@ void setupWebServer() {
     html += "}";
     html += "window.addEventListener('load', function() {";
     html += "  connErr=document.getElementById('conn-error');";
+    html += "  loadTimezones();";
     html += "  updateAll();";
     html += "  updateDisplay();";
     html += "  setInterval(updateAll, 2000);";
@@ -847,7 +2862,7 @@ void setupWebServer() {
     html += "</script>";
     html += "</head><body>";
     html += "<h1>LED Matrix Clock</h1>";
-    html += "<div class='card'><h2>Current Time (<span id='timezone-name'>" + String(timezones[currentTimezone].name) + "</span>) &amp; Environment</h2>";
+    html += "<div class='card'><h2>Current Time (<span id='timezone-name'>" + String(FPSTR(timezoneNameP(currentTimezone))) + "</span>) &amp; Environment</h2>";
     html += "<p class='digital-time' id='time-display'>" + String(hours) + ":" +
             (minutes < 10 ? "0" : "") + String(minutes) + ":" +
             (seconds < 10 ? "0" : "") + String(seconds);
@@ -917,7 +2932,7 @@ void setupWebServer() {
     html += String(use24HourFormat ? "Switch to 12-hour" : "Switch to 24-hour");
     html += "</button></p>";
     html += "<p style='font-size:12px;color:#666;margin-top:-5px;'>";
-    html += "Note: In 24-hour mode the LED matrix shows HH:MM (no seconds) due to 32px display width limitations.";
+    html += "Note: The LED matrix uses the largest font that fits 32px; the large-time mode may omit seconds.";
     html += "</p>";
 
     // Temperature Unit Section
@@ -929,13 +2944,10 @@ void setupWebServer() {
     
     // Timezone Selection Section (auto-updates on change)
     html += "<h4 style='margin-top:15px;margin-bottom:5px;'>Timezone</h4>";
-    html += "<p><label>Select Timezone: <select id='tz-select' onchange='setTimezone()' style='padding:5px;'>";
-    for (int i = 0; i < numTimezones; i++) {
-      html += "<option value='" + String(i) + "'" + String(i == currentTimezone ? " selected" : "") + ">";
-      html += String(timezones[i].name);
-      html += "</option>";
-    }
-    html += "</select></label></p>";
+    html += "<p><input id='tz-search' type='search' placeholder='Search city or country' oninput='searchTimezones()' style='padding:5px;'> ";
+    html += "<select id='tz-select' onchange='setTimezone()' style='padding:5px;'>";
+    html += "<option selected>" + String(FPSTR(timezoneNameP(currentTimezone))) + "</option>";  // Until the list loads
+    html += "</select></p>";
     
     // Display Schedule Section (AJAX, no form POST)
     html += "<h4 style='margin-top:15px;margin-bottom:5px;'>Display Schedule</h4>";
@@ -1065,6 +3077,11 @@ void setupWebServer() {
     json += String(humidity);
     json += ",\"pressure\":";
     json += String(pressure);
+    json += ",\"pressure_trend\":";
+    json += String(pressureTrend);
+    json += ",\"forecast\":\"";
+    json += String(forecastLabel());
+    json += "\"";
     json += ",\"sensor_available\":";
     json += String(sensorAvailable ? "true" : "false");
     json += ",\"schedule_enabled\":";
@@ -1078,8 +3095,45 @@ void setupWebServer() {
     json += (scheduleOffEndHour < 10 ? "0" : "") + String(scheduleOffEndHour) + ":";
     json += (scheduleOffEndMinute < 10 ? "0" : "") + String(scheduleOffEndMinute);
     json += "\",\"timezone_name\":\"";
-    json += String(timezones[currentTimezone].name);
-    json += "\"}";
+    json += FPSTR(timezoneNameP(currentTimezone));
+    json += "\",\"display_mode\":\"";
+    json += String(displayModes[currentMode].name);
+    json += "\",\"ntp_state\":\"";
+    json += String(ntpStateNames[ntpState]);
+    json += "\",\"ntp_latency_ms\":";
+    json += String(ntpLastLatency);
+    json += ",\"ntp_last_sync_s\":";
+    json += String(ntpSyncCount ? (long)((millis() - ntpLastSync) / 1000) : -1L);
+    json += ",\"ntp_syncs\":";
+    json += String(ntpSyncCount);
+    json += ",\"ntp_failures\":";
+    json += String(ntpFailCount);
+    if (ntpSyncCount) {
+      const SntpSample& best = sntp.best();
+      json += ",\"ntp_server\":\"";
+      json += String(sntp.server(best.server).host);
+      json += "\",\"ntp_stratum\":";
+      json += String(best.stratum);
+      json += ",\"ntp_offset_us\":";
+      json += String((long)best.offsetUs);
+      json += ",\"ntp_delay_us\":";
+      json += String((long)best.delayUs);
+    }
+    json += ",\"clock_offset_us\":";
+    json += String((long)clockDiscipline.lastOffsetUs());
+    json += ",\"clock_drift_ppm\":";
+    json += String(clockDiscipline.freqPpm(), 2);
+    json += ",\"clock_poll_s\":";
+    json += String(clockDiscipline.pollIntervalS());
+    json += ",\"time_source\":\"";
+    json += String(timeSources.selected() >= 0 ? timeSources.name(timeSources.selected()) : "none");
+    json += "\",\"tempcomp_intervals\":";
+    json += String(tempComp.state().samples);
+    if (tempComp.ready() && sensorAvailable) {
+      json += ",\"tempcomp_ppb\":";
+      json += String(tempComp.predict(temperatureDeci));
+    }
+    json += "}";
 
 
     // Reset light changed flag after reading
@@ -1120,12 +3174,7 @@ void setupWebServer() {
 
       // Force an immediate redraw so the user sees the change instantly on the matrix
       if (displayOn) {
-        switch (currentMode) {
-          case 0: displayTimeAndTemp(); break;
-          case 1: displayTimeLarge(); break;
-          case 2: displayTimeAndDate(); break;
-        }
-        refreshAll();
+        renderCurrentMode();
       }
 
       server.send(200, "text/plain", "OK");
@@ -1143,12 +3192,7 @@ void setupWebServer() {
 
       // Force an immediate redraw so the user sees the change instantly on the matrix
       if (displayOn) {
-        switch (currentMode) {
-          case 0: displayTimeAndTemp(); break;
-          case 1: displayTimeLarge(); break;
-          case 2: displayTimeAndDate(); break;
-        }
-        refreshAll();
+        renderCurrentMode();
       }
 
       server.send(200, "text/plain", "OK");
@@ -1157,22 +3201,595 @@ void setupWebServer() {
     server.send(200, "text/plain", "OK");
   });
   
+  // Zone names, one per line in index order: /api/zones?v=<version>. With the
+  // current version (as the root page requests it) the response may be cached for
+  // good: a firmware with different zones has a different URL.
+  server.on("/api/zones", []() {
+    String etag = "\"" + zoneListVersion() + "\"";
+    bool current = server.arg("v") == zoneListVersion();
+    server.sendHeader("ETag", etag);
+    server.sendHeader("Cache-Control", current ? "public, max-age=31536000, immutable" : "no-cache");
+    if (server.header("If-None-Match") == etag) {
+      server.send(304);
+      return;
+    }
+    server.setContentLength(tzZoneListBytes);
+    server.send(200, "text/plain", "");
+    char buf[128];
+    for (size_t pos = 0; pos < tzZoneListBytes; pos += sizeof(buf)) {
+      size_t n = min(sizeof(buf), tzZoneListBytes - pos);
+      memcpy_P(buf, tzZoneNames + pos, n);
+      for (size_t i = 0; i < n; i++) {
+        if (buf[i] == '\0') buf[i] = '\n';
+      }
+      server.sendContent(buf, n);
+    }
+  });
+
+  // Zones with a word starting with q: /api/zones/search?q=york&limit=10
+  server.on("/api/zones/search", []() {
+    server.sendHeader("Cache-Control", "no-cache");
+    uint16_t zones[TZ_SEARCH_MAX_RESULTS];
+    int limit = server.hasArg("limit") ? server.arg("limit").toInt() : 10;
+    limit = constrain(limit, 1, TZ_SEARCH_MAX_RESULTS);
+    int count = timezoneSearch(server.arg("q").c_str(), zones, limit);
+    String json = "{\"count\":" + String(count) + ",\"results\":[";
+    for (int i = 0; i < count && i < limit; i++) {
+      if (i) json += ",";
+      json += "{\"index\":" + String(zones[i]) + ",\"name\":\"";
+      json += FPSTR(timezoneNameP(zones[i]));
+      json += "\"}";
+    }
+    json += "]}";
+    server.send(200, "application/json", json);
+  });
+
   // Timezone configuration endpoint (now accepts GET for AJAX)
   server.on("/timezone", []() {
     server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
     if (server.hasArg("tz")) {
       int newTimezone = server.arg("tz").toInt();
       if (newTimezone >= 0 && newTimezone < numTimezones) {
-        currentTimezone = newTimezone;
-        DBG_INFO("Timezone: %s", timezones[currentTimezone].name);
-        
-        // Re-sync time with new timezone
-        syncNTP();
+        uint32_t startUs = micros();
+        applyTimezone(newTimezone);
+        unsigned long applyUs = micros() - startUs;
+        char tzName[TZ_NAME_MAX];
+        DBG_INFO("Timezone: %s (applied in %lu us)", timezoneName(currentTimezone, tzName), applyUs);
+
+        // UTC is unaffected by the zone; only an unsynchronised clock needs the network
+        if (!clockValid && ntpState != NTP_REQUESTED) {
+          requestNtpSync();
+        }
       }
     }
     server.send(200, "text/plain", "OK");
   });
   
+  // Display mode configuration endpoint
+  //   /modes?cycle=0,2,1                    set cycle order (mode indices)
+  //   /modes?mode=1&dwell=10&enabled=0      per-mode dwell (seconds) and enable flag
+  // Always responds with the current configuration.
+  server.on("/modes", []() {
+    server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+
+    if (server.hasArg("cycle")) {
+      String list = server.arg("cycle");
+      uint8_t newCycle[MODE_CYCLE_MAX];
+      int count = 0;
+      int start = 0;
+      while (start < (int)list.length() && count < MODE_CYCLE_MAX) {
+        int comma = list.indexOf(',', start);
+        if (comma < 0) comma = list.length();
+        String entry = list.substring(start, comma);
+        entry.trim();
+        // toInt() would take "abc" as 0: only plain mode indices are accepted
+        bool numeric = entry.length() > 0 && entry.length() <= 3;
+        for (unsigned int i = 0; numeric && i < entry.length(); i++) numeric = isdigit(entry[i]);
+        int mode = numeric ? entry.toInt() : -1;
+        if (mode < 0 || mode >= numDisplayModes) {
+          server.send(400, "text/plain", "Expected mode indices 0-" + String(numDisplayModes - 1) + ", comma separated");
+          return;
+        }
+        newCycle[count++] = mode;
+        start = comma + 1;
+      }
+      if (count > 0) {
+        memcpy(modeCycle, newCycle, count);
+        modeCycleLength = count;
+        restartModeCycle();
+        DBG_INFO("Mode cycle: %d entries", modeCycleLength);
+      }
+    }
+
+    if (server.hasArg("mode")) {
+      int mode = server.arg("mode").toInt();
+      if (mode >= 0 && mode < numDisplayModes) {
+        if (server.hasArg("dwell")) {
+          displayModes[mode].dwellMs = constrain(server.arg("dwell").toInt(), 1, 3600) * 1000UL;
+        }
+        if (server.hasArg("enabled")) {
+          displayModes[mode].enabled = (server.arg("enabled") == "1");
+        }
+        restartModeCycle();
+        DBG_INFO("Mode %s: dwell=%lus %s", displayModes[mode].name,
+                 displayModes[mode].dwellMs / 1000, displayModes[mode].enabled ? "enabled" : "disabled");
+      }
+    }
+
+    String json = "{\"current\":";
+    json += String(currentMode);
+    json += ",\"cycle\":[";
+    for (int i = 0; i < modeCycleLength; i++) {
+      if (i) json += ",";
+      json += String(modeCycle[i]);
+    }
+    json += "],\"modes\":[";
+    for (int i = 0; i < numDisplayModes; i++) {
+      if (i) json += ",";
+      json += "{\"name\":\"" + String(displayModes[i].name) + "\"";
+      json += ",\"dwell\":" + String(displayModes[i].dwellMs / 1000);
+      json += ",\"fps\":" + String(1000 / displayModes[i].frameIntervalMs);
+      json += ",\"enabled\":" + String(displayModes[i].enabled ? "true" : "false") + "}";
+    }
+    json += "]}";
+    server.send(200, "application/json", json);
+  });
+
+  // World clock zone list endpoint
+  //   /worldclock?zones=0,29,12   indices into the timezone list
+  server.on("/worldclock", []() {
+    server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    if (server.hasArg("zones")) {
+      String list = server.arg("zones");
+      uint8_t indices[WORLD_CLOCK_MAX_ZONES];
+      int count = 0;
+      int start = 0;
+      while (start < (int)list.length() && count < WORLD_CLOCK_MAX_ZONES) {
+        int comma = list.indexOf(',', start);
+        if (comma < 0) comma = list.length();
+        int tz = list.substring(start, comma).toInt();
+        if (tz >= 0 && tz < numTimezones) indices[count++] = tz;
+        start = comma + 1;
+      }
+      setWorldZones(indices, count);
+    }
+
+    String json = "{\"zones\":[";
+    for (int i = 0; i < numWorldZones; i++) {
+      if (i) json += ",";
+      json += "{\"index\":" + String(worldZones[i].tzIndex);
+      json += ",\"abbrev\":\"" + String(worldZones[i].abbrev) + "\"";
+      json += ",\"name\":\"" + String(FPSTR(timezoneNameP(worldZones[i].tzIndex))) + "\"}";
+    }
+    json += "]}";
+    server.send(200, "application/json", json);
+  });
+
+  // Stopwatch / countdown control endpoint
+  //   /api/timer?mode=stopwatch|countdown&action=start|stop|reset[&duration=<seconds>]
+  // mode defaults to stopwatch; duration (1-359999 s) sets and re-arms the countdown
+  // and needs mode=countdown and a countdown that is not running. Bad input answers
+  // 400 (409 for a running countdown) and changes nothing. Starting a timer pins the
+  // display to it until reset. Always responds with state and the 10 Hz frame-period
+  // histogram.
+  server.on("/api/timer", []() {
+    server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    String modeArg = server.hasArg("mode") ? server.arg("mode") : String("stopwatch");
+    if (modeArg != "stopwatch" && modeArg != "countdown") {
+      server.send(400, "text/plain", "Expected mode=stopwatch or mode=countdown");
+      return;
+    }
+    bool countdown = modeArg == "countdown";
+    IntervalTimer& t = countdown ? countdownTimer : stopwatchTimer;
+    int mode = countdown ? MODE_COUNTDOWN : MODE_STOPWATCH;
+
+    String action = server.arg("action");
+    if (server.hasArg("action") && action != "start" && action != "stop" && action != "reset") {
+      server.send(400, "text/plain", "Expected action=start, stop or reset");
+      return;
+    }
+
+    long durationS = 0;
+    if (server.hasArg("duration")) {
+      // toInt() would take "abc" as 0: only plain seconds are accepted
+      String d = server.arg("duration");
+      bool numeric = countdown && d.length() > 0 && d.length() <= 6;
+      for (unsigned int i = 0; numeric && i < d.length(); i++) numeric = isdigit(d[i]);
+      durationS = numeric ? d.toInt() : 0;
+      if (durationS < 1 || durationS > 359999) {
+        server.send(400, "text/plain", "Expected mode=countdown&duration=1-359999 (seconds)");
+        return;
+      }
+      if (countdownTimer.running) {
+        server.send(409, "text/plain", "Countdown running; stop or reset it first");
+        return;
+      }
+      countdownTimer.durationMs = durationS * 1000LL;
+      timerReset(countdownTimer);
+    }
+    if (server.hasArg("action")) {
+      if (action == "start") {
+        if (countdown && countdownRemainingMs() == 0) timerReset(t);  // Re-arm once expired
+        timerStart(t);
+        pinnedMode = mode;
+        resetFramePeriodStats();
+      } else if (action == "stop") {
+        timerStop(t);
+      } else {
+        timerReset(t);
+        if (pinnedMode == mode) {
+          pinnedMode = -1;
+          advanceModeCycle();
+        }
+      }
+      redrawRequested = true;
+      DBG_INFO("Timer %s: %s", countdown ? "countdown" : "stopwatch", action.c_str());
+    }
+
+    String json = "{\"stopwatch\":{\"running\":";
+    json += String(stopwatchTimer.running ? "true" : "false");
+    json += ",\"elapsed_ms\":" + String((long)timerElapsedMs(stopwatchTimer));
+    json += "},\"countdown\":{\"running\":";
+    json += String(countdownTimer.running ? "true" : "false");
+    json += ",\"duration_ms\":" + String((long)countdownTimer.durationMs);
+    json += ",\"remaining_ms\":" + String((long)countdownRemainingMs());
+    json += "},\"frame_period\":{\"bounds_ms\":[";
+    for (int i = 0; i < numFramePeriodBuckets - 1; i++) {
+      if (i) json += ",";
+      json += String(framePeriodBoundsMs[i]);
+    }
+    json += "],\"counts\":[";
+    for (int i = 0; i < numFramePeriodBuckets; i++) {
+      if (i) json += ",";
+      json += String(framePeriodHist[i]);
+    }
+    json += "],\"max_us\":" + String(maxFramePeriodUs) + "}}";
+    server.send(200, "application/json", json);
+  });
+
+  // Second-flip latency: /api/flip (?reset=1 clears the histogram)
+  server.on("/api/flip", []() {
+    if (server.hasArg("reset")) resetFlipLatencyStats();
+
+    String json = "{\"flips\":" + String(flipCount);
+    json += ",\"bounds_us\":[";
+    for (int i = 0; i < numFlipLatencyBuckets - 1; i++) {
+      if (i) json += ",";
+      json += String(flipLatencyBoundsUs[i]);
+    }
+    json += "],\"counts\":[";
+    for (int i = 0; i < numFlipLatencyBuckets; i++) {
+      if (i) json += ",";
+      json += String(flipLatencyHist[i]);
+    }
+    json += "],\"max_us\":" + String(maxFlipLatencyUs) + "}";
+    server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    server.send(200, "application/json", json);
+  });
+
+  // Sparkline metric endpoint: /sparkline?metric=temperature|humidity|pressure
+  server.on("/sparkline", []() {
+    if (server.hasArg("metric")) {
+      String m = server.arg("metric");
+      if (m == "humidity") setSparklineMetric(SPARK_HUMIDITY);
+      else if (m == "pressure") setSparklineMetric(SPARK_PRESSURE);
+      else setSparklineMetric(SPARK_TEMPERATURE);
+      redrawRequested = true;
+      DBG_INFO("Sparkline metric: %s", m.c_str());
+    }
+    server.send(200, "text/plain", "OK");
+  });
+
+  // Notification push endpoint
+  //   /api/message?text=BUILD%20FAILED&priority=5&ttl=300&repeat=2
+  // priority 0-9 (higher first), ttl seconds to live if not yet shown, repeat = scroll passes.
+  // A missing or empty text is a 400; a queue full of higher-priority messages a 503.
+  server.on("/api/message", []() {
+    server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    if (server.arg("text").length() == 0) {
+      server.send(400, "text/plain", "Expected text=<message>");
+      return;
+    }
+    int priority = server.hasArg("priority") ? server.arg("priority").toInt() : 5;
+    unsigned long ttl = server.hasArg("ttl") ? constrain(server.arg("ttl").toInt(), 1, 86400) : NOTIFY_DEFAULT_TTL;
+    int repeats = server.hasArg("repeat") ? server.arg("repeat").toInt() : 1;
+    bool coalesced = false;
+    bool accepted = enqueueNotification(server.arg("text").c_str(), priority, ttl * 1000UL, repeats, &coalesced);
+    int code = accepted ? 200 : 503;  // Full of higher-priority messages
+
+    String json = "{\"accepted\":";
+    json += String(accepted ? "true" : "false");
+    json += ",\"coalesced\":";
+    json += String(coalesced ? "true" : "false");
+    json += ",\"depth\":" + String(notifyDepth());
+    json += ",\"capacity\":" + String(NOTIFY_QUEUE_SIZE);
+    json += ",\"coalesced_total\":" + String(notifyCoalesced);
+    json += ",\"dropped_total\":" + String(notifyDropped);
+    json += "}";
+    server.send(code, "application/json", json);
+  });
+
+  // Weather source endpoint
+  //   /weather?host=api.openweathermap.org&port=80&path=/data/2.5/weather%3Fq%3DSydney,AU%26units%3Dmetric%26appid%3D...
+  //   /weather?refresh=1   fetch on the next loop pass
+  // Reports the cached result; the path (which carries the API key) is not echoed.
+  server.on("/weather", []() {
+    server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    bool changed = false;
+    if (server.hasArg("host")) {
+      strlcpy(weatherHost, server.arg("host").c_str(), sizeof(weatherHost));
+      changed = true;
+    }
+    if (server.hasArg("port")) {
+      weatherPort = constrain(server.arg("port").toInt(), 1, 65535);
+      changed = true;
+    }
+    if (server.hasArg("path")) {
+      strlcpy(weatherPath, server.arg("path").c_str(), sizeof(weatherPath));
+      changed = true;
+    }
+    if (changed) {
+      weatherHttp.stop();
+      weatherData.valid = false;
+      redrawRequested = true;
+      DBG_INFO("Weather source: %s:%u", weatherHost, weatherPort);
+    }
+    if (changed || server.hasArg("refresh")) {
+      weatherNextFetch = millis();
+    }
+
+    String json = "{\"host\":" + jsonQuoted(weatherHost);
+    json += ",\"port\":" + String(weatherPort);
+    json += ",\"valid\":" + String(weatherData.valid ? "true" : "false");
+    if (weatherData.valid) {
+      json += ",\"temp\":" + String(weatherData.tempDeci / 10.0, 1);
+      json += ",\"humidity\":" + String(weatherData.humidity);
+      json += ",\"pressure\":" + String(weatherData.pressure);
+      json += ",\"condition\":" + jsonQuoted(weatherData.condition);
+      json += ",\"condition_id\":" + String(weatherData.conditionId);
+      json += ",\"city\":" + jsonQuoted(weatherData.city);
+      json += ",\"age_s\":" + String((millis() - weatherFetchedAt) / 1000);
+    }
+    json += ",\"fetching\":" + String(weatherHttp.busy() ? "true" : "false");
+    json += ",\"fetches\":" + String(weatherFetches);
+    json += ",\"failures\":" + String(weatherFailures);
+    json += "}";
+    server.send(200, "application/json", json);
+  });
+
+  // NTP servers and per-server statistics: /ntp?servers=pool.ntp.org,192.168.1.10:1123&sync=1
+  server.on("/ntp", []() {
+    server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    if (server.hasArg("servers")) {
+      if (!setNtpServers(server.arg("servers").c_str())) {
+        server.send(400, "text/plain", "Expected host[:port][,host[:port]...]");
+        return;
+      }
+    }
+    if ((server.hasArg("servers") || server.hasArg("sync")) && ntpState != NTP_REQUESTED) {
+      requestNtpSync();
+    }
+
+    String json = "{\"state\":\"" + String(ntpStateNames[ntpState]) + "\"";
+    json += ",\"servers\":[";
+    for (int i = 0; i < sntp.serverCount(); i++) {
+      const SntpClient::Server& sv = sntp.server(i);
+      if (i) json += ",";
+      json += "{\"host\":" + jsonQuoted(sv.host);
+      json += ",\"port\":" + String(sv.port);
+      json += ",\"replies\":" + String(sv.replies);
+      json += ",\"misses\":" + String(sv.misses);
+      if (sv.replies) {
+        json += ",\"stratum\":" + String(sv.last.stratum);
+        json += ",\"offset_us\":" + String((long)sv.last.offsetUs);
+        json += ",\"delay_us\":" + String((long)sv.last.delayUs);
+      }
+      json += "}";
+    }
+    json += "]";
+    if (ntpSyncCount) {
+      json += ",\"selected\":" + String(sntp.best().server);
+    }
+    json += "}";
+    server.send(200, "application/json", json);
+  });
+
+  // Time sources, selection and quality: /timesources
+  server.on("/timesources", []() {
+    server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    int64_t localUs = micros64();
+    int64_t utcUs = clockNowUs();
+    String json = "{\"selected\":";
+    json += timeSources.selected() >= 0 ? "\"" + String(timeSources.name(timeSources.selected())) + "\"" : "null";
+    json += ",\"switches\":" + String(timeSources.switches());
+    json += ",\"sources\":[";
+    for (int i = 0; i < timeSources.count(); i++) {
+      if (i) json += ",";
+      json += "{\"name\":\"" + String(timeSources.name(i)) + "\"";
+      json += ",\"available\":" + String(timeSources.available(i, localUs) ? "true" : "false");
+      json += ",\"samples\":" + String(timeSources.samples(i));
+      json += ",\"sets\":" + String(timeSources.sets(i));
+      if (timeSources.samples(i)) {
+        const TimeSample& t = timeSources.last(i);
+        json += ",\"stratum\":" + String(t.stratum);
+        json += ",\"error_us\":" + String(timeSources.errorUs(i, localUs));
+        json += ",\"age_s\":" + String((long)((localUs - t.localUs) / 1000000));
+        if (clockValid) json += ",\"offset_us\":" + String((long)timeSources.offsetUs(i, localUs, utcUs));
+      }
+      json += "}";
+    }
+    json += "]}";
+    server.send(200, "application/json", json);
+  });
+
+  // Sync quality and recent sync events: /api/sync
+  server.on("/api/sync", []() {
+    server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    int64_t localUs = micros64();
+    uint32_t nowS = localUs / 1000000;
+    int sel = timeSources.selected();
+    String json = "{\"source\":";
+    json += sel >= 0 ? "\"" + String(timeSources.name(sel)) + "\"" : "null";
+    json += ",\"synced\":" + String(clockValid ? "true" : "false");
+    if (sel >= 0) json += ",\"error_us\":" + String(timeSources.errorUs(sel, localUs));
+    json += ",\"drift_ppm\":" + String(clockDiscipline.freqPpm(), 3);
+    json += ",\"jitter_us\":" + String(syncJitterUs());
+    json += ",\"poll_s\":" + String(clockDiscipline.pollIntervalS());
+    json += ",\"syncs\":" + String(syncCount);
+    json += ",\"failures\":" + String(syncFailures);
+    json += ",\"steps\":" + String(clockDiscipline.steps());
+    json += ",\"jumps\":" + String(clockJumps);
+    json += ",\"max_jump_us\":" + String(maxClockJumpUs);
+    json += ",\"events\":[";
+    for (int i = syncLogCount - 1; i >= 0; i--) {  // Newest first
+      const SyncEvent& e = syncEvent(i);
+      if (i != syncLogCount - 1) json += ",";
+      json += "{\"age_s\":" + String(nowS - e.atS);
+      json += ",\"source\":\"" + String(e.source >= 0 ? timeSources.name(e.source) : "none") + "\"";
+      if (e.flags & SYNC_EVENT_FAILED) {
+        json += ",\"failed\":true";
+      } else {
+        json += ",\"offset_us\":" + String(e.offsetUs);
+        json += ",\"error_us\":" + String(e.errorUs);
+        if (e.flags & SYNC_EVENT_STEP) json += ",\"step\":true";
+      }
+      if (e.durationMs) json += ",\"duration_ms\":" + String(e.durationMs);
+      json += "}";
+    }
+    json += "]}";
+    server.send(200, "application/json", json);
+  });
+
+  // The same in Prometheus text format: /metrics
+  server.on("/metrics", []() {
+    int64_t localUs = micros64();
+    int sel = timeSources.selected();
+    const SyncEvent* last = lastSyncEvent();
+    String out;
+    out.reserve(2048);
+    promMetric(out, "clock_synced", "gauge", "1 once the clock has been set", clockValid ? "1" : "0");
+    for (int i = 0; i < timeSources.count(); i++) {
+      String labels = "{source=\"" + String(timeSources.name(i)) + "\"}";
+      if (i == 0) out += "# HELP ledclock_time_source_selected 1 for the source driving the clock\n"
+                         "# TYPE ledclock_time_source_selected gauge\n";
+      out += "ledclock_time_source_selected" + labels + (i == sel ? " 1\n" : " 0\n");
+    }
+    if (sel >= 0) {
+      promMetric(out, "clock_error_seconds", "gauge", "Error bound of the selected source now",
+                 String(timeSources.errorUs(sel, localUs) / 1e6, 6));
+    }
+    if (last) {
+      promMetric(out, "clock_offset_seconds", "gauge", "Offset measured by the last sync",
+                 String(last->offsetUs / 1e6, 6));
+      promMetric(out, "last_sync_age_seconds", "gauge", "Time since the last sync",
+                 String((uint32_t)(localUs / 1000000) - last->atS));
+      promMetric(out, "sync_duration_seconds", "gauge", "Request to reply time of the last sync",
+                 String(last->durationMs / 1e3, 3));
+    }
+    promMetric(out, "clock_jitter_seconds", "gauge", "RMS difference of successive sync offsets",
+               String(syncJitterUs() / 1e6, 6));
+    promMetric(out, "clock_drift_ppm", "gauge", "Frequency correction of the local crystal",
+               String(clockDiscipline.freqPpm(), 3));
+    promMetric(out, "clock_poll_interval_seconds", "gauge", "Current NTP poll interval",
+               String(clockDiscipline.pollIntervalS()));
+    promMetric(out, "syncs_total", "counter", "Samples applied to the clock", String(syncCount));
+    promMetric(out, "sync_failures_total", "counter", "NTP syncs without a usable reply", String(syncFailures));
+    promMetric(out, "clock_steps_total", "counter", "Offsets stepped instead of slewed", String(clockDiscipline.steps()));
+    promMetric(out, "clock_jumps_total", "counter", "Visible jumps of the displayed time", String(clockJumps));
+    promMetric(out, "fleet_peers", "gauge", "Other clocks heard on the fleet group", String(fleet.peerCount()));
+    promMetric(out, "fleet_following", "gauge", "1 while the display follows the fleet leader",
+               fleet.following() ? "1" : "0");
+    promMetric(out, "fleet_offset_seconds", "gauge", "Display timebase shift onto the fleet leader",
+               String(fleet.offsetUs() / 1e6, 6));
+    for (int i = 0; i < sntp.serverCount(); i++) {
+      const SntpClient::Server& sv = sntp.server(i);
+      String labels = promLabel("server", sv.host);
+      if (i == 0) out += "# HELP ledclock_ntp_replies_total Usable replies per NTP server\n"
+                         "# TYPE ledclock_ntp_replies_total counter\n";
+      out += "ledclock_ntp_replies_total" + labels + " " + String(sv.replies) + "\n";
+    }
+    for (int i = 0; i < sntp.serverCount(); i++) {
+      const SntpClient::Server& sv = sntp.server(i);
+      String labels = promLabel("server", sv.host);
+      if (i == 0) out += "# HELP ledclock_ntp_misses_total Requests without a usable reply per NTP server\n"
+                         "# TYPE ledclock_ntp_misses_total counter\n";
+      out += "ledclock_ntp_misses_total" + labels + " " + String(sv.misses) + "\n";
+    }
+    server.send(200, "text/plain; version=0.0.4", out);
+  });
+
+  // Fleet sync state and the clocks seen on the network: /api/fleet
+  server.on("/api/fleet", []() {
+    server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    int64_t localUs = micros64();
+    char id[9];
+    snprintf(id, sizeof(id), "%08lx", (unsigned long)fleet.id());
+    String json = "{\"enabled\":" + String(FLEET_SYNC_ENABLED ? "true" : "false");
+    json += ",\"running\":" + String(fleet.running() ? "true" : "false");
+    json += ",\"id\":\"" + String(id) + "\"";
+    snprintf(id, sizeof(id), "%08lx", (unsigned long)fleet.leaderId());
+    json += ",\"leader\":" + (fleet.leaderId() ? "\"" + String(id) + "\"" : String("null"));
+    json += ",\"leading\":" + String(fleet.leading() ? "true" : "false");
+    json += ",\"following\":" + String(fleet.following() ? "true" : "false");
+    json += ",\"offset_us\":" + String((long)fleet.offsetUs());
+    json += ",\"cycle_epoch\":" + String(fleet.epochS());
+    json += ",\"cycle_match\":" + String(fleet.cycleMatches() ? "true" : "false");
+    json += ",\"beacons_sent\":" + String(fleet.beaconsSent());
+    json += ",\"peers\":[";
+    for (int i = 0; i < fleet.peerCount(); i++) {
+      const FleetSync::Peer& p = fleet.peer(i);
+      snprintf(id, sizeof(id), "%08lx", (unsigned long)p.id);
+      if (i) json += ",";
+      json += "{\"id\":\"" + String(id) + "\"";
+      json += ",\"ip\":\"" + IPAddress(p.ip).toString() + "\"";
+      if (p.stratum != FLEET_UNSYNCED) {
+        json += ",\"stratum\":" + String(p.stratum);
+        json += ",\"error_us\":" + String(p.errorUs);
+      }
+      json += ",\"beacons\":" + String(p.beacons);
+      json += ",\"age_ms\":" + String((long)((localUs - p.seenUs) / 1000));
+      json += "}";
+    }
+    json += "]}";
+    server.send(200, "application/json", json);
+  });
+
+  // Calendar feed endpoint
+  //   /calendar?url=http://192.168.1.10:8080/team.ics   (empty url disables)
+  //   /calendar?refresh=1   fetch on the next loop pass
+  // Reports the kept upcoming events (start as UTC epoch seconds).
+  server.on("/calendar", []() {
+    server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    if (server.hasArg("url")) {
+      if (!setCalendarUrl(server.arg("url").c_str())) {
+        server.send(400, "text/plain", "Expected http://host[:port]/path");
+        return;
+      }
+      redrawRequested = true;
+    }
+    if (server.hasArg("refresh")) {
+      calendarNextFetch = millis();
+    }
+
+    String json = "{\"host\":" + jsonQuoted(calendarHost);
+    json += ",\"port\":" + String(calendarPort);
+    json += ",\"events\":[";
+    for (int i = 0; i < calendar.count(); i++) {
+      const IcalEvent& e = calendar.event(i);
+      if (i) json += ",";
+      json += "{\"start\":" + String((long)e.start);
+      json += ",\"all_day\":" + String(e.allDay ? "true" : "false");
+      json += ",\"summary\":" + jsonQuoted(e.summary) + "}";
+    }
+    json += "],\"etag\":" + jsonQuoted(calendar.etag());
+    json += ",\"fetching\":" + String(calendarHttp.busy() ? "true" : "false");
+    json += ",\"fetches\":" + String(calendarFetches);
+    json += ",\"not_modified\":" + String(calendarNotModified);
+    json += ",\"failures\":" + String(calendarFailures);
+    json += "}";
+    server.send(200, "application/json", json);
+  });
+
   // Display on/off toggle endpoint
   server.on("/display", []() {
     if (server.hasArg("mode")) {
@@ -1236,6 +3853,7 @@ void setupWebServer() {
       "<html><body><h1>WiFi Reset</h1><p>WiFi settings cleared. Device will restart...</p></body></html>");
     delay(1000);
     wifiManager.resetSettings();
+    saveRtcSnapshot();
     ESP.restart();
   });
 }
@@ -1245,9 +3863,9 @@ void setupWebServer() {
 void configModeCallback(WiFiManager* myWiFiManager) {
   DBG_INFO("WiFi config mode - connect to AP: %s", WIFI_AP_NAME);
   DBG_INFO("Config portal IP: %s", WiFi.softAPIP().toString().c_str());
-  showMessage("SETUP AP");
+  showMessage(MSG_SETUP_AP);
   delay(2000);
-  showMessage("LED CLOCK");
+  showMessage(MSG_LED_CLOCK);
 }
 
 void printBanner() {
@@ -1260,6 +3878,8 @@ void printBanner() {
   Serial.printf("Version: %s\n", VERSION);
   Serial.printf("Build Date: %s %s\n", BUILD_DATE, BUILD_TIME);
   Serial.printf("Author: Anthony Clarke\n");
+  Serial.printf("Timezones: %d zones, %d rules, %u bytes in flash (%u bytes of RAM freed)\n", numTimezones,
+                TZ_RULE_COUNT, (unsigned)tzTableFlashBytes, (unsigned)tzTableRamSavedBytes);
   Serial.println();
 }
 
@@ -1277,6 +3897,9 @@ void printStatus() {
     DBG_INFO("Sensor not available");
   }
   DBG_INFO("Light: %d | Bright: %d", lightLevel, brightness);
+  DBG_INFO("NTP: %s | Syncs: %u | Fails: %u | Latency: %ld ms", ntpStateNames[ntpState],
+           ntpSyncCount, ntpFailCount, ntpLastLatency);
+  DBG_INFO("Time source: %s", timeSources.selected() >= 0 ? timeSources.name(timeSources.selected()) : "none");
   bool withinOffWindow = isWithinScheduleOffWindow();
   const char* schedStat = !scheduleOffEnabled ? "DISABLED" : (withinOffWindow ? "ACTIVE-OFF" : "ACTIVE");
   DBG_INFO("Motion: %s | Display: %s | Timer: %d | Sched: %s (%02d:%02d-%02d:%02d)",
@@ -0,0 +1,55 @@
+#pragma once
+// Host stand-in for the parts of the Arduino core that the modules under include/
+// use, so they build in the native test environment (see platformio.ini).
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+
+#define PROGMEM
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+#define pgm_read_word(p) (*(const uint16_t*)(p))
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define PGM_P const char*
+
+using std::max;
+using std::min;
+
+// Part of the ESP8266 libc; glibc only has it from 2.38
+#if defined(__GLIBC__)
+#if !__GLIBC_PREREQ(2, 38)
+inline size_t strlcpy(char* dst, const char* src, size_t size) {
+  size_t n = strlen(src);
+  if (size) {
+    size_t k = n < size - 1 ? n : size - 1;
+    memcpy(dst, src, k);
+    dst[k] = '\0';
+  }
+  return n;
+}
+#endif
+#endif
+
+inline char* strncpy_P(char* dst, const char* src, size_t n) {
+  size_t i = 0;
+  for (; i < n && src[i]; i++) dst[i] = src[i];
+  for (; i < n; i++) dst[i] = '\0';
+  return dst;
+}
+
+inline uint64_t micros64() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t)t.tv_sec * 1000000 + t.tv_nsec / 1000;
+}
+
+inline unsigned long micros() { return (unsigned long)micros64(); }
+inline unsigned long millis() { return (unsigned long)(micros64() / 1000); }
+inline void delay(unsigned long ms) { usleep(ms * 1000); }
+inline void yield() {}
@@ -0,0 +1,151 @@
+#pragma once
+// Host stand-in for the ESP8266WiFi classes the network modules use: IPAddress,
+// a WiFiClient on a POSIX TCP socket and name resolution. The station is always
+// "connected"; tests talk to stand-in servers on 127.0.0.1.
+
+#include <Arduino.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+enum wl_status_t { WL_IDLE_STATUS = 0, WL_CONNECTED = 3, WL_DISCONNECTED = 6 };
+
+// IPv4 address, kept in network byte order as on the ESP
+class IPAddress {
+ public:
+  IPAddress() {}
+  IPAddress(uint32_t addr) : _addr(addr) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+      : _addr(htonl((uint32_t)a << 24 | (uint32_t)b << 16 | (uint32_t)c << 8 | d)) {}
+
+  operator uint32_t() const { return _addr; }
+  bool operator==(const IPAddress& o) const { return _addr == o._addr; }
+  bool operator!=(const IPAddress& o) const { return _addr != o._addr; }
+
+  bool fromString(const char* s) {
+    struct in_addr a;
+    if (inet_pton(AF_INET, s, &a) != 1) return false;
+    _addr = a.s_addr;
+    return true;
+  }
+
+  bool isSet() const { return _addr != 0; }
+
+ private:
+  uint32_t _addr = 0;
+};
+
+class WiFiClient {
+ public:
+  ~WiFiClient() { stop(); }
+
+  void setTimeout(unsigned long ms) { _timeoutMs = ms; }
+
+  void setNoDelay(bool on) {
+    int v = on;
+    if (_fd >= 0) setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &v, sizeof(v));
+  }
+
+  int connect(IPAddress ip, uint16_t port) {
+    stop();
+    _fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (_fd < 0) return 0;
+    fcntl(_fd, F_SETFL, O_NONBLOCK);
+    struct sockaddr_in a = {};
+    a.sin_family = AF_INET;
+    a.sin_port = htons(port);
+    a.sin_addr.s_addr = (uint32_t)ip;
+    if (::connect(_fd, (struct sockaddr*)&a, sizeof(a)) != 0) {
+      struct pollfd p = {_fd, POLLOUT, 0};
+      int err = 0;
+      socklen_t len = sizeof(err);
+      if (errno != EINPROGRESS || poll(&p, 1, _timeoutMs) != 1 ||
+          getsockopt(_fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0) {
+        stop();
+        return 0;
+      }
+    }
+    return 1;
+  }
+
+  size_t print(const char* s) {
+    size_t n = strlen(s);
+    size_t sent = 0;
+    while (_fd >= 0 && sent < n) {
+      ssize_t k = send(_fd, s + sent, n - sent, MSG_NOSIGNAL);
+      if (k > 0) {
+        sent += k;
+      } else if (k < 0 && errno == EAGAIN) {
+        struct pollfd p = {_fd, POLLOUT, 0};
+        if (poll(&p, 1, _timeoutMs) != 1) break;
+      } else {
+        break;
+      }
+    }
+    return sent;
+  }
+
+  int available() {
+    int n = 0;
+    if (_fd < 0 || ioctl(_fd, FIONREAD, &n) != 0) return 0;
+    return n;
+  }
+
+  // Open, or closed by the peer with data still unread
+  uint8_t connected() {
+    if (_fd < 0) return 0;
+    if (available() > 0) return 1;
+    char c;
+    ssize_t k = recv(_fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    return k > 0 || (k < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+  }
+
+  int read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+  }
+
+  int read(uint8_t* buf, size_t size) {
+    if (_fd < 0) return -1;
+    ssize_t k = recv(_fd, buf, size, MSG_DONTWAIT);
+    return k > 0 ? (int)k : -1;
+  }
+
+  void stop() {
+    if (_fd >= 0) close(_fd);
+    _fd = -1;
+  }
+
+ private:
+  int _fd = -1;
+  unsigned long _timeoutMs = 1000;
+};
+
+class ESP8266WiFiClass {
+ public:
+  wl_status_t status() const { return WL_CONNECTED; }
+
+  // Blocking lookup, as the SDK's; the timeout is not enforced on the host
+  int hostByName(const char* host, IPAddress& ip, uint32_t timeoutMs = 10000) {
+    hostLookups++;
+    if (lookupDelayMs) delay(lookupDelayMs);
+    struct addrinfo hints = {};
+    struct addrinfo* res = nullptr;
+    hints.ai_family = AF_INET;
+    if (getaddrinfo(host, nullptr, &hints, &res) != 0 || !res) return 0;
+    ip = IPAddress(((struct sockaddr_in*)res->ai_addr)->sin_addr.s_addr);
+    freeaddrinfo(res);
+    return 1;
+  }
+
+  uint32_t hostLookups = 0;    // For tests: lookups done so far...
+  uint32_t lookupDelayMs = 0;  // ...and how long each one takes (a slow DNS server)
+};
+
+inline ESP8266WiFiClass WiFi;
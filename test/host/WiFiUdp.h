@@ -0,0 +1,88 @@
+#pragma once
+// Host stand-in for the ESP8266 WiFiUDP class on a POSIX UDP socket: one socket
+// bound by begin() both receives and sends, and parsePacket() takes the next
+// datagram without blocking, as on the ESP.
+
+#include <ESP8266WiFi.h>
+#include <string.h>
+
+class WiFiUDP {
+ public:
+  ~WiFiUDP() { stop(); }
+
+  uint8_t begin(uint16_t port) {
+    stop();
+    _fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (_fd < 0) return 0;
+    int one = 1;
+    setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in a = {};
+    a.sin_family = AF_INET;
+    a.sin_port = htons(port);
+    a.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(_fd, (struct sockaddr*)&a, sizeof(a)) != 0) {
+      stop();
+      return 0;
+    }
+    return 1;
+  }
+
+  void stop() {
+    if (_fd >= 0) close(_fd);
+    _fd = -1;
+    _len = _pos = 0;
+  }
+
+  int beginPacket(IPAddress ip, uint16_t port) {
+    if (_fd < 0) return 0;
+    _to = {};
+    _to.sin_family = AF_INET;
+    _to.sin_port = htons(port);
+    _to.sin_addr.s_addr = (uint32_t)ip;
+    _out = 0;
+    return 1;
+  }
+
+  size_t write(const uint8_t* data, size_t len) {
+    if (len > sizeof(_outBuf) - _out) len = sizeof(_outBuf) - _out;
+    memcpy(_outBuf + _out, data, len);
+    _out += len;
+    return len;
+  }
+
+  int endPacket() {
+    return _fd >= 0 && sendto(_fd, _outBuf, _out, 0, (struct sockaddr*)&_to, sizeof(_to)) == (ssize_t)_out;
+  }
+
+  int parsePacket() {
+    if (_fd < 0) return 0;
+    socklen_t len = sizeof(_from);
+    ssize_t n = recvfrom(_fd, _buf, sizeof(_buf), MSG_DONTWAIT, (struct sockaddr*)&_from, &len);
+    _len = n > 0 ? n : 0;
+    _pos = 0;
+    return _len;
+  }
+
+  int available() const { return _len - _pos; }
+
+  int read(uint8_t* buf, size_t size) {
+    size_t n = std::min(size, _len - _pos);
+    memcpy(buf, _buf + _pos, n);
+    _pos += n;
+    return n;
+  }
+
+  void flush() { _pos = _len; }
+
+  IPAddress remoteIP() const { return IPAddress(_from.sin_addr.s_addr); }
+  uint16_t remotePort() const { return ntohs(_from.sin_port); }
+
+ private:
+  int _fd = -1;
+  uint8_t _buf[1500];
+  size_t _len = 0, _pos = 0;
+  struct sockaddr_in _from = {};
+  uint8_t _outBuf[1500];
+  size_t _out = 0;
+  struct sockaddr_in _to = {};
+};
@@ -0,0 +1,97 @@
+#pragma once
+// Local HTTP server for the network tests. Serves one connection at a time on
+// 127.0.0.1 from a background thread: reads the request head, asks the responder
+// for the raw response and sends it in small pieces with pauses, so clients see
+// it arrive over many polls. Every request head is kept for inspection.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class HttpStandIn {
+ public:
+  // Raw response (status line, headers, body) for a request head; "" drops the connection
+  typedef std::function<std::string(const std::string& request)> Responder;
+
+  explicit HttpStandIn(Responder responder, size_t piece = 64, int pauseMs = 1)
+      : _responder(std::move(responder)), _piece(piece), _pauseMs(pauseMs) {}
+
+  ~HttpStandIn() { stop(); }
+
+  // Listens on an ephemeral port; returns it (0 on failure)
+  uint16_t start() {
+    _fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in a = {};
+    a.sin_family = AF_INET;
+    a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(a);
+    if (bind(_fd, (struct sockaddr*)&a, sizeof(a)) != 0 || listen(_fd, 4) != 0 ||
+        getsockname(_fd, (struct sockaddr*)&a, &len) != 0) {
+      return 0;
+    }
+    _running = true;
+    _thread = std::thread([this]() { serve(); });
+    return ntohs(a.sin_port);
+  }
+
+  void stop() {
+    if (!_running) return;
+    _running = false;
+    _thread.join();
+    close(_fd);
+  }
+
+  std::vector<std::string> requests() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _requests;
+  }
+
+ private:
+  Responder _responder;
+  size_t _piece;
+  int _pauseMs;
+  int _fd = -1;
+  std::atomic<bool> _running{false};
+  std::thread _thread;
+  std::mutex _mutex;
+  std::vector<std::string> _requests;
+
+  void serve() {
+    while (_running) {
+      struct pollfd p = {_fd, POLLIN, 0};
+      if (poll(&p, 1, 20) != 1) continue;
+      int c = accept(_fd, nullptr, nullptr);
+      if (c < 0) continue;
+
+      std::string head;
+      char buf[256];
+      while (head.find("\r\n\r\n") == std::string::npos) {
+        ssize_t k = recv(c, buf, sizeof(buf), 0);
+        if (k <= 0) break;
+        head.append(buf, k);
+      }
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _requests.push_back(head);
+      }
+
+      std::string response = _responder(head);
+      for (size_t i = 0; i < response.size(); i += _piece) {
+        send(c, response.data() + i, std::min(_piece, response.size() - i), MSG_NOSIGNAL);
+        std::this_thread::sleep_for(std::chrono::milliseconds(_pauseMs));
+      }
+      close(c);  // HTTP/1.0: end of body
+    }
+  }
+};
@@ -0,0 +1,273 @@
+// CalendarFeed against a local HTTP stand-in: the .ics body streams through
+// HttpStream into IcalStream, re-fetches carry the ETag / Last-Modified validators
+// of the previous response, so an unchanged feed is answered with 304 and no body,
+// and a feed cut off mid-transfer leaves the events and validators as they were.
+
+#include <unity.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <Arduino.h>
+#include "httpstandin.h"
+#include "httpstream.h"
+#include "calendarfeed.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const char* icsV1 =
+    "BEGIN:VCALENDAR\r\n"
+    "VERSION:2.0\r\n"
+    "PRODID:-//Test//Stand-in//EN\r\n"
+    "BEGIN:VEVENT\r\n"
+    "UID:1@test\r\n"
+    "DTSTART:20261020T090000Z\r\n"
+    "SUMMARY:Standup\r\n"
+    "BEGIN:VALARM\r\n"
+    "TRIGGER:-PT15M\r\n"
+    "DTSTART:19700101T000000Z\r\n"
+    "SUMMARY:Alarm\r\n"
+    "END:VALARM\r\n"
+    "END:VEVENT\r\n"
+    "BEGIN:VEVENT\r\n"
+    "UID:2@test\r\n"
+    "DTSTART;TZID=Australia/Sydney:20261021T143000\r\n"
+    "SUMMARY:Dentist\\, then\r\n"
+    "  lunch\r\n"
+    "END:VEVENT\r\n"
+    "BEGIN:VEVENT\r\n"
+    "UID:3@test\r\n"
+    "DTSTART;VALUE=DATE:20261225\r\n"
+    "SUMMARY:Christmas\r\n"
+    "END:VEVENT\r\n"
+    "END:VCALENDAR\r\n";
+
+static const char* icsV2 =
+    "BEGIN:VCALENDAR\r\n"
+    "BEGIN:VEVENT\r\n"
+    "DTSTART:20261101T080000Z\r\n"
+    "SUMMARY:Moved\r\n"
+    "END:VEVENT\r\n"
+    "END:VCALENDAR\r\n";
+
+// Stand-in feed: serves the current version and honours conditional requests
+struct Feed {
+  std::string body = icsV1;
+  std::string etag = "\"v1\"";
+  std::string lastModified = "Sat, 17 Oct 2026 08:00:00 GMT";
+  bool ignoreValidators = false;
+  size_t cutAt = std::string::npos;  // Connection dropped after this many body bytes
+
+  std::string respond(const std::string& request) {
+    bool match = request.find("\r\nIf-None-Match: " + etag + "\r\n") != std::string::npos;
+    if (match && !ignoreValidators) {
+      return "HTTP/1.1 304 Not Modified\r\nETag: " + etag + "\r\n\r\n";
+    }
+    return "HTTP/1.1 200 OK\r\nContent-Type: text/calendar; charset=utf-8\r\nETag: " + etag +
+           "\r\nLast-Modified: " + lastModified + "\r\n\r\n" + body.substr(0, cutAt);
+  }
+};
+
+// Wall-clock times are read in a fixed UTC+11 (Sydney in summer)
+static int64_t sydneyToUtc(int64_t wallS) { return wallS - 11 * 3600; }
+
+// Client side: the calendar section of main.cpp drives CalendarFeed the same way
+struct Calendar {
+  CalendarFeed feed{sydneyToUtc};
+  int fetches = 0, notModified = 0, failures = 0;
+  uint32_t bodyBytes = 0;
+};
+
+static const int64_t NOW = 1792224000;  // 2026-10-17 08:00 UTC
+
+static int fetch(Calendar& cal, uint16_t port) {
+  const char* validators = cal.feed.begin(NOW);
+  HttpStream http;
+  http.onHeader(CalendarFeed::headerHandler);
+  http.onBody(CalendarFeed::bodyHandler);
+  cal.fetches++;
+  http.begin("127.0.0.1", port, "/basic.ics", validators, 1000, 2000, &cal.feed);
+  while (http.busy()) {
+    http.poll(64);
+    usleep(200);
+  }
+  cal.bodyBytes = http.bodyBytes();
+  int status = http.status();
+  switch (cal.feed.finish(http.state() == HttpStream::DONE, status)) {
+    case CalendarFeed::NOT_MODIFIED:
+      cal.notModified++;
+      break;
+    case CalendarFeed::UPDATED:
+      break;
+    case CalendarFeed::FAILED:
+      cal.failures++;
+      break;
+  }
+  return status;
+}
+
+static int64_t utc(int y, int mo, int d, int h, int mi) {
+  return (int64_t)tzDaysFromCivil(y, mo, d) * 86400 + h * 3600 + mi * 60;
+}
+
+void test_full_fetch_parses_events() {
+  Feed feed;
+  HttpStandIn server([&feed](const std::string& r) { return feed.respond(r); }, 40, 1);
+  uint16_t port = server.start();
+  TEST_ASSERT_TRUE(port != 0);
+
+  Calendar cal;
+  TEST_ASSERT_EQUAL(200, fetch(cal, port));
+  TEST_ASSERT_EQUAL(3, cal.feed.count());
+
+  TEST_ASSERT_TRUE(cal.feed.event(0).utc);
+  TEST_ASSERT_TRUE(cal.feed.event(0).start == utc(2026, 10, 20, 9, 0));
+  TEST_ASSERT_EQUAL_STRING("Standup", cal.feed.event(0).summary);  // Not the VALARM's
+
+  TEST_ASSERT_TRUE(cal.feed.event(1).utc);                         // TZID: read as local time
+  TEST_ASSERT_TRUE(cal.feed.event(1).start == utc(2026, 10, 21, 3, 30));
+  TEST_ASSERT_EQUAL_STRING("Dentist, then lunch", cal.feed.event(1).summary);  // Unfolded
+
+  TEST_ASSERT_TRUE(cal.feed.event(2).allDay);
+  TEST_ASSERT_TRUE(cal.feed.event(2).start == utc(2026, 12, 24, 13, 0));
+
+  TEST_ASSERT_EQUAL_STRING("\"v1\"", cal.feed.etag());
+  TEST_ASSERT_EQUAL_STRING("Sat, 17 Oct 2026 08:00:00 GMT", cal.feed.lastModified());
+
+  std::vector<std::string> req = server.requests();
+  TEST_ASSERT_EQUAL(1, (int)req.size());
+  TEST_ASSERT_TRUE(req[0].find("If-None-Match") == std::string::npos);  // First fetch is unconditional
+}
+
+void test_unchanged_feed_is_not_modified() {
+  Feed feed;
+  HttpStandIn server([&feed](const std::string& r) { return feed.respond(r); }, 40, 1);
+  uint16_t port = server.start();
+
+  Calendar cal;
+  TEST_ASSERT_EQUAL(200, fetch(cal, port));
+  uint32_t fullBytes = cal.bodyBytes;
+  TEST_ASSERT_EQUAL(304, fetch(cal, port));
+  TEST_ASSERT_EQUAL(1, cal.notModified);
+  TEST_ASSERT_EQUAL(0, cal.failures);
+  TEST_ASSERT_EQUAL(0, (int)cal.bodyBytes);           // No body transferred...
+  TEST_ASSERT_EQUAL(3, cal.feed.count());             // ...and the events are kept
+  TEST_ASSERT_EQUAL_STRING("\"v1\"", cal.feed.etag());
+  TEST_ASSERT_GREATER_THAN(0, (int)fullBytes);
+
+  std::vector<std::string> req = server.requests();
+  TEST_ASSERT_EQUAL(2, (int)req.size());
+  TEST_ASSERT_TRUE(req[1].find("\r\nIf-None-Match: \"v1\"\r\n") != std::string::npos);
+  TEST_ASSERT_TRUE(req[1].find("\r\nIf-Modified-Since: Sat, 17 Oct 2026 08:00:00 GMT\r\n") != std::string::npos);
+}
+
+void test_changed_feed_is_fetched_again() {
+  Feed feed;
+  HttpStandIn server([&feed](const std::string& r) { return feed.respond(r); }, 40, 1);
+  uint16_t port = server.start();
+
+  Calendar cal;
+  TEST_ASSERT_EQUAL(200, fetch(cal, port));
+  feed.body = icsV2;
+  feed.etag = "\"v2\"";
+  feed.lastModified = "Sat, 17 Oct 2026 09:30:00 GMT";
+  TEST_ASSERT_EQUAL(200, fetch(cal, port));  // Validators no longer match
+  TEST_ASSERT_EQUAL(0, cal.notModified);
+  TEST_ASSERT_EQUAL(1, cal.feed.count());
+  TEST_ASSERT_EQUAL_STRING("Moved", cal.feed.event(0).summary);
+  TEST_ASSERT_EQUAL_STRING("\"v2\"", cal.feed.etag());
+  TEST_ASSERT_EQUAL(304, fetch(cal, port));
+}
+
+// A server that ignores the validators still works, just without the saving
+void test_server_without_conditional_support() {
+  Feed feed;
+  feed.ignoreValidators = true;
+  HttpStandIn server([&feed](const std::string& r) { return feed.respond(r); }, 40, 1);
+  uint16_t port = server.start();
+
+  Calendar cal;
+  TEST_ASSERT_EQUAL(200, fetch(cal, port));
+  TEST_ASSERT_EQUAL(200, fetch(cal, port));
+  TEST_ASSERT_EQUAL(0, cal.notModified);
+  TEST_ASSERT_EQUAL(3, cal.feed.count());
+}
+
+void test_failed_fetch_keeps_events_and_validators() {
+  Feed feed;
+  HttpStandIn server([&feed](const std::string& r) { return feed.respond(r); }, 40, 1);
+  uint16_t port = server.start();
+
+  Calendar cal;
+  TEST_ASSERT_EQUAL(200, fetch(cal, port));
+  server.stop();  // Feed goes away
+  fetch(cal, port);
+  TEST_ASSERT_EQUAL(1, cal.failures);
+  TEST_ASSERT_EQUAL(3, cal.feed.count());
+  TEST_ASSERT_EQUAL_STRING("\"v1\"", cal.feed.etag());
+}
+
+// HTTP/1.0 ends the body with the connection, so a drop mid-feed looks like a whole
+// 200; without END:VCALENDAR it must not replace the events or the validators
+void test_truncated_feed_changes_nothing() {
+  Feed feed;
+  HttpStandIn server([&feed](const std::string& r) { return feed.respond(r); }, 40, 1);
+  uint16_t port = server.start();
+
+  Calendar cal;
+  feed.cutAt = feed.body.find("BEGIN:VEVENT\r\nUID:3");
+  TEST_ASSERT_EQUAL(200, fetch(cal, port));
+  TEST_ASSERT_EQUAL(1, cal.failures);
+  TEST_ASSERT_EQUAL(0, cal.feed.count());
+  TEST_ASSERT_EQUAL_STRING("", cal.feed.etag());  // Next fetch is unconditional
+
+  feed.cutAt = std::string::npos;
+  TEST_ASSERT_EQUAL(200, fetch(cal, port));
+  TEST_ASSERT_EQUAL(3, cal.feed.count());
+
+  // A new version cut off just before its last line: every event arrived, but the
+  // calendar is still not known to be whole
+  feed.body = icsV2;
+  feed.etag = "\"v2\"";
+  feed.cutAt = feed.body.find("END:VCALENDAR");
+  TEST_ASSERT_EQUAL(200, fetch(cal, port));
+  TEST_ASSERT_EQUAL(2, cal.failures);
+  TEST_ASSERT_EQUAL(3, cal.feed.count());
+  TEST_ASSERT_EQUAL_STRING("Standup", cal.feed.event(0).summary);
+  TEST_ASSERT_EQUAL_STRING("\"v1\"", cal.feed.etag());
+
+  // The retry still asks with the old validators, which no longer match
+  feed.cutAt = std::string::npos;
+  TEST_ASSERT_EQUAL(200, fetch(cal, port));
+  TEST_ASSERT_EQUAL(1, cal.feed.count());
+  TEST_ASSERT_EQUAL_STRING("\"v2\"", cal.feed.etag());
+  TEST_ASSERT_EQUAL(0, cal.notModified);
+}
+
+// Started events are dropped, and with them the validators: the next fetch refills
+void test_prune_clears_validators() {
+  Feed feed;
+  HttpStandIn server([&feed](const std::string& r) { return feed.respond(r); }, 40, 1);
+  uint16_t port = server.start();
+
+  Calendar cal;
+  TEST_ASSERT_EQUAL(200, fetch(cal, port));
+  TEST_ASSERT_FALSE(cal.feed.prune(utc(2026, 10, 20, 8, 59)));
+  TEST_ASSERT_TRUE(cal.feed.prune(utc(2026, 10, 20, 9, 0)));
+  TEST_ASSERT_EQUAL(2, cal.feed.count());
+  TEST_ASSERT_EQUAL_STRING("Dentist, then lunch", cal.feed.event(0).summary);
+  TEST_ASSERT_EQUAL_STRING("", cal.feed.etag());
+  TEST_ASSERT_EQUAL(200, fetch(cal, port));  // Not a 304
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_full_fetch_parses_events);
+  RUN_TEST(test_unchanged_feed_is_not_modified);
+  RUN_TEST(test_changed_feed_is_fetched_again);
+  RUN_TEST(test_server_without_conditional_support);
+  RUN_TEST(test_failed_fetch_keeps_events_and_validators);
+  RUN_TEST(test_truncated_feed_changes_nothing);
+  RUN_TEST(test_prune_clears_validators);
+  return UNITY_END();
+}
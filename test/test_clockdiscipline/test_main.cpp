@@ -0,0 +1,167 @@
+// ClockDiscipline driven by a simulated oscillator: a crystal with a fixed error
+// plus a daily temperature wander, read at 10 Hz like the display loop, and synced
+// against a reference with network jitter at the poll interval the discipline asks
+// for. Checks what the display depends on: the error stays small, the frequency is
+// learnt, the poll interval backs off, and the time never jumps between frames.
+
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include "clockdiscipline.h"
+
+void setUp() {}
+void tearDown() {}
+
+// The config main.cpp builds from config.h
+static const ClockDisciplineConfig config = {64, 16384, 128000, 500, 20000, 100000, 4};
+
+static const int64_t FRAME_US = 100000;
+static const int64_t UTC0 = 1767225600000000LL;  // 2026-01-01
+
+struct Oscillator {
+  double ppm;           // Counter runs fast by this much (positive) ...
+  double wanderPpm;     // ... plus a sinusoidal daily wander of this amplitude
+  double utc = UTC0;    // True UTC, integrated per frame
+
+  // Advances one frame of local counter time; returns true UTC
+  int64_t tick(int64_t localUs) {
+    double drift = ppm + wanderPpm * sin(localUs / 86400e6 * 2 * M_PI);
+    utc += FRAME_US / (1 + drift * 1e-6);
+    return (int64_t)utc;
+  }
+};
+
+struct SimResult {
+  int syncs = 0;
+  int64_t maxErrorUs = 0;     // |displayed - true| after the first hour
+  int64_t maxJumpUs = 0;      // Largest deviation of a frame step from FRAME_US
+  uint32_t minPollAfterDay1 = UINT32_MAX;
+  uint32_t finalPoll = 0;
+  double finalPpm = 0;
+};
+
+// Runs `days` of frames; jitterUs is the +-range of the reference error per sync
+static SimResult simulate(ClockDiscipline& cd, Oscillator& osc, double days, int jitterUs, unsigned seed) {
+  SimResult r;
+  srand(seed);
+  int64_t nextSync = 0, prev = 0;
+  for (int64_t local = FRAME_US; local < days * 86400e6; local += FRAME_US) {
+    int64_t trueUtc = osc.tick(local);
+    if (local >= nextSync) {
+      int64_t jitter = jitterUs ? (rand() % (2 * jitterUs + 1)) - jitterUs : 0;
+      cd.sync(local, trueUtc + jitter);
+      r.syncs++;
+      nextSync = local + (int64_t)cd.pollIntervalS() * 1000000;
+      if (local > 86400e6 && cd.pollIntervalS() < r.minPollAfterDay1) r.minPollAfterDay1 = cd.pollIntervalS();
+    }
+    int64_t shown = cd.now(local);
+    if (local > 3600e6) r.maxErrorUs = std::max<int64_t>(r.maxErrorUs, llabs(shown - trueUtc));
+    if (prev) r.maxJumpUs = std::max<int64_t>(r.maxJumpUs, llabs(shown - prev - FRAME_US));
+    prev = shown;
+  }
+  r.finalPoll = cd.pollIntervalS();
+  r.finalPpm = cd.freqPpm();
+  return r;
+}
+
+static void report(const char* name, const SimResult& r, const ClockDiscipline& cd) {
+  char msg[192];
+  snprintf(msg, sizeof(msg), "%s: %d syncs, %u steps, freq %.2f ppm, poll %u s, max error %lld us, max frame jump %lld us",
+           name, r.syncs, (unsigned)cd.steps(), r.finalPpm, (unsigned)r.finalPoll, (long long)r.maxErrorUs,
+           (long long)r.maxJumpUs);
+  TEST_MESSAGE(msg);
+}
+
+// 40 ppm fast crystal, +-5 ppm daily wander, 2 ms jitter, three days
+void test_drifting_oscillator() {
+  ClockDiscipline cd(config);
+  Oscillator osc = {40, 5};
+  SimResult r = simulate(cd, osc, 3, 2000, 1);
+  report("40+-5 ppm", r, cd);
+
+  TEST_ASSERT_EQUAL(0, (int)cd.steps());                         // Only ever slewed
+  TEST_ASSERT_TRUE_MESSAGE(r.finalPpm < -30 && r.finalPpm > -50, "frequency error not learnt");
+  TEST_ASSERT_TRUE_MESSAGE(r.finalPoll >= 4096, "poll interval did not back off");
+  TEST_ASSERT_TRUE_MESSAGE(r.minPollAfterDay1 >= 1024, "poll interval collapsed after settling");
+  TEST_ASSERT_TRUE_MESSAGE(r.maxErrorUs < 100000, "clock error above the loose threshold");
+  // A frame may move by the slew limit plus the residual frequency error, never more
+  TEST_ASSERT_TRUE_MESSAGE(r.maxJumpUs <= FRAME_US * (config.slewMaxPpm + 60) / 1000000, "displayed time jumped");
+  TEST_ASSERT_LESS_THAN(200, r.syncs);  // ~3 days at 64 s would be 4000
+}
+
+// The same crystal without wander or jitter: the model converges tightly
+void test_steady_oscillator_converges() {
+  ClockDiscipline cd(config);
+  Oscillator osc = {-25, 0};
+  SimResult r = simulate(cd, osc, 2, 0, 2);
+  report("-25 ppm", r, cd);
+  TEST_ASSERT_TRUE_MESSAGE(fabs(r.finalPpm - 25) < 0.5, "frequency error not learnt");
+  TEST_ASSERT_EQUAL(config.pollMaxS, r.finalPoll);
+  TEST_ASSERT_TRUE_MESSAGE(r.maxErrorUs < 20000, "clock error above the tight threshold");
+}
+
+// A reference step beyond the threshold is stepped once, and polling restarts fast
+void test_large_offset_is_stepped() {
+  ClockDiscipline cd(config);
+  Oscillator osc = {10, 0};
+  simulate(cd, osc, 1, 1000, 3);
+  TEST_ASSERT_TRUE(cd.pollIntervalS() > config.pollMinS);
+
+  int64_t local = 86400e6 + FRAME_US;
+  int64_t trueUtc = osc.tick(local);
+  cd.sync(local, trueUtc + 2000000);  // Reference says 2 s later
+  TEST_ASSERT_EQUAL(1, (int)cd.steps());
+  TEST_ASSERT_EQUAL(config.pollMinS, cd.pollIntervalS());
+  TEST_ASSERT_TRUE(llabs(cd.now(local) - (trueUtc + 2000000)) < 1000);
+}
+
+// An offset under the threshold is slewed at no more than slewMaxPpm
+void test_small_offset_is_slewed() {
+  ClockDiscipline cd(config);
+  cd.sync(0, UTC0);
+  cd.sync(64000000, UTC0 + 64000000);
+  int64_t local = 128000000;
+  cd.sync(local, UTC0 + local + 50000);  // 50 ms ahead
+  TEST_ASSERT_EQUAL(0, (int)cd.steps());
+  TEST_ASSERT_TRUE(cd.pendingUs() == 50000);
+
+  int64_t prev = cd.now(local);
+  TEST_ASSERT_TRUE(llabs(prev - (UTC0 + local)) < 2000);  // No jump at the sync itself
+  int64_t maxJump = 0;
+  for (int i = 1; i <= 1500; i++) {  // 150 s
+    int64_t shown = cd.now(local + i * FRAME_US);
+    maxJump = std::max<int64_t>(maxJump, llabs(shown - prev - FRAME_US));
+    prev = shown;
+  }
+  int64_t freqPart = (int64_t)(150e6 * cd.freqPpm() * 1e-6);
+  TEST_ASSERT_TRUE(maxJump <= FRAME_US * config.slewMaxPpm / 1000000 + 1 + llabs(freqPart) / 1500 + 1);
+  // Fully absorbed after 50 ms / 500 ppm = 100 s
+  TEST_ASSERT_TRUE(llabs(prev - (UTC0 + local + 150000000 + 50000 + freqPart)) < 2);
+}
+
+// Swapping in a frequency from the temperature model keeps the time continuous
+void test_set_frequency_is_continuous() {
+  ClockDiscipline cd(config);
+  Oscillator osc = {30, 0};
+  simulate(cd, osc, 0.5, 500, 4);
+  int64_t local = 43200e6 + 12345;
+  int64_t before = cd.now(local);
+  cd.setFrequencyPpb(local, -31000);
+  TEST_ASSERT_TRUE(llabs(cd.now(local) - before) <= 1);
+  TEST_ASSERT_TRUE(fabs(cd.freqPpm() + 31) < 1e-6);
+  // 1000 s later the clock has run 31 ms slow, plus whatever was still being slewed
+  int64_t advanced = cd.now(local + 1000000000) - before;
+  TEST_ASSERT_TRUE(llabs(advanced - (1000000000 - 31000)) <= llabs(cd.pendingUs()) + 1);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_drifting_oscillator);
+  RUN_TEST(test_steady_oscillator_converges);
+  RUN_TEST(test_large_offset_is_stepped);
+  RUN_TEST(test_small_offset_is_slewed);
+  RUN_TEST(test_set_frequency_is_continuous);
+  return UNITY_END();
+}
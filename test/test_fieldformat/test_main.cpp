@@ -0,0 +1,144 @@
+// Field formatters (fieldformat.h): output matches the sprintf() calls they
+// replaced, and a benchmark of one time+temperature frame's fields against the
+// old sprintf() path. Glyph drawing is the same in both paths, so the sink only
+// folds the characters into a checksum.
+
+#include <unity.h>
+#include <stdio.h>
+#include <chrono>
+#include <string>
+#include "fieldformat.h"
+
+void setUp() {}
+void tearDown() {}
+
+static std::string out;
+static void collect(char c) { out += c; }
+
+template <uint8_t Digits>
+static std::string padded(int v) {
+  out.clear();
+  formatPadded<Digits>(v, collect);
+  return out;
+}
+
+static std::string number(int v) {
+  out.clear();
+  formatNumber(v, collect);
+  return out;
+}
+
+static std::string signedNumber(int v) {
+  out.clear();
+  formatSigned(v, collect);
+  return out;
+}
+
+static std::string month(int m) {
+  out.clear();
+  formatMonth(m, collect);
+  return out;
+}
+
+void test_padded_matches_sprintf() {
+  char buf[16];
+  for (int v = 0; v < 100; v++) {
+    snprintf(buf, sizeof(buf), "%02d", v);
+    TEST_ASSERT_EQUAL_STRING(buf, padded<2>(v).c_str());
+  }
+  for (int v = 0; v < 10000; v += 7) {
+    snprintf(buf, sizeof(buf), "%04d", v);
+    TEST_ASSERT_EQUAL_STRING(buf, padded<4>(v).c_str());
+  }
+}
+
+void test_padded_clamps_out_of_range() {
+  TEST_ASSERT_EQUAL_STRING("00", padded<2>(-5).c_str());
+  TEST_ASSERT_EQUAL_STRING("99", padded<2>(123).c_str());
+  TEST_ASSERT_EQUAL_STRING("9", padded<1>(2147483647).c_str());
+}
+
+void test_number_and_signed_match_sprintf() {
+  char buf[16];
+  const int values[] = {0, 1, 9, 10, 99, 100, 1013, 65535, 2147483647};
+  for (int v : values) {
+    snprintf(buf, sizeof(buf), "%d", v);
+    TEST_ASSERT_EQUAL_STRING(buf, number(v).c_str());
+    TEST_ASSERT_EQUAL_STRING(buf, signedNumber(v).c_str());
+    snprintf(buf, sizeof(buf), "%d", -v);
+    TEST_ASSERT_EQUAL_STRING(buf, signedNumber(-v).c_str());
+  }
+  TEST_ASSERT_EQUAL_STRING("0", number(-3).c_str());
+}
+
+void test_month_names() {
+  TEST_ASSERT_EQUAL_STRING("JAN", month(1).c_str());
+  TEST_ASSERT_EQUAL_STRING("OCT", month(10).c_str());
+  TEST_ASSERT_EQUAL_STRING("DEC", month(12).c_str());
+  TEST_ASSERT_EQUAL_STRING("JAN", month(0).c_str());
+  TEST_ASSERT_EQUAL_STRING("DEC", month(13).c_str());
+}
+
+static volatile uint32_t sink;
+static uint32_t checksum;
+static void glyph(char c) { checksum = checksum * 31 + (uint8_t)c; }
+
+// Fields of one displayTimeAndTemp() frame, the old way
+static void frameSprintf(int h, int m, int s, int t, int hum) {
+  char txt[32];
+  snprintf(txt, sizeof(txt), "%d", h);
+  for (char* p = txt; *p; p++) glyph(*p);
+  snprintf(txt, sizeof(txt), "%02d", m);
+  for (char* p = txt; *p; p++) glyph(*p);
+  snprintf(txt, sizeof(txt), "%02d", s);
+  for (char* p = txt; *p; p++) glyph(*p);
+  snprintf(txt, sizeof(txt), "%d", t);
+  for (char* p = txt; *p; p++) glyph(*p);
+  snprintf(txt, sizeof(txt), "%d", hum);
+  for (char* p = txt; *p; p++) glyph(*p);
+}
+
+// ...and with the formatters
+static void frameFormatters(int h, int m, int s, int t, int hum) {
+  formatNumber(h, glyph);
+  formatPadded<2>(m, glyph);
+  formatPadded<2>(s, glyph);
+  formatSigned(t, glyph);
+  formatNumber(hum, glyph);
+}
+
+template <typename F>
+static double nsPerFrame(F frame, int frames) {
+  checksum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < frames; i++) frame(i / 3600 % 12 + 1, i / 60 % 60, i % 60, i % 50 - 10, i % 100);
+  auto end = std::chrono::steady_clock::now();
+  sink = checksum;
+  return std::chrono::duration<double, std::nano>(end - start).count() / frames;
+}
+
+void test_benchmark_render_fields() {
+  const int frames = 2000000;
+  uint32_t a, b;
+  nsPerFrame(frameSprintf, frames / 10);  // Warm up
+  double old = nsPerFrame(frameSprintf, frames);
+  a = checksum;
+  double now = nsPerFrame(frameFormatters, frames);
+  b = checksum;
+  TEST_ASSERT_EQUAL_UINT32(a, b);  // Same glyphs
+
+  char msg[128];
+  snprintf(msg, sizeof(msg), "fields per frame: sprintf %.1f ns, formatters %.1f ns (%.1fx)", old, now, old / now);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE_MESSAGE(now < old, msg);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_padded_matches_sprintf);
+  RUN_TEST(test_padded_clamps_out_of_range);
+  RUN_TEST(test_number_and_signed_match_sprintf);
+  RUN_TEST(test_month_names);
+  RUN_TEST(test_benchmark_render_fields);
+  return UNITY_END();
+}
@@ -0,0 +1,237 @@
+// FleetSync between several clocks in one process, each with its own UDP socket on
+// 127.0.0.1. The transport sends every beacon to all sockets, the sender's included,
+// as multicast with loopback does. Nodes are serviced at random, about every 10 ms,
+// which stands in for the delivery delay of WiFi multicast. Clocks are real time
+// plus a fixed skew per node.
+
+#include <unity.h>
+#include <Arduino.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <functional>
+#include <random>
+#include <thread>
+#include "fleetsync.h"
+
+static const int N = 5;
+static const uint32_t BASE_ID = 100;
+static const uint32_t INTERVAL_MS = 100;
+static const uint32_t PEER_TIMEOUT_MS = 1000;
+static const int64_t TOLERANCE_US = 10000;  // Filtered delivery delay, with room for a busy host
+
+static int64_t trueUs() { return 1767225600000000LL + (int64_t)micros64(); }  // From 2026-01-01
+
+static int64_t skewUs[N];
+template <int I>
+static int64_t clockOf() {
+  return trueUs() + skewUs[I];
+}
+static const FleetSync::ClockFn clocks[N] = {clockOf<0>, clockOf<1>, clockOf<2>, clockOf<3>, clockOf<4>};
+
+// The group: a datagram goes to every open socket
+static int fds[N];
+static uint16_t ports[N];
+
+static bool loopbackSend(const uint8_t* pkt, size_t len, void* ctx) {
+  int fd = *(int*)ctx;
+  bool sent = false;
+  for (int i = 0; i < N; i++) {
+    if (fds[i] < 0) continue;
+    struct sockaddr_in a = {};
+    a.sin_family = AF_INET;
+    a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    a.sin_port = htons(ports[i]);
+    if (sendto(fd, pkt, len, 0, (struct sockaddr*)&a, sizeof(a)) == (ssize_t)len) sent = true;
+  }
+  return sent;
+}
+
+static int loopbackReceive(uint8_t* buf, size_t size, uint32_t& fromIp, void* ctx) {
+  struct sockaddr_in a = {};
+  socklen_t len = sizeof(a);
+  ssize_t k = recvfrom(*(int*)ctx, buf, size, MSG_DONTWAIT, (struct sockaddr*)&a, &len);
+  if (k <= 0) return 0;
+  fromIp = a.sin_addr.s_addr;
+  return (int)k;
+}
+
+static FleetSync* nodes[N];
+static bool alive[N];
+static std::mt19937 rng(7);
+
+static int openSocket(uint16_t& port) {
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  struct sockaddr_in a = {};
+  a.sin_family = AF_INET;
+  a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(a);
+  if (bind(fd, (struct sockaddr*)&a, sizeof(a)) != 0 || getsockname(fd, (struct sockaddr*)&a, &len) != 0) {
+    close(fd);
+    return -1;
+  }
+  port = ntohs(a.sin_port);
+  return fd;
+}
+
+// Node i: its id, stratum, and mode-cycle epoch and hash
+static void start(int i, uint8_t stratum, uint32_t cycleHash = 0xC0FFEE) {
+  fds[i] = openSocket(ports[i]);
+  TEST_ASSERT_TRUE_MESSAGE(fds[i] >= 0, "no UDP socket on 127.0.0.1");
+  nodes[i]->begin(BASE_ID + i, {loopbackSend, loopbackReceive, &fds[i]}, INTERVAL_MS, PEER_TIMEOUT_MS, 1000000);
+  nodes[i]->setLocal(stratum, 1000, 1000 + i, cycleHash);
+  alive[i] = true;
+}
+
+// Node i drops off the network
+static void kill(int i) {
+  nodes[i]->stop();
+  close(fds[i]);
+  fds[i] = -1;
+  alive[i] = false;
+}
+
+// Runs the fleet for ms, calling `each` after every millisecond step
+static void run(int ms, const std::function<void()>& each = nullptr) {
+  std::uniform_real_distribution<double> u(0, 1);
+  int64_t end = micros64() + (int64_t)ms * 1000;
+  while ((int64_t)micros64() < end) {
+    for (int i = 0; i < N; i++) {
+      if (alive[i] && u(rng) < 0.1) nodes[i]->service(micros64());
+    }
+    if (each) each();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+// Node i's display timebase minus true time
+static int64_t displayErrorUs(int i) { return clocks[i]() - trueUs() + nodes[i]->offsetUs(); }
+
+// A follower's timebase is the leader's clock, late by the least delivery delay seen
+static void assertOnTimebaseOf(int leader, int i) {
+  int64_t lagUs = skewUs[leader] - displayErrorUs(i);
+  char msg[64];
+  snprintf(msg, sizeof(msg), "node %d lags node %d by %lld us", i, leader, (long long)lagUs);
+  TEST_ASSERT_TRUE_MESSAGE(lagUs > -1000 && lagUs < TOLERANCE_US, msg);
+}
+
+void setUp() {
+  const int64_t skews[N] = {7000, -35000, 5000, 45000, -20000};  // Clocks span 80 ms
+  for (int i = 0; i < N; i++) {
+    skewUs[i] = skews[i];
+    nodes[i] = new FleetSync(clocks[i]);
+    fds[i] = -1;
+    alive[i] = false;
+  }
+}
+
+void tearDown() {
+  for (int i = 0; i < N; i++) {
+    if (alive[i]) kill(i);
+    delete nodes[i];
+  }
+}
+
+void test_followers_take_the_leaders_timebase() {
+  // Node 2 has the best stratum, node 4 no time, node 1 another mode cycle
+  start(0, 3);
+  start(1, 3, 0xBAD);
+  start(2, 2);
+  start(3, 3);
+  start(4, FLEET_UNSYNCED);
+  run(3000);
+
+  for (int i = 0; i < N; i++) {
+    TEST_ASSERT_EQUAL_INT_MESSAGE(BASE_ID + 2, nodes[i]->leaderId(), "all clocks elect the same leader");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(N - 1, nodes[i]->peerCount(), "own beacons are not peers");
+  }
+  TEST_ASSERT_TRUE(nodes[2]->leading());
+  TEST_ASSERT_EQUAL(0, nodes[2]->offsetUs());
+  for (int i : {0, 1, 3}) {
+    TEST_ASSERT_TRUE(nodes[i]->following());
+    assertOnTimebaseOf(2, i);
+    TEST_ASSERT_EQUAL_INT(1002, nodes[i]->epochS());
+  }
+  TEST_ASSERT_FALSE_MESSAGE(nodes[4]->following(), "a clock without time does not measure offsets");
+  TEST_ASSERT_EQUAL(0, nodes[4]->offsetUs());
+  TEST_ASSERT_TRUE(nodes[0]->cycleMatches());
+  TEST_ASSERT_FALSE(nodes[1]->cycleMatches());
+
+  const FleetSync::Peer& p = nodes[0]->peer(0);
+  TEST_ASSERT_TRUE(p.ip == htonl(INADDR_LOOPBACK));
+  TEST_ASSERT_TRUE(p.beacons > 20);
+}
+
+void test_leader_failover_keeps_the_timebase() {
+  // Node 2 leads; once it is gone node 0 (lowest id of stratum 3, clock 2 ms apart) takes over
+  for (int i = 0; i < N; i++) start(i, i == 2 ? 2 : 3);
+  run(3000);
+  for (int i : {0, 1, 3, 4}) assertOnTimebaseOf(2, i);
+
+  // Until the new leader's samples have settled, the followers keep node 2's timebase:
+  // falling back to their own clocks would step the display by 25-40 ms
+  int64_t last[N];
+  for (int i = 0; i < N; i++) last[i] = displayErrorUs(i);
+  int64_t maxStepUs = 0;
+  int unmeasured = 0;  // Steps taken with the new leader not settled yet
+  kill(2);
+  run(PEER_TIMEOUT_MS + 2000, [&]() {
+    for (int i : {0, 1, 3, 4}) {
+      int64_t e = displayErrorUs(i);
+      maxStepUs = std::max(maxStepUs, e > last[i] ? e - last[i] : last[i] - e);
+      last[i] = e;
+      if (i != 0 && nodes[i]->leaderId() == BASE_ID && !nodes[i]->following()) unmeasured++;
+    }
+  });
+
+  char msg[64];
+  snprintf(msg, sizeof(msg), "display timebase stepped by %lld us", (long long)maxStepUs);
+  TEST_ASSERT_TRUE_MESSAGE(maxStepUs < TOLERANCE_US, msg);
+  TEST_ASSERT_TRUE_MESSAGE(unmeasured > 0, "the failover was not seen before the filter settled");
+  TEST_ASSERT_TRUE(nodes[0]->leading());
+  for (int i : {1, 3, 4}) {
+    TEST_ASSERT_EQUAL_INT(BASE_ID, nodes[i]->leaderId());
+    TEST_ASSERT_TRUE(nodes[i]->following());
+    TEST_ASSERT_EQUAL_INT(N - 2, nodes[i]->peerCount());
+    assertOnTimebaseOf(0, i);
+  }
+}
+
+void test_foreign_datagrams_are_ignored() {
+  start(0, 3);
+  uint16_t port;
+  int fd = openSocket(port);
+  struct sockaddr_in a = {};
+  a.sin_family = AF_INET;
+  a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  a.sin_port = htons(ports[0]);
+
+  uint8_t pkt[FLEET_PACKET_SIZE] = {'L', 'C', 'F', 'S', FLEET_VERSION, 3, 0, 0, 0, 0, 0, 7};
+  sendto(fd, pkt, sizeof(pkt) - 1, 0, (struct sockaddr*)&a, sizeof(a));  // Short
+  pkt[4] = FLEET_VERSION + 1;
+  sendto(fd, pkt, sizeof(pkt), 0, (struct sockaddr*)&a, sizeof(a));      // Other version
+  pkt[4] = FLEET_VERSION;
+  pkt[0] = 'X';
+  sendto(fd, pkt, sizeof(pkt), 0, (struct sockaddr*)&a, sizeof(a));      // Not a beacon
+  run(200);
+  TEST_ASSERT_EQUAL(0, nodes[0]->peerCount());
+  TEST_ASSERT_TRUE(nodes[0]->leading());
+
+  pkt[0] = 'L';
+  sendto(fd, pkt, sizeof(pkt), 0, (struct sockaddr*)&a, sizeof(a));      // Clock 7, stratum 3
+  run(200);
+  close(fd);
+  TEST_ASSERT_EQUAL(1, nodes[0]->peerCount());
+  TEST_ASSERT_EQUAL_INT(7, nodes[0]->leaderId());
+  TEST_ASSERT_TRUE_MESSAGE(nodes[0]->beaconsSent() >= 2, "beacons go out every interval");
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_followers_take_the_leaders_timebase);
+  RUN_TEST(test_leader_failover_keeps_the_timebase);
+  RUN_TEST(test_foreign_datagrams_are_ignored);
+  return UNITY_END();
+}
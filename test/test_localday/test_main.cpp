@@ -0,0 +1,164 @@
+// Local-day window (tzLocalDay) against glibc's localtime_r for the same POSIX
+// rules, and the cost of the clock's per-frame local time both ways.
+
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <Arduino.h>
+#include "tzrules.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const char* zones[] = {
+    "AEST-10AEDT,M10.1.0,M4.1.0/3",   // Southern hemisphere, transitions at 02:00/03:00
+    "GMT0BST,M3.5.0/1,M10.5.0",        // Transitions at 01:00/02:00
+    "EST5EDT,M3.2.0,M11.1.0",          // Negative offset
+    "<+1030>-10:30<+11>-11,M10.1.0,M4.1.0",  // Half-hour DST shift (Lord Howe)
+    "<-03>3<-02>,M3.5.0/-2,M10.5.0/-1",      // Transitions before local midnight (Nuuk)
+    "JST-9",                                  // No DST
+};
+
+static void useZone(const char* tz, TzRule& rule) {
+  setenv("TZ", tz, 1);
+  tzset();
+  TEST_ASSERT_TRUE_MESSAGE(tzParse(tz, rule), tz);
+}
+
+// What updateTime() does each frame: rebuild the window only when utc leaves it
+struct LocalClock {
+  TzRule rule;
+  TzLocalDay day = {};
+  uint32_t rebuilds = 0;
+
+  void at(int64_t utc, int& h, int& m, int& s) {
+    if (!day.contains(utc)) {
+      int64_t from, until;
+      int32_t offset = tzOffsetAt(rule, utc, &from, &until);
+      day = tzLocalDay(utc, offset, from, until);
+      rebuilds++;
+    }
+    int32_t secOfDay = utc - day.midnight;
+    h = secOfDay / 3600;
+    m = secOfDay / 60 % 60;
+    s = secOfDay % 60;
+  }
+};
+
+static bool sameAsGlibc(LocalClock& c, int64_t utc, char* msg, size_t size) {
+  int h, m, s;
+  c.at(utc, h, m, s);
+  time_t t = utc;
+  struct tm tm;
+  localtime_r(&t, &tm);
+  bool ok = h == tm.tm_hour && m == tm.tm_min && s == tm.tm_sec && c.day.year == tm.tm_year + 1900 &&
+            c.day.month == tm.tm_mon + 1 && c.day.day == tm.tm_mday && c.day.weekday == tm.tm_wday;
+  if (!ok) {
+    snprintf(msg, size, "utc %lld: %04d-%02d-%02d %02d:%02d:%02d wd%d, glibc %04d-%02d-%02d %02d:%02d:%02d wd%d",
+             (long long)utc, (int)c.day.year, c.day.month, c.day.day, h, m, s, c.day.weekday, tm.tm_year + 1900,
+             tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, tm.tm_wday);
+  }
+  return ok;
+}
+
+// Walking forwards through 2024-2027 in 7-minute steps, the cached window always
+// agrees with glibc
+void test_forward_walk_matches_localtime() {
+  char msg[160];
+  for (const char* tz : zones) {
+    LocalClock c;
+    useZone(tz, c.rule);
+    for (int64_t utc = 1704067200; utc < 1830297600; utc += 420) {
+      if (!sameAsGlibc(c, utc, msg, sizeof(msg))) TEST_FAIL_MESSAGE(msg);
+    }
+  }
+}
+
+// Around every transition, stepping backwards and forwards across it (as an NTP
+// step would) never reuses a window whose offset no longer applies
+void test_steps_across_transitions() {
+  char msg[160];
+  for (const char* tz : zones) {
+    LocalClock c;
+    useZone(tz, c.rule);
+    if (!c.rule.hasDst) continue;
+    TzTransition t[8];
+    int n = tzTransitions(c.rule, 2025, 2028, t, 8);
+    for (int i = 0; i < n; i++) {
+      const int64_t deltas[] = {30, -30, 3599, -3599, 1, -1, 7200, -7200, 0, -86399, 86399};
+      for (int64_t after : {(int64_t)1, (int64_t)600, (int64_t)5400}) {
+        int64_t base = t[i].at + after;  // Window built just after the transition...
+        for (int64_t d : deltas) {
+          c.day = {};
+          if (!sameAsGlibc(c, base, msg, sizeof(msg))) TEST_FAIL_MESSAGE(msg);
+          if (!sameAsGlibc(c, base + d - after, msg, sizeof(msg))) TEST_FAIL_MESSAGE(msg);  // ...then stepped
+        }
+      }
+    }
+  }
+}
+
+// The case the lower bound guards: after a fall-back transition the local midnight
+// lies before the transition, at an offset that was not in force then
+void test_window_starts_at_transition() {
+  LocalClock c;
+  useZone("AEST-10AEDT,M10.1.0,M4.1.0/3", c.rule);
+  TzTransition t[4];
+  tzTransitions(c.rule, 2026, 2026, t, 4);
+  int64_t fallBack = t[0].at;  // 2026-04-05 03:00 AEDT -> 02:00 AEST
+  TEST_ASSERT_EQUAL(c.rule.stdOffset, t[0].offsetAfter);
+  int h, m, s;
+  c.at(fallBack + 60, h, m, s);
+  TEST_ASSERT_EQUAL(2, h);
+  TEST_ASSERT_TRUE(c.day.midnight < fallBack);
+  TEST_ASSERT_TRUE(c.day.from == fallBack);
+  TEST_ASSERT_FALSE(c.day.contains(fallBack - 1));
+  c.at(fallBack - 60, h, m, s);  // One minute earlier is 02:59 daylight time
+  TEST_ASSERT_EQUAL(2, h);
+  TEST_ASSERT_EQUAL(59, m);
+}
+
+static volatile int sink;
+
+// One simulated day of 10 Hz frames (one new second per 10 frames): the cached
+// window against a localtime_r call per frame
+void test_benchmark_against_localtime() {
+  const int64_t start = 1775314800;  // 2026-04-04 15:00 UTC, across the Sydney fall-back
+  const int frames = 864000;
+  LocalClock c;
+  useZone(zones[0], c.rule);
+
+  uint64_t t0 = micros64();
+  for (int i = 0; i < frames; i++) {
+    int h, m, s;
+    c.at(start + i / 10, h, m, s);
+    sink = h + m + s + c.day.day;
+  }
+  uint64_t cached = micros64() - t0;
+
+  t0 = micros64();
+  for (int i = 0; i < frames; i++) {
+    time_t t = start + i / 10;
+    struct tm tm;
+    localtime_r(&t, &tm);
+    sink = tm.tm_hour + tm.tm_min + tm.tm_sec + tm.tm_mday;
+  }
+  uint64_t glibc = micros64() - t0;
+
+  char msg[128];
+  snprintf(msg, sizeof(msg), "per frame: localtime_r %.1f ns, local day %.1f ns, %u rebuilds",
+           glibc * 1000.0 / frames, cached * 1000.0 / frames, (unsigned)c.rebuilds);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_EQUAL(3, (int)c.rebuilds);  // Start, the transition, midnight
+  TEST_ASSERT_TRUE_MESSAGE(cached < glibc, msg);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_forward_walk_matches_localtime);
+  RUN_TEST(test_steps_across_transitions);
+  RUN_TEST(test_window_starts_at_transition);
+  RUN_TEST(test_benchmark_against_localtime);
+  return UNITY_END();
+}
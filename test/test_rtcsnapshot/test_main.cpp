@@ -0,0 +1,112 @@
+// RtcSnapshot sealing and the checks a warm restart makes before trusting it. RTC
+// user memory is stood in for by a block array the snapshot is copied through, as
+// ESP.rtcUserMemoryWrite() / Read() do.
+
+#include <unity.h>
+#include <string.h>
+#include "rtcsnapshot.h"
+
+static const uint32_t CALIBRATION = 22528;  // 5.5 us per tick, Q12
+static const uint32_t MAX_AGE_S = 3600;
+static const uint32_t SAVED_TICKS = 1000000;
+
+static uint32_t memory[sizeof(RtcSnapshot) / 4];
+
+static void store(const RtcSnapshot& snap) { memcpy(memory, &snap, sizeof(snap)); }
+
+static RtcSnapshot load() {
+  RtcSnapshot snap;
+  memcpy(&snap, memory, sizeof(snap));
+  return snap;
+}
+
+static RtcSnapshot sample() {
+  RtcSnapshot snap;
+  memset(&snap, 0, sizeof(snap));
+  snap.rtcTicks = SAVED_TICKS;
+  snap.utcUs = 1792224000123456LL;
+  snap.temperatureDeci = -53;
+  snap.pressureDeci = 10132;
+  snap.humidity = 41;
+  snap.timezone = 7;
+  snap.manualBrightness = 12;
+  snap.flags = RTC_SNAP_24H | RTC_SNAP_SCHEDULE | RTC_SNAP_SENSOR;
+  snap.scheduleStartHour = 23;
+  snap.scheduleEndMinute = 30;
+  rtcSnapshotSeal(snap);
+  return snap;
+}
+
+// RTC ticks after SAVED_TICKS that make `us`
+static uint32_t ticksAfter(uint64_t us) { return SAVED_TICKS + (uint32_t)((us << 12) / CALIBRATION); }
+
+void setUp() { memset(memory, 0, sizeof(memory)); }
+void tearDown() {}
+
+void test_round_trip() {
+  RtcSnapshot saved = sample();
+  store(saved);
+  RtcSnapshot snap = load();
+
+  uint64_t elapsedUs;
+  TEST_ASSERT_EQUAL(RTC_SNAPSHOT_VALID, rtcSnapshotCheck(snap, ticksAfter(2500000), CALIBRATION, MAX_AGE_S, elapsedUs));
+  TEST_ASSERT_INT_WITHIN(6, 2500000, (int64_t)elapsedUs);  // One tick
+  TEST_ASSERT_EQUAL_MEMORY(&saved, &snap, sizeof(snap));
+  TEST_ASSERT_TRUE(snap.utcUs == 1792224000123456LL);
+  TEST_ASSERT_EQUAL_INT(-53, snap.temperatureDeci);
+  TEST_ASSERT_EQUAL_INT(7, snap.timezone);
+  TEST_ASSERT_EQUAL_INT(RTC_SNAP_24H | RTC_SNAP_SCHEDULE | RTC_SNAP_SENSOR, snap.flags);
+
+  TEST_ASSERT_EQUAL(RTC_SNAPSHOT_VALID, rtcSnapshotCheck(snap, SAVED_TICKS, CALIBRATION, MAX_AGE_S, elapsedUs));
+  TEST_ASSERT_EQUAL_INT(0, (int)elapsedUs);
+}
+
+void test_corrupt_snapshot_is_rejected() {
+  uint64_t elapsedUs;
+  TEST_ASSERT_EQUAL_INT_MESSAGE(RTC_SNAPSHOT_CORRUPT,
+                                rtcSnapshotCheck(load(), SAVED_TICKS, CALIBRATION, MAX_AGE_S, elapsedUs), "zeroed memory");
+
+  // A changed byte anywhere, magic and CRC included
+  for (size_t i = 0; i < sizeof(RtcSnapshot); i++) {
+    store(sample());
+    ((uint8_t*)memory)[i] ^= 0x10;
+    TEST_ASSERT_EQUAL_INT_MESSAGE(RTC_SNAPSHOT_CORRUPT,
+                                  rtcSnapshotCheck(load(), ticksAfter(1000000), CALIBRATION, MAX_AGE_S, elapsedUs),
+                                  "one byte changed");
+  }
+
+  // Fields edited after sealing
+  RtcSnapshot snap = sample();
+  snap.timezone++;
+  TEST_ASSERT_EQUAL(RTC_SNAPSHOT_CORRUPT, rtcSnapshotCheck(snap, ticksAfter(1000000), CALIBRATION, MAX_AGE_S, elapsedUs));
+}
+
+void test_rtc_reset_is_rejected() {
+  store(sample());
+  uint64_t elapsedUs;
+  TEST_ASSERT_EQUAL(RTC_SNAPSHOT_RESET, rtcSnapshotCheck(load(), SAVED_TICKS - 1, CALIBRATION, MAX_AGE_S, elapsedUs));
+  TEST_ASSERT_EQUAL(RTC_SNAPSHOT_RESET, rtcSnapshotCheck(load(), 0, CALIBRATION, MAX_AGE_S, elapsedUs));
+  TEST_ASSERT_EQUAL_INT(0, (int)elapsedUs);
+}
+
+void test_stale_snapshot_is_rejected() {
+  store(sample());
+  uint64_t elapsedUs;
+  TEST_ASSERT_EQUAL(RTC_SNAPSHOT_VALID,
+                    rtcSnapshotCheck(load(), ticksAfter(MAX_AGE_S * 1000000ULL), CALIBRATION, MAX_AGE_S, elapsedUs));
+  TEST_ASSERT_EQUAL(RTC_SNAPSHOT_STALE,
+                    rtcSnapshotCheck(load(), ticksAfter(MAX_AGE_S * 1000000ULL + 10), CALIBRATION, MAX_AGE_S, elapsedUs));
+  TEST_ASSERT_EQUAL_INT(0, (int)elapsedUs);
+
+  // Far apart: the tick difference times the calibration must not overflow
+  TEST_ASSERT_EQUAL(RTC_SNAPSHOT_STALE, rtcSnapshotCheck(load(), 0xFFFFFFFF, CALIBRATION, MAX_AGE_S, elapsedUs));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_corrupt_snapshot_is_rejected);
+  RUN_TEST(test_rtc_reset_is_rejected);
+  RUN_TEST(test_stale_snapshot_is_rejected);
+  return UNITY_END();
+}
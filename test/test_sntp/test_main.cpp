@@ -0,0 +1,287 @@
+// SntpClient against local UDP NTP stand-ins with different path delays and
+// behaviours: the lowest-delay reply is chosen, bad replies are ignored, and host
+// lookups are spread over poll() calls, one per call, so no single loop pass blocks
+// for more than one lookup.
+
+#include <unity.h>
+#include <poll.h>
+#include <stdio.h>
+#include <sys/time.h>
+#include <atomic>
+#include <thread>
+#include "sntpclient.h"
+
+void setUp() {}
+void tearDown() {}
+
+static int64_t realtimeUs() {
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+// The clock being measured runs 250 ms behind real time
+static const int64_t CLOCK_ERROR_US = -250000;
+static int64_t testClock() { return realtimeUs() + CLOCK_ERROR_US; }
+
+// One SNTP server on 127.0.0.1, answering from a background thread
+class NtpStandIn {
+ public:
+  enum Behaviour { NORMAL, KISS_OF_DEATH, SILENT, WRONG_ORIGIN };
+
+  NtpStandIn(int delayMs, Behaviour behaviour = NORMAL) : _delayMs(delayMs), _behaviour(behaviour) {}
+  ~NtpStandIn() { stop(); }
+
+  uint16_t start() {
+    _fd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in a = {};
+    a.sin_family = AF_INET;
+    a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(a);
+    if (bind(_fd, (struct sockaddr*)&a, sizeof(a)) != 0 || getsockname(_fd, (struct sockaddr*)&a, &len) != 0) {
+      return 0;
+    }
+    _running = true;
+    _thread = std::thread([this]() { serve(); });
+    return ntohs(a.sin_port);
+  }
+
+  void stop() {
+    if (!_running) return;
+    _running = false;
+    _thread.join();
+    close(_fd);
+  }
+
+  int requests() const { return _requests; }
+
+ private:
+  int _delayMs;
+  Behaviour _behaviour;
+  int _fd = -1;
+  std::atomic<bool> _running{false};
+  std::atomic<int> _requests{0};
+  std::thread _thread;
+
+  static void putTimestamp(uint8_t* p, uint64_t v) {
+    for (int i = 7; i >= 0; i--, v >>= 8) p[i] = v & 0xFF;
+  }
+
+  void serve() {
+    while (_running) {
+      struct pollfd p = {_fd, POLLIN, 0};
+      if (poll(&p, 1, 20) != 1) continue;
+      uint8_t req[48];
+      struct sockaddr_in from;
+      socklen_t len = sizeof(from);
+      if (recvfrom(_fd, req, sizeof(req), 0, (struct sockaddr*)&from, &len) != 48) continue;
+      _requests++;
+      if (_behaviour == SILENT) continue;
+
+      usleep(_delayMs * 500);  // Half the path delay each way
+      uint64_t now = SntpClient::toNtp(realtimeUs());
+      uint8_t reply[48] = {};
+      reply[0] = 0x24;                                    // LI 0, version 4, mode 4 (server)
+      reply[1] = _behaviour == KISS_OF_DEATH ? 0 : 2;     // Stratum
+      memcpy(reply + 24, req + 40, 8);                    // Origin = client's transmit time
+      if (_behaviour == WRONG_ORIGIN) reply[31] ^= 1;
+      putTimestamp(reply + 32, now);
+      putTimestamp(reply + 40, now);
+      usleep(_delayMs * 500);
+      sendto(_fd, reply, sizeof(reply), 0, (struct sockaddr*)&from, len);
+    }
+  }
+};
+
+struct RunResult {
+  SntpClient::State state;
+  int polls;
+  unsigned long longestPollMs;
+  unsigned long beginMs;
+  uint32_t maxLookupsPerPoll;
+};
+
+static RunResult run(SntpClient& sntp, unsigned long timeoutMs, unsigned long dnsTimeoutMs) {
+  RunResult r = {SntpClient::IDLE, 0, 0, 0, 0};
+  uint32_t lookups = WiFi.hostLookups;
+  unsigned long t = millis();
+  sntp.begin(timeoutMs, dnsTimeoutMs);
+  r.beginMs = millis() - t;
+  r.maxLookupsPerPoll = WiFi.hostLookups - lookups;  // begin() counts as a pass too
+  while (sntp.busy()) {
+    lookups = WiFi.hostLookups;
+    t = millis();
+    sntp.poll();
+    r.longestPollMs = std::max(r.longestPollMs, millis() - t);
+    r.maxLookupsPerPoll = std::max(r.maxLookupsPerPoll, WiFi.hostLookups - lookups);
+    r.polls++;
+    usleep(1000);
+  }
+  r.state = sntp.state();
+  return r;
+}
+
+static void serverList(char* buf, size_t size, const char* host, const uint16_t* ports, int n) {
+  buf[0] = '\0';
+  for (int i = 0; i < n; i++) {
+    size_t len = strlen(buf);
+    snprintf(buf + len, size - len, "%s%s:%u", i ? "," : "", host, ports[i]);
+  }
+}
+
+void test_lowest_delay_reply_is_selected() {
+  NtpStandIn slow(30), fast(2), kod(1, NtpStandIn::KISS_OF_DEATH), silent(1, NtpStandIn::SILENT);
+  uint16_t ports[] = {slow.start(), fast.start(), kod.start(), silent.start()};
+  char list[128];
+  serverList(list, sizeof(list), "127.0.0.1", ports, 4);
+
+  SntpClient sntp(testClock);
+  TEST_ASSERT_TRUE(sntp.setServers(list));
+  RunResult r = run(sntp, 300, 1000);
+  TEST_ASSERT_EQUAL(SntpClient::DONE, r.state);
+  TEST_ASSERT_EQUAL(0, (int)r.maxLookupsPerPoll);  // Literal addresses need no DNS
+
+  const SntpSample& best = sntp.best();
+  char msg[128];
+  snprintf(msg, sizeof(msg), "selected %u: offset %lld us, delay %ld us", best.server, (long long)best.offsetUs,
+           (long)best.delayUs);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_EQUAL(1, best.server);
+  TEST_ASSERT_EQUAL(2, best.stratum);
+  TEST_ASSERT_INT_WITHIN(3000, -CLOCK_ERROR_US, (long)best.offsetUs);
+  TEST_ASSERT_TRUE_MESSAGE(best.delayUs >= 1500 && best.delayUs < 15000, msg);
+  TEST_ASSERT_TRUE(sntp.server(0).last.delayUs >= 29000);
+
+  TEST_ASSERT_EQUAL(1, (int)sntp.server(0).replies);
+  TEST_ASSERT_EQUAL(1, (int)sntp.server(1).replies);
+  TEST_ASSERT_EQUAL(0, (int)sntp.server(2).replies);  // Kiss-of-death: stratum 0
+  TEST_ASSERT_EQUAL(1, (int)sntp.server(2).misses);
+  TEST_ASSERT_EQUAL(0, (int)sntp.server(3).replies);
+  TEST_ASSERT_EQUAL(1, (int)sntp.server(3).misses);
+  TEST_ASSERT_EQUAL(1, kod.requests());
+  TEST_ASSERT_EQUAL(1, silent.requests());
+}
+
+void test_reply_with_wrong_origin_is_ignored() {
+  NtpStandIn spoof(1, NtpStandIn::WRONG_ORIGIN);
+  uint16_t port = spoof.start();
+  char list[64];
+  serverList(list, sizeof(list), "127.0.0.1", &port, 1);
+  SntpClient sntp(testClock);
+  sntp.setServers(list);
+  RunResult r = run(sntp, 200, 1000);
+  TEST_ASSERT_EQUAL(SntpClient::FAILED, r.state);
+  TEST_ASSERT_EQUAL(1, spoof.requests());
+  TEST_ASSERT_EQUAL(1, (int)sntp.server(0).misses);
+}
+
+// Names are resolved by poll(), one per call, each taking the (simulated) lookup
+// time; begin() returns without any lookup. The next exchange uses the cache.
+void test_lookups_are_spread_over_polls() {
+  NtpStandIn a(1), b(1), c(1);
+  uint16_t ports[] = {a.start(), b.start(), c.start()};
+  char list[128];
+  serverList(list, sizeof(list), "localhost", ports, 3);
+
+  SntpClient sntp(testClock);
+  sntp.setServers(list);
+  WiFi.lookupDelayMs = 60;
+  uint32_t lookups = WiFi.hostLookups;
+  RunResult r = run(sntp, 300, 1000);
+  char msg[128];
+  snprintf(msg, sizeof(msg), "begin %lu ms, %d polls, longest %lu ms", r.beginMs, r.polls, r.longestPollMs);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_EQUAL(SntpClient::DONE, r.state);
+  TEST_ASSERT_EQUAL(3, (int)(WiFi.hostLookups - lookups));
+  TEST_ASSERT_EQUAL(1, (int)r.maxLookupsPerPoll);
+  TEST_ASSERT_TRUE_MESSAGE(r.beginMs < 30, msg);
+  TEST_ASSERT_TRUE_MESSAGE(r.longestPollMs < 60 + 40, msg);  // One lookup, never two
+  for (int i = 0; i < 3; i++) TEST_ASSERT_EQUAL(1, (int)sntp.server(i).replies);
+
+  lookups = WiFi.hostLookups;
+  r = run(sntp, 300, 1000);
+  TEST_ASSERT_EQUAL(SntpClient::DONE, r.state);
+  TEST_ASSERT_EQUAL(0, (int)(WiFi.hostLookups - lookups));  // Cached
+  TEST_ASSERT_TRUE(r.longestPollMs < 30);
+  WiFi.lookupDelayMs = 0;
+}
+
+// With one server cached and one to look up, no request goes out until the lookup
+// is done: a reply arriving during a blocking lookup would only be read after it,
+// and its delay and offset would be off by the lookup time
+void test_replies_are_not_held_behind_lookups() {
+  NtpStandIn cached(1), looked(20);
+  uint16_t ports[] = {cached.start(), looked.start()};
+  char list[128];
+  snprintf(list, sizeof(list), "127.0.0.1:%u,localhost:%u", ports[0], ports[1]);
+  SntpClient sntp(testClock);
+  sntp.setServers(list);
+  WiFi.lookupDelayMs = 150;
+  RunResult r = run(sntp, 120, 1000);
+  WiFi.lookupDelayMs = 0;
+  TEST_ASSERT_EQUAL(SntpClient::DONE, r.state);
+  TEST_ASSERT_EQUAL(1, (int)sntp.server(0).replies);
+  TEST_ASSERT_EQUAL(1, (int)sntp.server(1).replies);
+  TEST_ASSERT_EQUAL(0, sntp.best().server);
+  TEST_ASSERT_TRUE(sntp.server(0).last.delayUs < 15000);
+  TEST_ASSERT_INT_WITHIN(3000, -CLOCK_ERROR_US, (long)sntp.server(0).last.offsetUs);
+}
+
+void test_all_silent_fails_after_timeout() {
+  NtpStandIn silent(1, NtpStandIn::SILENT);
+  uint16_t port = silent.start();
+  char list[64];
+  serverList(list, sizeof(list), "127.0.0.1", &port, 1);
+  SntpClient sntp(testClock);
+  sntp.setServers(list);
+  unsigned long t = millis();
+  RunResult r = run(sntp, 150, 1000);
+  unsigned long took = millis() - t;
+  TEST_ASSERT_EQUAL(SntpClient::FAILED, r.state);
+  TEST_ASSERT_TRUE(took >= 150 && took < 400);
+}
+
+void test_ntp_timestamp_round_trip() {
+  const int64_t times[] = {0, 1767225600123456LL, 2085978495999999LL, 2085978496000000LL, 4102444800000001LL};
+  for (int64_t t : times) {
+    int64_t back = SntpClient::fromNtp(SntpClient::toNtp(t));
+    TEST_ASSERT_TRUE(llabs(back - t) <= 1);  // 2036 era rollover included
+  }
+}
+
+// A rejected list leaves the servers as they were (a half-applied list could leave
+// none, after which every sync fails until a reboot)
+void test_invalid_server_list_changes_nothing() {
+  SntpClient sntp(testClock);
+  TEST_ASSERT_TRUE(sntp.setServers("pool.ntp.org, 192.168.1.10:1123"));
+  const char* bad[] = {
+      "", ",", " , ",                                                   // No server
+      "pool.ntp.org,:5",                                                // One without host
+      "a.example:123abc", "a:70000", "a:0", "a:", "a:-1", "x:123456",   // Ports
+      "b.example,a\"b", "a b", "a\\b:123", "host_name.example",         // Hosts
+  };
+  for (const char* list : bad) {
+    TEST_ASSERT_FALSE_MESSAGE(sntp.setServers(list), list);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(2, sntp.serverCount(), list);
+    TEST_ASSERT_EQUAL_STRING("pool.ntp.org", sntp.server(0).host);
+    TEST_ASSERT_EQUAL_STRING("192.168.1.10", sntp.server(1).host);
+    TEST_ASSERT_EQUAL_INT(1123, sntp.server(1).port);
+  }
+
+  TEST_ASSERT_TRUE(sntp.setServers("time-a.example:65535,10.0.0.1"));
+  TEST_ASSERT_EQUAL_INT(2, sntp.serverCount());
+  TEST_ASSERT_EQUAL_INT(65535, sntp.server(0).port);
+  TEST_ASSERT_EQUAL_INT(123, sntp.server(1).port);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_lowest_delay_reply_is_selected);
+  RUN_TEST(test_reply_with_wrong_origin_is_ignored);
+  RUN_TEST(test_lookups_are_spread_over_polls);
+  RUN_TEST(test_replies_are_not_held_behind_lookups);
+  RUN_TEST(test_all_silent_fails_after_timeout);
+  RUN_TEST(test_ntp_timestamp_round_trip);
+  RUN_TEST(test_invalid_server_list_changes_nothing);
+  return UNITY_END();
+}
@@ -0,0 +1,147 @@
+// TempDriftModel in a host simulation: a crystal whose frequency error is a
+// parabola in temperature, 14 days of NTP syncs through ClockDiscipline while the
+// model learns, then a 3-day outage with no syncs at all. During the outage only
+// the model's frequency predictions keep the clock on time.
+
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include <random>
+#include "clockdiscipline.h"
+#include "tempcomp.h"
+
+void setUp() {}
+void tearDown() {}
+
+// 8 ppm at 25 C, falling off by 0.034 ppm/C^2 (a typical tuning-fork curve);
+// positive = local counter slow
+static double crystalPpm(double T) { return 8 - 0.034 * (T - 25) * (T - 25); }
+
+static const ClockDisciplineConfig config = {64, 16384, 128000, 500, 20000, 100000, 4};
+
+struct Outcome {
+  double maxErrorMs;          // Worst |clock - true| during the outage
+  TempDriftModel model;
+};
+
+// Learning climate: 5-25 C daily cycle plus weather. Outage climate: mean +- swing.
+// syncEveryS = 0 polls at the discipline's interval, as with NTP.
+static Outcome simulate(bool compensate, double outageMean, double outageSwing, unsigned seed, int syncEveryS = 0) {
+  std::mt19937 rng(seed);
+  std::normal_distribution<double> jitterUs(0, 1000), weather(0, 1);
+  ClockDiscipline cd(config);
+  Outcome out = {0, TempDriftModel()};
+  TempDriftModel& model = out.model;
+  const double step = 10, learnDays = 14, outageDays = 3;
+  double trueUs = 1.76e15, localUs = 1e6, nextSync = 0, nextTemp = 0, w = 0;
+
+  for (double t = 0; t < (learnDays + outageDays) * 86400; t += step) {
+    bool outage = t >= learnDays * 86400;
+    w = w * 0.999 + weather(rng) * 0.05;
+    double T = outage ? outageMean + outageSwing * sin(2 * M_PI * t / 86400) + w
+                      : 15 + 10 * sin(2 * M_PI * t / 86400) + 3 * w;
+    trueUs += step * 1e6;
+    localUs += step * 1e6 * (1 - crystalPpm(T) * 1e-6);
+    int64_t local = (int64_t)localUs;
+    int16_t deci = (int16_t)lround(T * 10);
+
+    if (t >= nextTemp) {  // Sensor read once a minute, as SENSOR_UPDATE_INTERVAL
+      model.temperature(local, deci);
+      if (compensate && model.ready()) cd.setFrequencyPpb(local, model.predict(deci));
+      nextTemp = t + 60;
+    }
+    if (!outage && t >= nextSync) {
+      int64_t ref = (int64_t)(trueUs + jitterUs(rng));
+      cd.sync(local, ref);
+      model.sync(local, ref);
+      if (compensate && model.ready()) cd.setFrequencyPpb(local, model.predict(deci));
+      nextSync = t + (syncEveryS ? syncEveryS : cd.pollIntervalS());
+    }
+    if (outage) out.maxErrorMs = fmax(out.maxErrorMs, fabs(cd.now(local) - trueUs) / 1000);
+  }
+  return out;
+}
+
+void test_model_learns_the_crystal_curve() {
+  TempDriftModel m = simulate(true, 5, 5, 1).model;
+  const TempDriftState& s = m.state();
+  char msg[160];
+  snprintf(msg, sizeof(msg), "a=%d ppb b=%d mppb/dC c=%d uppb/dC^2, %u intervals, %d..%d dC", (int)s.a,
+           (int)s.bMilli, (int)s.cMicro, s.samples, s.minDeci, s.maxDeci);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE(m.ready());
+  for (int deci = 0; deci <= 300; deci += 25) {  // Learned range plus a little
+    double want = crystalPpm(deci / 10.0) * 1000;
+    snprintf(msg, sizeof(msg), "%.1f C: model %d ppb, crystal %.0f ppb", deci / 10.0, (int)m.predict(deci), want);
+    TEST_ASSERT_TRUE_MESSAGE(fabs(m.predict(deci) - want) < 300, msg);
+  }
+}
+
+// Worst outage error over five runs, without and with the model
+static void outage(double mean, double swing, const char* what, double maxCompensatedMs) {
+  double plain = 0, compensated = 0;
+  for (unsigned seed = 1; seed <= 5; seed++) {
+    plain = fmax(plain, simulate(false, mean, swing, seed).maxErrorMs);
+    compensated = fmax(compensated, simulate(true, mean, swing, seed).maxErrorMs);
+  }
+  char msg[160];
+  snprintf(msg, sizeof(msg), "3-day outage, %s: max error %.1f ms uncompensated, %.1f ms compensated", what, plain,
+           compensated);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE_MESSAGE(compensated < maxCompensatedMs, msg);
+  TEST_ASSERT_TRUE_MESSAGE(compensated * 20 < plain, msg);
+}
+
+void test_outage_same_climate() { outage(15, 10, "same climate 5-25 C", 50); }
+void test_outage_cold_snap() { outage(5, 5, "cold snap 0-10 C", 50); }
+void test_outage_below_learned_range() { outage(-2, 3, "freezing -5..1 C", 100); }
+void test_outage_above_learned_range() { outage(30, 3, "hot 27-33 C", 100); }
+
+// With syncs every 16 s (PPS), intervals are extended to TEMPCOMP_MIN_INTERVAL_S
+// and still learned
+void test_fast_syncs_still_learn() {
+  TempDriftModel m = simulate(true, 5, 5, 9, 16).model;
+  TEST_ASSERT_TRUE(m.ready());
+  TEST_ASSERT_GREATER_THAN(14 * 86400 / TEMPCOMP_MIN_INTERVAL_S / 2, (int)m.state().samples);
+  TEST_ASSERT_INT_WITHIN(300, (int)lround(crystalPpm(15) * 1000), m.predict(150));
+}
+
+// The state is plain data: what is saved to flash predicts the same after a load
+void test_state_round_trip() {
+  TempDriftModel learned = simulate(true, 5, 5, 3).model;
+  TempDriftState saved;
+  memcpy(&saved, &learned.state(), sizeof(saved));
+  TempDriftModel loaded;
+  loaded.state() = saved;
+  TEST_ASSERT_TRUE(loaded.ready());
+  for (int deci = -100; deci <= 400; deci += 50) TEST_ASSERT_EQUAL(learned.predict(deci), loaded.predict(deci));
+}
+
+// An interval with a gap in the temperature readings is not learned
+void test_lost_temperature_skips_interval() {
+  TempDriftModel m;
+  int64_t utc = 1760000000LL * 1000000;
+  m.temperature(0, 200);
+  m.sync(0, utc);
+  m.temperature(100000000, 210);
+  m.temperatureLost();
+  m.temperature(200000000, 220);
+  TEST_ASSERT_FALSE(m.sync(600000000, utc + 600000000));
+  m.temperature(700000000, 220);
+  TEST_ASSERT_TRUE(m.sync(1200000000, utc + 1200000000));
+  TEST_ASSERT_EQUAL(1, m.state().samples);
+  TEST_ASSERT_FALSE(m.sync(1300000000, utc + 1300000000));  // Under the minimum interval
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_model_learns_the_crystal_curve);
+  RUN_TEST(test_outage_same_climate);
+  RUN_TEST(test_outage_cold_snap);
+  RUN_TEST(test_outage_below_learned_range);
+  RUN_TEST(test_outage_above_learned_range);
+  RUN_TEST(test_fast_syncs_still_learn);
+  RUN_TEST(test_state_round_trip);
+  RUN_TEST(test_lost_temperature_skips_interval);
+  return UNITY_END();
+}
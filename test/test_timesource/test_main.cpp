@@ -0,0 +1,251 @@
+// TimeSources selection and failover with mock sources: stratum order, same-stratum
+// hysteresis, the feed rate limit, staleness of NTP and PPS, error aging, and the
+// resetting of a settable RTC chip from the disciplined clock.
+
+#include <unity.h>
+#include "timesource.h"
+
+static const int64_t S = 1000000;
+static const int64_t L = 1000 * S;             // Local counter at the start
+static const int64_t U = 1760000000LL * S;     // UTC at the start
+
+// Settable source (an RTC chip); refuses writes while `allow` is false, as outside
+// the DS3231's write window
+struct MockChip {
+  bool allow = true;
+  int sets = 0;
+  int refused = 0;
+  int64_t utcUs = 0;
+  uint8_t stratum = 0;
+};
+
+static bool mockSet(int64_t localUs, int64_t utcUs, uint8_t stratum, void* ctx) {
+  MockChip& c = *static_cast<MockChip*>(ctx);
+  if (!c.allow) {
+    c.refused++;
+    return false;
+  }
+  c.sets++;
+  c.utcUs = utcUs;
+  c.stratum = stratum;
+  return true;
+}
+
+// The hierarchy main.cpp registers, with the config.h limits
+struct Hierarchy {
+  TimeSources ts{16, 2, 50000};
+  MockChip chip;
+  int pps, ntp, rtcChip, rtcTimer;
+  TimeSample feed;
+
+  Hierarchy() {
+    pps = ts.add("PPS", 2);
+    ntp = ts.add("NTP", 100);
+    rtcChip = ts.add("DS3231", 180, mockSet, &chip);
+    rtcTimer = ts.add("RTC", 3600);
+  }
+};
+
+void setUp() {}
+void tearDown() {}
+
+void test_nothing_selected_without_samples() {
+  Hierarchy h;
+  TEST_ASSERT_FALSE(h.ts.service(L, h.feed));
+  TEST_ASSERT_EQUAL(-1, h.ts.selected());
+  h.ts.discipline(L, U);  // No reference: nothing is set
+  TEST_ASSERT_EQUAL(0, h.chip.sets);
+}
+
+void test_lowest_stratum_wins() {
+  Hierarchy h;
+  h.ts.post(h.rtcTimer, {L, U, 5000, 15});
+  TEST_ASSERT_TRUE(h.ts.service(L, h.feed));
+  TEST_ASSERT_EQUAL(h.rtcTimer, h.ts.selected());
+  TEST_ASSERT_TRUE(h.feed.utcUs == U);
+  TEST_ASSERT_FALSE(h.ts.service(L + 1, h.feed));  // Nothing new
+
+  h.ts.post(h.rtcChip, {L + S, U + S + 80000, 6000, 14});
+  TEST_ASSERT_TRUE(h.ts.service(L + S, h.feed));
+  TEST_ASSERT_EQUAL(h.rtcChip, h.ts.selected());
+
+  h.ts.post(h.ntp, {L + 2 * S, U + 2 * S, 10000, 2});  // Larger error, lower stratum
+  TEST_ASSERT_TRUE(h.ts.service(L + 2 * S, h.feed));
+  TEST_ASSERT_EQUAL(h.ntp, h.ts.selected());
+  TEST_ASSERT_EQUAL(2, h.feed.stratum);
+
+  h.ts.post(h.pps, {L + 3 * S, U + 3 * S, 20, 0});
+  TEST_ASSERT_TRUE(h.ts.service(L + 3 * S, h.feed));
+  TEST_ASSERT_EQUAL(h.pps, h.ts.selected());
+  TEST_ASSERT_EQUAL(4, (int)h.ts.switches());
+}
+
+// A source of the same stratum must be twice as good to take over
+void test_same_stratum_hysteresis() {
+  TimeSources ts(16, 2, 50000);
+  TimeSample f;
+  int a = ts.add("A", 1000), b = ts.add("B", 1000);
+  ts.post(a, {L, U, 10000, 3});
+  ts.service(L, f);
+  TEST_ASSERT_EQUAL(a, ts.selected());
+  ts.post(b, {L, U, 6000, 3});
+  ts.service(L, f);
+  TEST_ASSERT_EQUAL(a, ts.selected());  // Better, but not twice as good
+  ts.post(b, {L, U, 4000, 3});
+  ts.service(L, f);
+  TEST_ASSERT_EQUAL(b, ts.selected());
+  TEST_ASSERT_EQUAL(2, (int)ts.switches());  // None -> A -> B
+}
+
+// Equal sources: registration order breaks the tie
+void test_registration_order_breaks_ties() {
+  TimeSources ts(16, 2, 50000);
+  TimeSample f;
+  int a = ts.add("A", 1000), b = ts.add("B", 1000);
+  ts.post(b, {L, U, 5000, 3});
+  ts.post(a, {L, U, 5000, 3});
+  ts.service(L, f);
+  TEST_ASSERT_EQUAL(a, ts.selected());
+}
+
+// At most one sample per minFeedS reaches the clock, except right after a switch
+void test_feed_rate_limit() {
+  Hierarchy h;
+  h.ts.post(h.ntp, {L, U, 10000, 2});
+  TEST_ASSERT_TRUE(h.ts.service(L, h.feed));
+  h.ts.post(h.ntp, {L + 5 * S, U + 5 * S, 10000, 2});
+  TEST_ASSERT_FALSE(h.ts.service(L + 5 * S, h.feed));
+  h.ts.post(h.ntp, {L + 20 * S, U + 20 * S, 10000, 2});
+  TEST_ASSERT_TRUE(h.ts.service(L + 20 * S, h.feed));
+  TEST_ASSERT_TRUE(h.feed.localUs == L + 20 * S);
+
+  h.ts.post(h.pps, {L + 21 * S, U + 21 * S, 20, 0});  // Switch: fed at once
+  TEST_ASSERT_TRUE(h.ts.service(L + 21 * S, h.feed));
+  TEST_ASSERT_EQUAL(0, h.feed.stratum);
+}
+
+void test_stale_ntp_fails_over_to_chip() {
+  Hierarchy h;
+  h.ts.post(h.ntp, {L, U, 10000, 2});
+  h.ts.service(L, h.feed);
+  h.ts.post(h.rtcChip, {L + 90 * S, U + 90 * S, 6000, 3});
+  h.ts.service(L + 90 * S, h.feed);
+  TEST_ASSERT_EQUAL(h.ntp, h.ts.selected());  // NTP still within its 100 s
+  TEST_ASSERT_TRUE(h.ts.available(h.ntp, L + 100 * S));
+  TEST_ASSERT_FALSE(h.ts.available(h.ntp, L + 101 * S));
+  TEST_ASSERT_TRUE(h.ts.service(L + 101 * S, h.feed));
+  TEST_ASSERT_EQUAL(h.rtcChip, h.ts.selected());
+  TEST_ASSERT_EQUAL(3, h.feed.stratum);
+
+  h.ts.post(h.ntp, {L + 110 * S, U + 110 * S, 10000, 2});  // NTP back
+  TEST_ASSERT_TRUE(h.ts.service(L + 110 * S, h.feed));
+  TEST_ASSERT_EQUAL(h.ntp, h.ts.selected());
+}
+
+void test_stale_pps_falls_back_to_ntp() {
+  Hierarchy h;
+  h.ts.post(h.pps, {L, U, 20, 0});
+  h.ts.post(h.ntp, {L, U, 10000, 2});
+  h.ts.service(L, h.feed);
+  TEST_ASSERT_EQUAL(h.pps, h.ts.selected());
+  h.ts.service(L + 2 * S, h.feed);
+  TEST_ASSERT_EQUAL(h.pps, h.ts.selected());
+  h.ts.service(L + 2 * S + 1, h.feed);  // No edge for over 2 s
+  TEST_ASSERT_EQUAL(h.ntp, h.ts.selected());
+
+  h.ts.service(L + 200 * S, h.feed);  // Everything stale
+  TEST_ASSERT_EQUAL(-1, h.ts.selected());
+  TEST_ASSERT_FALSE(h.ts.service(L + 201 * S, h.feed));
+}
+
+void test_error_ages() {
+  Hierarchy h;
+  h.ts.post(h.ntp, {L, U, 10000, 2});
+  TEST_ASSERT_EQUAL(10000, (int)h.ts.errorUs(h.ntp, L));
+  TEST_ASSERT_EQUAL(12000, (int)h.ts.errorUs(h.ntp, L + 1000 * S));  // 2 ppm
+  TEST_ASSERT_EQUAL(10000, (int)h.ts.errorUs(h.ntp, L - S));          // Not before the sample
+}
+
+// A drifted chip is reset once from the clock, then judged only by a newer reading
+void test_drifted_chip_is_reset_once() {
+  Hierarchy h;
+  h.ts.post(h.rtcChip, {L, U + 80000, 6000, 14});  // 80 ms ahead
+  h.ts.post(h.ntp, {L, U, 10000, 2});
+  h.ts.service(L, h.feed);
+  h.ts.discipline(L + S, U + S);
+  TEST_ASSERT_EQUAL(1, h.chip.sets);
+  TEST_ASSERT_EQUAL(3, h.chip.stratum);  // One below the reference
+  TEST_ASSERT_TRUE(h.chip.utcUs == U + S);
+  TEST_ASSERT_EQUAL(1, (int)h.ts.sets(h.rtcChip));
+
+  h.ts.discipline(L + 2 * S, U + 2 * S);  // Old reading: no second write
+  TEST_ASSERT_EQUAL(1, h.chip.sets);
+  h.ts.post(h.rtcChip, {L + 3 * S, U + 3 * S + 1000, 6000, 3});  // Re-read: 1 ms off
+  h.ts.discipline(L + 3 * S, U + 3 * S);
+  TEST_ASSERT_EQUAL(1, h.chip.sets);
+  h.ts.post(h.rtcChip, {L + 4 * S, U + 4 * S + 60000, 6000, 3});  // Drifted again
+  h.ts.discipline(L + 4 * S, U + 4 * S);
+  TEST_ASSERT_EQUAL(2, h.chip.sets);
+}
+
+// A write refused (outside the chip's window) is retried on the next call
+void test_refused_write_is_retried() {
+  Hierarchy h;
+  h.ts.post(h.rtcChip, {L, U + 90000, 6000, 14});
+  h.ts.post(h.ntp, {L, U, 10000, 2});
+  h.ts.service(L, h.feed);
+  h.chip.allow = false;
+  h.ts.discipline(L + S, U + S);
+  h.ts.discipline(L + 2 * S, U + 2 * S);
+  TEST_ASSERT_EQUAL(0, h.chip.sets);
+  TEST_ASSERT_EQUAL(2, h.chip.refused);
+  h.chip.allow = true;
+  h.ts.discipline(L + 3 * S, U + 3 * S);
+  TEST_ASSERT_EQUAL(1, h.chip.sets);
+  TEST_ASSERT_EQUAL(1, (int)h.ts.sets(h.rtcChip));
+}
+
+// A chip holding no time is set as soon as the reference is good enough, and not
+// from a reference whose error is above the threshold
+void test_invalid_chip_is_set_from_good_reference() {
+  Hierarchy h;
+  h.ts.invalidate(h.rtcChip);
+  TEST_ASSERT_FALSE(h.ts.available(h.rtcChip, L));
+  h.ts.post(h.ntp, {L, U, 60000, 1});  // Worse than the 50 ms threshold
+  h.ts.service(L, h.feed);
+  h.ts.discipline(L, U);
+  TEST_ASSERT_EQUAL(0, h.chip.sets);
+  h.ts.post(h.ntp, {L + 20 * S, U + 20 * S, 10000, 1});
+  h.ts.service(L + 20 * S, h.feed);
+  h.ts.discipline(L + 20 * S, U + 20 * S);
+  TEST_ASSERT_EQUAL(1, h.chip.sets);
+  TEST_ASSERT_EQUAL(2, h.chip.stratum);
+}
+
+// The selected source and sources of lower stratum are never written
+void test_better_sources_are_not_set() {
+  Hierarchy h;
+  h.ts.post(h.rtcChip, {L, U + 200000, 6000, 1});  // Chip claims stratum 1
+  h.ts.post(h.ntp, {L, U, 10000, 2});
+  h.ts.service(L, h.feed);
+  TEST_ASSERT_EQUAL(h.rtcChip, h.ts.selected());
+  h.ts.discipline(L, U + 200000);
+  TEST_ASSERT_EQUAL(0, h.chip.sets);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_nothing_selected_without_samples);
+  RUN_TEST(test_lowest_stratum_wins);
+  RUN_TEST(test_same_stratum_hysteresis);
+  RUN_TEST(test_registration_order_breaks_ties);
+  RUN_TEST(test_feed_rate_limit);
+  RUN_TEST(test_stale_ntp_fails_over_to_chip);
+  RUN_TEST(test_stale_pps_falls_back_to_ntp);
+  RUN_TEST(test_error_ages);
+  RUN_TEST(test_drifted_chip_is_reset_once);
+  RUN_TEST(test_refused_write_is_retried);
+  RUN_TEST(test_invalid_chip_is_set_from_good_reference);
+  RUN_TEST(test_better_sources_are_not_set);
+  return UNITY_END();
+}
@@ -0,0 +1,207 @@
+// Every zone in timezones.h, evaluated by tzrules.h, against glibc's own reading
+// of the same POSIX rule from 1970 to 2100.
+//
+// glibc's TZ is process-global and localtime_r() runs under a global lock, so the
+// reference is taken on one thread: for each zone, a 6-hourly localtime_r() scan
+// that also checks the local date and time of tzLocalDay() at each sample, with
+// every offset change located to the second by bisection. The dense checks of the
+// engine against that reference - offsets hourly and at each transition,
+// validity windows, transition tables - need no glibc and run on worker threads,
+// one zone at a time per thread, across all cores.
+
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <Arduino.h>
+#include "timezones.h"
+#include "tzrules.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const int64_t SPAN_START = 0;            // 1970-01-01
+static const int64_t SPAN_END = 4102444800LL;   // 2100-01-01
+static const int64_t SCAN_STEP = 6 * 3600;      // Transitions are months apart
+static const int64_t DENSE_STEP = 3600 + 7;  // Drifts through every minute of the hour
+
+struct RefTransition {
+  int64_t at;
+  int32_t offsetAfter;
+};
+
+struct Reference {
+  std::string name, rule;
+  int32_t initialOffset;
+  std::vector<RefTransition> transitions;
+};
+
+static std::vector<Reference> refs;
+static std::mutex failMutex;
+static std::vector<std::string> failures;
+
+static void fail(const Reference& r, const char* what, int64_t utc, long long got, long long want) {
+  char msg[192];
+  snprintf(msg, sizeof(msg), "%s (%s): %s at %lld: got %lld, glibc %lld", r.name.c_str(), r.rule.c_str(), what,
+           (long long)utc, got, want);
+  std::lock_guard<std::mutex> lock(failMutex);
+  if (failures.size() < 20) failures.push_back(msg);
+}
+
+static int32_t glibcOffset(int64_t utc) {
+  time_t t = utc;
+  struct tm tm;
+  localtime_r(&t, &tm);
+  return tm.tm_gmtoff;
+}
+
+// Offset of the reference at utc
+static int32_t refOffset(const Reference& r, int64_t utc) {
+  int32_t offset = r.initialOffset;
+  size_t lo = 0, hi = r.transitions.size();
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    if (r.transitions[mid].at <= utc) lo = mid + 1; else hi = mid;
+  }
+  if (lo > 0) offset = r.transitions[lo - 1].offsetAfter;
+  return offset;
+}
+
+// Single-threaded: the glibc reference, and the date fields checked on the way
+static void buildReference(int zone, Reference& r, TzRule& rule) {
+  char name[TZ_NAME_MAX], tz[TZ_RULE_MAX];
+  r.name = timezoneName(zone, name);
+  r.rule = timezoneRule(zone, tz);
+  setenv("TZ", tz, 1);
+  tzset();
+  if (!tzParse(tz, rule)) {
+    fail(r, "tzParse failed", 0, 0, 1);
+    return;
+  }
+
+  r.initialOffset = glibcOffset(SPAN_START);
+  int32_t prev = r.initialOffset;
+  for (int64_t utc = SPAN_START; utc < SPAN_END; utc += SCAN_STEP) {
+    time_t t = utc;
+    struct tm tm;
+    localtime_r(&t, &tm);
+    if (tm.tm_gmtoff != prev) {
+      int64_t lo = utc - SCAN_STEP, hi = utc;  // Offset changes in (lo, hi]
+      while (hi - lo > 1) {
+        int64_t mid = lo + (hi - lo) / 2;
+        if (glibcOffset(mid) == prev) lo = mid; else hi = mid;
+      }
+      r.transitions.push_back({hi, (int32_t)tm.tm_gmtoff});
+      prev = tm.tm_gmtoff;
+    }
+
+    int64_t from, until;
+    int32_t offset = tzOffsetAt(rule, utc, &from, &until);
+    TzLocalDay d = tzLocalDay(utc, offset, from, until);
+    int32_t secOfDay = utc - d.midnight;
+    int32_t want = tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec;
+    if (secOfDay != want) fail(r, "time of day", utc, secOfDay, want);
+    int32_t date = d.year * 10000 + d.month * 100 + d.day;
+    int32_t wantDate = (tm.tm_year + 1900) * 10000 + (tm.tm_mon + 1) * 100 + tm.tm_mday;
+    if (date != wantDate) fail(r, "date", utc, date, wantDate);
+    if (d.weekday != tm.tm_wday) fail(r, "weekday", utc, d.weekday, tm.tm_wday);
+  }
+}
+
+// Worker: everything the clock asks of the engine, against the reference
+static void checkZone(const Reference& r, const TzRule& rule) {
+  // Offsets on a dense grid, through both the rule and the transition table
+  TzTable<4> table;
+  table.build(rule, 1969);
+  for (int64_t utc = SPAN_START; utc < SPAN_END; utc += DENSE_STEP) {
+    int32_t want = refOffset(r, utc);
+    int32_t got = tzOffsetAt(rule, utc);
+    if (got != want) fail(r, "tzOffsetAt", utc, got, want);
+    if (rule.hasDst && !table.covers(utc)) {
+      int32_t y;
+      int m, d;
+      tzCivilFromDays(tzFloorDiv(utc, 86400), y, m, d);
+      table.build(rule, y - 1);
+    }
+    got = table.offsetAt(utc);
+    if (got != want) fail(r, "TzTable::offsetAt", utc, got, want);
+  }
+
+  // Each transition to the second, and the validity window either side of it
+  for (size_t i = 0; i < r.transitions.size(); i++) {
+    const RefTransition& t = r.transitions[i];
+    int64_t from, until;
+    int32_t before = tzOffsetAt(rule, t.at - 1, &from, &until);
+    if (before != refOffset(r, t.at - 1)) fail(r, "offset before transition", t.at - 1, before, refOffset(r, t.at - 1));
+    if (until != t.at) fail(r, "validUntil", t.at - 1, until, t.at);
+    int32_t after = tzOffsetAt(rule, t.at, &from, &until);
+    if (after != t.offsetAfter) fail(r, "offset at transition", t.at, after, t.offsetAfter);
+    if (from != t.at) fail(r, "validFrom", t.at, from, t.at);
+    if (i + 1 < r.transitions.size() && until != r.transitions[i + 1].at) {
+      fail(r, "validUntil", t.at, until, r.transitions[i + 1].at);
+    }
+  }
+
+  // Transition lists per year, as TzTable builds them
+  if (!rule.hasDst) {
+    if (!r.transitions.empty()) fail(r, "glibc has transitions for a rule without DST", r.transitions[0].at, 0, 1);
+    return;
+  }
+  TzTransition list[2 * 130];
+  int n = tzTransitions(rule, 1970, 2099, list, 2 * 130);
+  if (n != (int)r.transitions.size()) fail(r, "transition count", 0, n, r.transitions.size());
+  for (int i = 0; i < n && i < (int)r.transitions.size(); i++) {
+    if (list[i].at != r.transitions[i].at) fail(r, "tzTransitions instant", list[i].at, list[i].at, r.transitions[i].at);
+    if (list[i].offsetAfter != r.transitions[i].offsetAfter) {
+      fail(r, "tzTransitions offset", list[i].at, list[i].offsetAfter, r.transitions[i].offsetAfter);
+    }
+  }
+}
+
+void test_all_zones_match_glibc() {
+  std::vector<TzRule> rules(numTimezones);
+  refs.resize(numTimezones);
+  uint64_t t0 = micros64();
+  for (int i = 0; i < numTimezones; i++) buildReference(i, refs[i], rules[i]);
+  uint64_t t1 = micros64();
+
+  std::atomic<int> next{0};
+  unsigned workers = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::thread> pool;
+  for (unsigned w = 0; w < workers; w++) {
+    pool.emplace_back([&]() {
+      for (int i = next++; i < numTimezones; i = next++) checkZone(refs[i], rules[i]);
+    });
+  }
+  for (std::thread& t : pool) t.join();
+  uint64_t t2 = micros64();
+
+  size_t transitions = 0;
+  for (const Reference& r : refs) transitions += r.transitions.size();
+  char msg[160];
+  snprintf(msg, sizeof(msg), "%d zones, %u transitions; glibc reference %.1f s, engine checks %.1f s on %u threads",
+           numTimezones, (unsigned)transitions, (t1 - t0) / 1e6, (t2 - t1) / 1e6, workers);
+  TEST_MESSAGE(msg);
+  for (const std::string& f : failures) TEST_MESSAGE(f.c_str());
+  TEST_ASSERT_EQUAL_INT_MESSAGE(0, (int)failures.size(), "engine disagrees with glibc");
+}
+
+void test_table_covers_all_zones() {
+  TEST_ASSERT_EQUAL(89, numTimezones);
+  char tz[TZ_RULE_MAX];
+  for (int i = 0; i < numTimezones; i++) {
+    TEST_ASSERT_TRUE_MESSAGE(strlen(timezoneRule(i, tz)) < TZ_RULE_MAX - 1, tz);
+  }
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_table_covers_all_zones);
+  RUN_TEST(test_all_zones_match_glibc);
+  return UNITY_END();
+}
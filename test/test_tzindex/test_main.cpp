@@ -0,0 +1,85 @@
+// timezoneSearch() against a brute-force scan of the zone names: for every one- and
+// two-letter query and several result limits, the same zones in the returned
+// slots and the same total count.
+
+#include <unity.h>
+#include <stdio.h>
+#include <Arduino.h>
+#include "tzindex.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Zones with a word starting with q (case-insensitive)
+static int bruteForce(const char* q, bool* match) {
+  int n = 0;
+  char name[TZ_NAME_MAX];
+  size_t len = strlen(q);
+  for (int z = 0; z < numTimezones; z++) {
+    timezoneName(z, name);
+    match[z] = false;
+    for (size_t p = 0; name[p]; p++) {
+      if (!tzWordChar(name[p]) || (p > 0 && tzWordChar(name[p - 1]))) continue;
+      if (strncasecmp(name + p, q, len) == 0) match[z] = true;
+    }
+    n += match[z];
+  }
+  return n;
+}
+
+static void check(const char* q) {
+  bool match[numTimezones];
+  int want = bruteForce(q, match);
+  const int limits[] = {1, 2, 5, numTimezones};
+  for (int max : limits) {
+    uint16_t out[numTimezones];
+    int found = timezoneSearch(q, out, max);
+    char msg[64];
+    snprintf(msg, sizeof(msg), "q=\"%s\" max=%d", q, max);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(want, found, msg);
+    for (int i = 0; i < found && i < max; i++) {
+      TEST_ASSERT_TRUE_MESSAGE(match[out[i]], msg);
+      for (int j = 0; j < i; j++) TEST_ASSERT_TRUE_MESSAGE(out[i] != out[j], msg);
+    }
+  }
+}
+
+void test_all_short_queries_match_brute_force() {
+  char q[3] = {};
+  for (char a = 'a'; a <= 'z'; a++) {
+    q[0] = a;
+    q[1] = '\0';
+    check(q);
+    for (char b = 'a'; b <= 'z'; b++) {
+      q[1] = b;
+      check(q);
+    }
+  }
+}
+
+// "Port Moresby, Papua New Guinea" matches "p" twice; with a limit of 1 it falls
+// past the returned slot and must still be counted once
+void test_count_is_distinct_zones_beyond_limit() {
+  bool match[numTimezones];
+  uint16_t out[1];
+  TEST_ASSERT_EQUAL(bruteForce("p", match), timezoneSearch("p", out, 1));
+  TEST_ASSERT_EQUAL(bruteForce("s", match), timezoneSearch("s", out, 1));
+}
+
+void test_case_and_spaces() {
+  uint16_t a[8], b[8];
+  int n = timezoneSearch("york", a, 8);
+  TEST_ASSERT_EQUAL(n, timezoneSearch("  YoRk", b, 8));
+  TEST_ASSERT_GREATER_THAN(0, n);
+  for (int i = 0; i < n && i < 8; i++) TEST_ASSERT_EQUAL(a[i], b[i]);
+  TEST_ASSERT_EQUAL(0, timezoneSearch("   ", a, 8));
+  TEST_ASSERT_EQUAL(0, timezoneSearch("zzzz", a, 8));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_all_short_queries_match_brute_force);
+  RUN_TEST(test_count_is_distinct_zones_beyond_limit);
+  RUN_TEST(test_case_and_spaces);
+  return UNITY_END();
+}
@@ -0,0 +1,239 @@
+// Weather fetch path against a local OWM stand-in: HttpStream polls the response
+// in small budgets and JsonStream picks the fields out of the streamed body, as
+// serviceWeather() does. Also jsonEscape(), used when the fields are served again.
+
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include "httpstandin.h"
+#include "httpstream.h"
+#include "jsonstream.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const char* owmBody =
+    "{\"coord\":{\"lon\":151.2073,\"lat\":-33.8679},"
+    "\"weather\":[{\"id\":803,\"main\":\"Clouds\",\"description\":\"broken clouds\",\"icon\":\"04d\"}],"
+    "\"base\":\"stations\","
+    "\"main\":{\"temp\":18.45,\"feels_like\":17.92,\"temp_min\":17.01,\"temp_max\":19.63,"
+    "\"pressure\":1016,\"humidity\":72},"
+    "\"visibility\":10000,\"wind\":{\"speed\":4.63,\"deg\":130},\"clouds\":{\"all\":75},"
+    "\"dt\":1760695200,\"sys\":{\"type\":2,\"id\":2018875,\"country\":\"AU\","
+    "\"sunrise\":1760640000,\"sunset\":1760686000},"
+    "\"timezone\":39600,\"id\":2147714,\"name\":\"Sydney \\\"CBD\\\"\",\"cod\":200}";
+
+static std::string okResponse(const char* body) {
+  return std::string("HTTP/1.1 200 OK\r\nContent-Type: application/json; charset=utf-8\r\n"
+                     "Server: openresty\r\nConnection: close\r\n\r\n") + body;
+}
+
+// The fields onWeatherValue() keeps
+struct Weather {
+  bool valid = false;
+  double temp = 0;
+  int humidity = 0, pressure = 0, conditionId = 0;
+  std::string condition, city;
+};
+
+static void onValue(const char* path, const char* value, void* ctx) {
+  Weather& w = *static_cast<Weather*>(ctx);
+  if (strcmp(path, "main.temp") == 0) {
+    w.temp = atof(value);
+    w.valid = true;
+  } else if (strcmp(path, "main.humidity") == 0) {
+    w.humidity = atoi(value);
+  } else if (strcmp(path, "main.pressure") == 0) {
+    w.pressure = atoi(value);
+  } else if (strcmp(path, "weather[0].id") == 0) {
+    w.conditionId = atoi(value);
+  } else if (strcmp(path, "weather[0].main") == 0) {
+    w.condition = value;
+  } else if (strcmp(path, "name") == 0) {
+    w.city = value;
+  }
+}
+
+static JsonStream json;
+
+static void onBody(const uint8_t* data, size_t len, void* ctx) {
+  for (size_t i = 0; i < len; i++) json.feed(data[i]);
+}
+
+struct FetchResult {
+  HttpStream::State state;
+  int status;
+  int polls;
+  unsigned long longestPollUs;
+};
+
+// Runs one fetch the way serviceWeather() does: a small budget per loop pass
+static FetchResult fetch(uint16_t port, const char* path, Weather& w, size_t budget = 32) {
+  static HttpStream http;
+  json.begin(onValue, &w);
+  http.onBody(onBody);
+  FetchResult r = {HttpStream::FAILED, 0, 0, 0};
+  http.begin("127.0.0.1", port, path, nullptr, 1000, 2000, nullptr);
+  while (http.busy()) {
+    uint64_t t = micros64();
+    http.poll(budget);
+    r.longestPollUs = std::max(r.longestPollUs, (unsigned long)(micros64() - t));
+    r.polls++;
+    usleep(200);
+  }
+  r.state = http.state();
+  r.status = http.status();
+  http.stop();
+  return r;
+}
+
+void test_fetch_from_owm_standin() {
+  HttpStandIn server([](const std::string&) { return okResponse(owmBody); }, 48, 1);
+  uint16_t port = server.start();
+  TEST_ASSERT_TRUE(port != 0);
+
+  Weather w;
+  FetchResult r = fetch(port, "/data/2.5/weather?q=Sydney,AU&units=metric&appid=KEY", w);
+  TEST_ASSERT_EQUAL(HttpStream::DONE, r.state);
+  TEST_ASSERT_EQUAL(200, r.status);
+  TEST_ASSERT_FALSE(json.failed());
+  TEST_ASSERT_TRUE(json.done());
+  TEST_ASSERT_TRUE(w.valid);
+  TEST_ASSERT_TRUE(w.temp > 18.44 && w.temp < 18.46);
+  TEST_ASSERT_EQUAL(72, w.humidity);
+  TEST_ASSERT_EQUAL(1016, w.pressure);
+  TEST_ASSERT_EQUAL(803, w.conditionId);
+  TEST_ASSERT_EQUAL_STRING("Clouds", w.condition.c_str());
+  TEST_ASSERT_EQUAL_STRING("Sydney \"CBD\"", w.city.c_str());
+
+  std::vector<std::string> req = server.requests();
+  TEST_ASSERT_EQUAL(1, (int)req.size());
+  TEST_ASSERT_EQUAL(0, (int)req[0].find("GET /data/2.5/weather?q=Sydney,AU&units=metric&appid=KEY HTTP/1.0\r\n"));
+  TEST_ASSERT_TRUE(req[0].find("\r\nHost: 127.0.0.1\r\n") != std::string::npos);
+}
+
+// The body arrives in pieces and is consumed a budget at a time, never in one go
+void test_fetch_is_incremental() {
+  HttpStandIn server([](const std::string&) { return okResponse(owmBody); }, 16, 2);
+  uint16_t port = server.start();
+  Weather w;
+  FetchResult r = fetch(port, "/", w, 16);
+  TEST_ASSERT_EQUAL(HttpStream::DONE, r.state);
+  TEST_ASSERT_TRUE(w.valid);
+  size_t bytes = okResponse(owmBody).size();
+  TEST_ASSERT_GREATER_THAN((int)(bytes / 16), r.polls);
+  char msg[96];
+  snprintf(msg, sizeof(msg), "%d polls, longest %lu us", r.polls, r.longestPollUs);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_LESS_THAN(5000, (long)r.longestPollUs);  // Polls never wait for the network
+}
+
+void test_http_error_status() {
+  HttpStandIn server([](const std::string&) {
+    return std::string("HTTP/1.1 401 Unauthorized\r\n\r\n{\"cod\":401,\"message\":\"Invalid API key\"}");
+  });
+  uint16_t port = server.start();
+  Weather w;
+  FetchResult r = fetch(port, "/", w);
+  TEST_ASSERT_EQUAL(HttpStream::DONE, r.state);
+  TEST_ASSERT_EQUAL(401, r.status);
+  TEST_ASSERT_FALSE(w.valid);  // finishWeatherFetch() keeps the last good result
+}
+
+void test_connection_dropped_before_headers() {
+  HttpStandIn server([](const std::string&) { return std::string(); });
+  uint16_t port = server.start();
+  Weather w;
+  FetchResult r = fetch(port, "/", w);
+  TEST_ASSERT_EQUAL(HttpStream::FAILED, r.state);
+}
+
+void test_truncated_body_fails_json() {
+  std::string partial = okResponse(owmBody).substr(0, 200);
+  HttpStandIn server([partial](const std::string&) { return partial; });
+  uint16_t port = server.start();
+  Weather w;
+  FetchResult r = fetch(port, "/", w);
+  TEST_ASSERT_EQUAL(HttpStream::DONE, r.state);  // HTTP/1.0 cannot tell...
+  TEST_ASSERT_FALSE(json.done());                 // ...but the JSON never closed
+  TEST_ASSERT_FALSE(w.valid);
+}
+
+void test_connect_refused() {
+  HttpStandIn server([](const std::string&) { return std::string(); });
+  uint16_t port = server.start();
+  server.stop();  // Nothing listens on the port any more
+  Weather w;
+  FetchResult r = fetch(port, "/", w);
+  TEST_ASSERT_EQUAL(HttpStream::FAILED, r.state);
+}
+
+// begin() does no network work; the lookup takes a poll of its own and its result
+// is reused, so a repeat fetch of the same host needs no lookup at all
+void test_lookup_is_a_poll_of_its_own_and_cached() {
+  HttpStandIn server([](const std::string&) { return okResponse(owmBody); }, 256, 0);
+  uint16_t port = server.start();
+  WiFi.lookupDelayMs = 100;  // A slow DNS server
+  uint32_t lookups = WiFi.hostLookups;
+
+  HttpStream http;
+  for (int fetchNo = 0; fetchNo < 2; fetchNo++) {
+    uint64_t t = micros64();
+    http.begin("localhost", port, "/", nullptr, 1000, 2000, nullptr);
+    TEST_ASSERT_LESS_THAN(5000, (long)(micros64() - t));
+    TEST_ASSERT_EQUAL(fetchNo == 0 ? HttpStream::LOOKUP : HttpStream::CONNECT, http.state());
+    while (http.busy()) {
+      HttpStream::State before = http.state();
+      t = micros64();
+      http.poll(64);
+      long us = micros64() - t;
+      if (before != HttpStream::LOOKUP) TEST_ASSERT_LESS_THAN(50000, us);  // Only the lookup waits
+      usleep(200);
+    }
+    TEST_ASSERT_EQUAL(HttpStream::DONE, http.state());
+    TEST_ASSERT_EQUAL(200, http.status());
+    http.stop();
+  }
+  WiFi.lookupDelayMs = 0;
+  TEST_ASSERT_EQUAL_INT(1, WiFi.hostLookups - lookups);
+  TEST_ASSERT_TRUE(server.requests()[1].find("\r\nHost: localhost\r\n") != std::string::npos);
+}
+
+static std::string escaped;
+static void collect(char c) { escaped += c; }
+static std::string parsed;
+static void onEscaped(const char* path, const char* value, void*) { parsed = value; }
+
+// Text escaped for a response reads back unchanged through a JSON parser
+void test_json_escape_round_trip() {
+  const char* texts[] = {"plain", "say \"hi\"", "back\\slash", "tab\there", "line\r\nbreak", "bell\x07", "Zürich"};
+  for (const char* t : texts) {
+    escaped = "{\"v\":\"";
+    jsonEscape(t, collect);
+    escaped += "\"}";
+    JsonStream p;
+    parsed.clear();
+    p.begin(onEscaped, nullptr);
+    for (char c : escaped) p.feed(c);
+    TEST_ASSERT_TRUE_MESSAGE(p.done() && !p.failed(), escaped.c_str());
+    if (strcmp(t, "bell\x07") == 0) {
+      TEST_ASSERT_TRUE(escaped.find("\\u0007") != std::string::npos);  // JsonStream drops \u escapes
+    } else {
+      TEST_ASSERT_EQUAL_STRING(t, parsed.c_str());
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_fetch_from_owm_standin);
+  RUN_TEST(test_fetch_is_incremental);
+  RUN_TEST(test_http_error_status);
+  RUN_TEST(test_connection_dropped_before_headers);
+  RUN_TEST(test_truncated_body_fails_json);
+  RUN_TEST(test_connect_refused);
+  RUN_TEST(test_lookup_is_a_poll_of_its_own_and_cached);
+  RUN_TEST(test_json_escape_round_trip);
+  return UNITY_END();
+}